@@ -190,6 +190,19 @@ namespace alb {
       return b && _allocator.owns(toInnerBlock(b));
     }
 
+    /**
+     * If the underlying Allocator defines ::goodSize() this method is available.
+     * It returns the length, that the given block with its requested length
+     * really covers, including the room up to a possible Sufix.
+     * \param b The Block with its requested length
+     */
+    template <typename U = Allocator>
+    typename std::enable_if<traits::has_goodSize<U>::value, size_t>::type
+    goodSize(const block &b) const
+    {
+      return _allocator.goodSize(toInnerBlock(b)) - prefix_size - sufix_size;
+    }
+
     /**
      * The given block gets reallocated to the new provided size n. Any potential
      * defined Prefix and/or Sufix gets copied to the new location.
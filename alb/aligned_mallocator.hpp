@@ -10,6 +10,11 @@
 #pragma once
 
 #include "allocator_base.hpp"
+#include "internal/reallocator.hpp"
+
+#ifndef BOOST_MSVC
+#include <malloc.h>
+#endif
 
 namespace alb {
   /**
@@ -23,8 +28,6 @@ namespace alb {
    * \ingroup group_allocators group_shared
    */
   template <size_t DefaultAlignment = 16> class aligned_mallocator {
-    static const unsigned int alignment = DefaultAlignment;
-
 #ifdef BOOST_MSVC
     bool alignedReallocate(block &b, size_t n)
     {
@@ -37,32 +40,18 @@ namespace alb {
       return false;
     }
 #else
-    // On posix there is no _aligned_realloc so we try a normal realloc
-    // if the result is still aligned we are fine
-    // otherwise we have to do it by hand
+    // On posix there is no aligned realloc, so a new aligned block is
+    // allocated and the content is copied
     bool alignedReallocate(block &b, size_t n)
     {
-      block reallocatedBlock(::realloc(b.ptr, n));
-      if (reallocatedBlock.ptr != nullptr) {
-        if (static_cast<size_t>(b.ptr) % DefaultAlignment != 0) {
-          auto newAlignedBlock = allocate(n);
-          if (!newAlignedBlock) {
-            return false;
-          }
-          internal::blockCopy(b, newAlignedBlock);
-        }
-        else {
-          b = reallocatedBlock;
-        }
-
-        return true;
-      }
-      return false;
+      return internal::reallocateWithCopy(*this, *this, b, n);
     }
 #endif
 
   public:
     static const bool supports_truncated_deallocation = false;
+    static const size_t alignment = DefaultAlignment;
+
     /**
      * Allocates rounded up to the defined alignment the number of bytes.
      * If the system cannot allocate the specified amount of memory then
@@ -112,4 +101,7 @@ namespace alb {
       }
     }
   };
+
+  template <size_t DefaultAlignment>
+  const size_t aligned_mallocator<DefaultAlignment>::alignment;
 }
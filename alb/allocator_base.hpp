@@ -106,5 +106,15 @@ namespace alb {
       return n + ((remainder == 0) ? 0 : (basis - remainder));
     }
 
+    /**
+     * Returns the first address at or beyond p that is a multiple of alignment
+     * \ingroup group_internal
+     */
+    inline char *alignUp(char *p, size_t alignment)
+    {
+      const auto address = reinterpret_cast<size_t>(p);
+      return p + (roundToAlignment(alignment, address) - address);
+    }
+
   } // namespace Helper
 }
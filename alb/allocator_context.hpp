@@ -0,0 +1,111 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "global_allocator.hpp"
+#include "typed_allocation.hpp"
+
+#include <memory>
+#include <type_traits>
+
+namespace alb {
+  /**
+   * Switches the allocator of the current thread, that is taken by every
+   * alb::context_allocator constructed during the lifetime of this object.
+   * Contexts can be nested, at the end of the scope the previous one becomes
+   * current again. Without any context the global_allocator<Allocator>
+   * instance is taken.
+   * E.g. all containers built while handling a request go into an arena:
+   *   alb::stack_allocator<65536> arena;
+   *   {
+   *     alb::scoped_allocator_context<alb::stack_allocator<65536>> ctx(arena);
+   *     handle(request);
+   *   }
+   *   arena.deallocateAll();
+   * \tparam Allocator The type of the allocator of the context
+   *
+   * \ingroup group_allocators
+   */
+  template <class Allocator> class scoped_allocator_context {
+    Allocator *_previous;
+
+    static Allocator *&current()
+    {
+      thread_local Allocator *allocator = nullptr;
+      return allocator;
+    }
+
+    scoped_allocator_context(const scoped_allocator_context &) = delete;
+    scoped_allocator_context &operator=(const scoped_allocator_context &) = delete;
+
+  public:
+    explicit scoped_allocator_context(Allocator &allocator)
+      : _previous(current())
+    {
+      current() = std::addressof(allocator);
+    }
+
+    ~scoped_allocator_context()
+    {
+      current() = _previous;
+    }
+
+    /**
+     * Returns the allocator of the innermost context of the calling thread
+     */
+    static Allocator &allocator()
+    {
+      auto result = current();
+      return result != nullptr ? *result : global_allocator<Allocator>::instance();
+    }
+  };
+
+  /**
+   * This class adapts an alb allocator to the standard allocator interface
+   * like alb::ref_allocator, but it takes the allocator of the current
+   * alb::scoped_allocator_context on construction. It remembers it, so that
+   * all blocks are returned to their owner, even if the context has ended in
+   * the meantime. A copy of a container is constructed in the context, that
+   * is current at the time of the copy.
+   * The containers must be destroyed, before the allocator of their context
+   * is reset.
+   * \tparam T The type of the allocated objects
+   * \tparam Allocator The type of the allocator of the contexts, the requested
+   *         length is passed on deallocation as by alb::ref_allocator
+   *
+   * \ingroup group_allocators
+   */
+  template <typename T, class Allocator>
+  class context_allocator : public ref_allocator<T, Allocator> {
+  public:
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    template <typename U> struct rebind {
+      typedef context_allocator<U, Allocator> other;
+    };
+
+    context_allocator()
+      : ref_allocator<T, Allocator>(scoped_allocator_context<Allocator>::allocator())
+    {
+    }
+
+    template <typename U>
+    context_allocator(const context_allocator<U, Allocator> &x)
+      : ref_allocator<T, Allocator>(x)
+    {
+    }
+
+    context_allocator select_on_container_copy_construction() const
+    {
+      return context_allocator();
+    }
+  };
+}
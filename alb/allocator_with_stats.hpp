@@ -548,6 +548,19 @@ public:
       return _allocator.owns(b);
     }
 
+    /**
+     * The given block is passed to the underlying Allocator to get the length
+     * that it really covers.
+     * This method is only available if the underlying Allocator implements it.
+     * \param b The block with its requested length
+     */
+    template <typename U = Allocator>
+    typename std::enable_if<traits::has_goodSize<U>::value, size_t>::type
+    goodSize(const block &b) const
+    {
+      return _allocator.goodSize(b);
+    }
+
     /**
      * The given block is passed to the underlying Allocator to be expanded
      * This method is only available if the underlying allocator implements it.
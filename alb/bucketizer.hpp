@@ -147,6 +147,17 @@ namespace alb {
       }
     }
 
+    /**
+     * Returns the allocator of the i-th bucket, e.g. to watch the pool of a
+     * alb::freelist by the alb::freelist_refiller
+     * \param i The index of the bucket
+     */
+    Allocator &bucket(unsigned i)
+    {
+      BOOST_ASSERT(i < number_of_buckets);
+      return _buckets[i];
+    }
+
   private:
     Allocator *findMatchingAllocator(size_t n)
     {
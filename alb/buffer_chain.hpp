@@ -0,0 +1,379 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_base.hpp"
+#include "mallocator.hpp"
+
+#include <boost/assert.hpp>
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <sys/uio.h>
+
+namespace alb {
+
+  /**
+   * The buffer_chain is a sequence of bytes, that is stored in fixed sized
+   * segments. So growing the chain never copies the already written content
+   * as reallocating a contiguous buffer would do.
+   * The content is described as an array of iovec, that can be passed directly
+   * to ::writev() or ::sendmsg().
+   * Each segment carries a reference count, so that slice() and splice()
+   * share or move the content between chains without copying any byte. A
+   * segment is returned to the SegmentAllocator, when the last chain that
+   * refers to it releases it. Only the chain that exclusively refers to the
+   * end of a segment appends to it, so shared content is never overwritten.
+   * This class is not thread safe!
+   * \tparam SegmentAllocator The allocator that provides the segments, e.g. an
+   *         alb::freelist with SegmentSize as upper bound. It is shared by all
+   *         chains that exchange their content and must outlive them.
+   * \tparam SegmentSize The number of bytes of a segment including its header
+   * \tparam Allocator The allocator that provides the array of iovec
+   *
+   * \ingroup group_allocators
+   */
+  template <class SegmentAllocator, size_t SegmentSize = 4096, class Allocator = mallocator>
+  class buffer_chain {
+    struct segment {
+      size_t references;
+      size_t used;
+    };
+
+    static const size_t header_size = (sizeof(segment) + alignof(std::max_align_t) - 1) /
+                                      alignof(std::max_align_t) * alignof(std::max_align_t);
+
+    static_assert(SegmentSize > header_size, "The segment size is too small!");
+
+    SegmentAllocator &_segmentAllocator;
+    Allocator _allocator;
+
+    // the iovec and the segment of the i-th slice are stored in two parallel
+    // arrays within a single block
+    block _slices;
+    iovec *_iovecs;
+    segment **_segments;
+    size_t _count;
+    size_t _capacity;
+    size_t _size;
+
+    buffer_chain(const buffer_chain &) = delete;
+    buffer_chain &operator=(const buffer_chain &) = delete;
+
+    static char *dataOf(segment *s)
+    {
+      return reinterpret_cast<char *>(s) + header_size;
+    }
+
+    static void *endOf(const iovec &io)
+    {
+      return static_cast<char *>(io.iov_base) + io.iov_len;
+    }
+
+    void release(segment *s)
+    {
+      if (--s->references == 0) {
+        block b(s, SegmentSize);
+        _segmentAllocator.deallocate(b);
+      }
+    }
+
+    bool reserve(size_t n)
+    {
+      if (n <= _capacity) {
+        return true;
+      }
+      const auto newCapacity = std::max(n, std::max(_capacity * 2, size_t(8)));
+      auto newSlices = _allocator.allocate(newCapacity * (sizeof(iovec) + sizeof(segment *)));
+      if (!newSlices) {
+        return false;
+      }
+      auto newIovecs = static_cast<iovec *>(newSlices.ptr);
+      auto newSegments = reinterpret_cast<segment **>(newIovecs + newCapacity);
+      if (_count > 0) {
+        ::memcpy(newIovecs, _iovecs, _count * sizeof(iovec));
+        ::memcpy(newSegments, _segments, _count * sizeof(segment *));
+      }
+      _allocator.deallocate(_slices);
+      _slices = newSlices;
+      _iovecs = newIovecs;
+      _segments = newSegments;
+      _capacity = newCapacity;
+      return true;
+    }
+
+    bool pushBack(segment *s, void *p, size_t n)
+    {
+      if (!reserve(_count + 1)) {
+        return false;
+      }
+      _iovecs[_count].iov_base = p;
+      _iovecs[_count].iov_len = n;
+      _segments[_count] = s;
+      ++_count;
+      _size += n;
+      return true;
+    }
+
+    /**
+     * Returns true, if the last slice may be extended within its segment
+     */
+    bool tailIsWritable() const
+    {
+      if (_count == 0) {
+        return false;
+      }
+      auto s = _segments[_count - 1];
+      return s->references == 1 && s->used < SegmentSize - header_size &&
+             endOf(_iovecs[_count - 1]) == dataOf(s) + s->used;
+    }
+
+  public:
+    using segment_allocator = SegmentAllocator;
+    using allocator = Allocator;
+    static const size_t segment_size = SegmentSize;
+    /// The number of bytes of content that fit into a single segment
+    static const size_t segment_capacity = SegmentSize - header_size;
+
+    explicit buffer_chain(SegmentAllocator &segmentAllocator)
+      : _segmentAllocator(segmentAllocator)
+      , _iovecs(nullptr)
+      , _segments(nullptr)
+      , _count(0)
+      , _capacity(0)
+      , _size(0)
+    {
+    }
+
+    buffer_chain(buffer_chain &&x)
+      : _segmentAllocator(x._segmentAllocator)
+      , _allocator(std::move(x._allocator))
+      , _slices(std::move(x._slices))
+      , _iovecs(x._iovecs)
+      , _segments(x._segments)
+      , _count(x._count)
+      , _capacity(x._capacity)
+      , _size(x._size)
+    {
+      x._iovecs = nullptr;
+      x._segments = nullptr;
+      x._count = x._capacity = x._size = 0;
+    }
+
+    /**
+     * Releases all segments, that are not referenced by any other chain
+     */
+    ~buffer_chain()
+    {
+      clear();
+      _allocator.deallocate(_slices);
+    }
+
+    /**
+     * Returns the number of bytes of the content
+     */
+    size_t size() const
+    {
+      return _size;
+    }
+
+    bool empty() const
+    {
+      return _size == 0;
+    }
+
+    /**
+     * Returns the description of the content, e.g. for ::writev(). It stays
+     * valid until the chain is modified.
+     */
+    const iovec *iovecs() const
+    {
+      return _iovecs;
+    }
+
+    /**
+     * Returns the number of elements of iovecs()
+     */
+    size_t iovec_count() const
+    {
+      return _count;
+    }
+
+    /**
+     * Provides writable memory at the end of the chain, e.g. for ::read().
+     * If the last segment is full or shared, a new segment is appended. The
+     * written bytes become part of the content by commit().
+     * \return The writable memory or an empty block, if no segment could be
+     *         allocated
+     */
+    block prepare()
+    {
+      if (!tailIsWritable()) {
+        auto b = _segmentAllocator.allocate(SegmentSize);
+        if (!b) {
+          return {};
+        }
+        BOOST_ASSERT_MSG(b.length == SegmentSize, "The segment allocator must return SegmentSize!");
+        auto s = static_cast<segment *>(b.ptr);
+        s->references = 1;
+        s->used = 0;
+        if (!pushBack(s, dataOf(s), 0)) {
+          _segmentAllocator.deallocate(b);
+          return {};
+        }
+      }
+      auto s = _segments[_count - 1];
+      return {dataOf(s) + s->used, segment_capacity - s->used};
+    }
+
+    /**
+     * Appends n bytes, that were written into the block returned by the
+     * preceding prepare(), to the content.
+     */
+    void commit(size_t n)
+    {
+      BOOST_ASSERT(tailIsWritable() || (n == 0 && _count > 0));
+      auto s = _segments[_count - 1];
+      BOOST_ASSERT(s->used + n <= segment_capacity);
+      s->used += n;
+      _iovecs[_count - 1].iov_len += n;
+      _size += n;
+    }
+
+    /**
+     * Copies the n bytes at p to the end of the chain
+     * \return True, if the operation was successful. Otherwise the content may
+     *         be partially extended.
+     */
+    bool append(const void *p, size_t n)
+    {
+      auto source = static_cast<const char *>(p);
+      while (n > 0) {
+        auto b = prepare();
+        if (!b) {
+          return false;
+        }
+        const auto length = std::min(n, b.length);
+        ::memcpy(b.ptr, source, length);
+        commit(length);
+        source += length;
+        n -= length;
+      }
+      return true;
+    }
+
+    /**
+     * Moves the complete content of x to the end of this chain without
+     * copying any byte. Afterwards x is empty. Both chains must use the same
+     * segment allocator.
+     * \return True, if the operation was successful
+     */
+    bool splice(buffer_chain &x)
+    {
+      BOOST_ASSERT(&_segmentAllocator == &x._segmentAllocator);
+      if (this == &x || !reserve(_count + x._count)) {
+        return false;
+      }
+      if (x._count > 0) {
+        ::memcpy(_iovecs + _count, x._iovecs, x._count * sizeof(iovec));
+        ::memcpy(_segments + _count, x._segments, x._count * sizeof(segment *));
+      }
+      _count += x._count;
+      _size += x._size;
+      x._count = x._size = 0;
+      return true;
+    }
+
+    /**
+     * Returns a chain that shares the n bytes starting at offset of this
+     * content, without copying any byte.
+     * \return The slice, it is shorter than n if the content ends before or
+     *         it is empty if no memory for its description is available.
+     */
+    buffer_chain slice(size_t offset, size_t n) const
+    {
+      buffer_chain result(_segmentAllocator);
+      for (size_t i = 0; i < _count && n > 0; ++i) {
+        const auto &io = _iovecs[i];
+        if (offset >= io.iov_len) {
+          offset -= io.iov_len;
+          continue;
+        }
+        const auto length = std::min(n, io.iov_len - offset);
+        if (!result.pushBack(_segments[i], static_cast<char *>(io.iov_base) + offset, length)) {
+          result.clear();
+          return result;
+        }
+        ++_segments[i]->references;
+        offset = 0;
+        n -= length;
+      }
+      return result;
+    }
+
+    /**
+     * Removes the first n bytes of the content, e.g. after they were sent by
+     * ::writev(). Segments that are not referenced any more are released.
+     */
+    void consume(size_t n)
+    {
+      n = std::min(n, _size);
+      _size -= n;
+      size_t i = 0;
+      while (n > 0 && n >= _iovecs[i].iov_len) {
+        n -= _iovecs[i].iov_len;
+        release(_segments[i]);
+        ++i;
+      }
+      if (n > 0) {
+        _iovecs[i].iov_base = static_cast<char *>(_iovecs[i].iov_base) + n;
+        _iovecs[i].iov_len -= n;
+      }
+      if (i > 0) {
+        ::memmove(_iovecs, _iovecs + i, (_count - i) * sizeof(iovec));
+        ::memmove(_segments, _segments + i, (_count - i) * sizeof(segment *));
+        _count -= i;
+      }
+    }
+
+    /**
+     * Copies up to n bytes from the beginning of the content to p
+     * \return The number of copied bytes
+     */
+    size_t copy_to(void *p, size_t n) const
+    {
+      auto destination = static_cast<char *>(p);
+      size_t result = 0;
+      for (size_t i = 0; i < _count && result < n; ++i) {
+        const auto length = std::min(n - result, _iovecs[i].iov_len);
+        ::memcpy(destination + result, _iovecs[i].iov_base, length);
+        result += length;
+      }
+      return result;
+    }
+
+    /**
+     * Removes the complete content
+     */
+    void clear()
+    {
+      for (size_t i = 0; i < _count; ++i) {
+        release(_segments[i]);
+      }
+      _count = 0;
+      _size = 0;
+    }
+  };
+
+  template <class SegmentAllocator, size_t SegmentSize, class Allocator>
+  const size_t buffer_chain<SegmentAllocator, SegmentSize, Allocator>::segment_size;
+  template <class SegmentAllocator, size_t SegmentSize, class Allocator>
+  const size_t buffer_chain<SegmentAllocator, SegmentSize, Allocator>::segment_capacity;
+}
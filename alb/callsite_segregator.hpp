@@ -0,0 +1,238 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_base.hpp"
+#include "internal/callsite.hpp"
+#include "internal/reallocator.hpp"
+
+#include <cstring>
+
+namespace alb {
+  /**
+   * This allocator places blocks depending on the location in the source
+   * code, that requested them. Every call site gets an own instance of the
+   * SiteAllocator, e.g. a small alb::heap, so that objects which are created
+   * together by the same code path are laid out together and traversals over
+   * them touch fewer cache lines.
+   * The call site is passed like to alb::allocator_with_stats by the ALLOCATE
+   * macro. It is identified by the contents of the file and function name
+   * and the line, which are mapped by a hash into a table of MaxSites
+   * entries. So equal string literals of different translation units denote
+   * the same site. The names must live as long as this allocator, as string
+   * literals do. The site of each combination of name pointers and line,
+   * that was seen, is cached, so the names are compared by their contents
+   * only on the first allocation of a call site.
+   * Allocations without call site, of sites beyond MaxSites or that cannot be
+   * served by the SiteAllocator of their site go to the shared Overflow
+   * allocator.
+   * All MaxSites instances of SiteAllocator are created with this allocator.
+   * This class is not thread safe!
+   * \tparam SiteAllocator The allocator of each call site. It must implement
+   *         ::owns() by the address range of its memory, like alb::heap or
+   *         alb::stack_allocator do, because a block is given back to the
+   *         first site, that owns it. An ::owns() by the length of the block,
+   *         like that of alb::freelist, would route it to a wrong site.
+   * \tparam Overflow The allocator for all requests, that are not served by
+   *         a SiteAllocator
+   * \tparam MaxSites The maximum number of distinguished call sites
+   *
+   * \ingroup group_allocators
+   */
+  template <class SiteAllocator, class Overflow, size_t MaxSites = 16>
+  class callsite_segregator {
+    static_assert(traits::has_owns<SiteAllocator>::value,
+                  "The site allocator must implement owns()!");
+
+    struct site {
+      const char *file;
+      const char *function;
+      int line;
+    };
+
+    SiteAllocator _sites[MaxSites];
+    site _keys[MaxSites];
+    // the pointers of each site's names may differ between translation
+    // units, so there is room for more than one entry per site
+    internal::callsite_cache<size_t, 2 * MaxSites> _cache;
+    size_t _numberOfSites;
+    Overflow _overflow;
+
+    callsite_segregator(const callsite_segregator &) = delete;
+    callsite_segregator &operator=(const callsite_segregator &) = delete;
+
+    static bool sameName(const char *a, const char *b)
+    {
+      return a == b || (a != nullptr && b != nullptr && ::strcmp(a, b) == 0);
+    }
+
+    /**
+     * Returns the index of the site or MaxSites, if the table is full. The
+     * names are compared by their pointers first and only by their contents,
+     * if this call site was not seen before.
+     */
+    size_t siteIndex(const char *file, const char *function, int line)
+    {
+      return _cache.lookup(file, function, line, [this](const char *f, const char *fn, int l) {
+        return lookupSite(f, fn, l);
+      });
+    }
+
+    /**
+     * Returns the index of the site by the contents of its names or MaxSites,
+     * if the table is full
+     */
+    size_t lookupSite(const char *file, const char *function, int line)
+    {
+      auto i = internal::callsiteHash(file, function, line) % MaxSites;
+      for (size_t probe = 0; probe < MaxSites; ++probe) {
+        auto &key = _keys[i];
+        if (key.line == line && sameName(key.file, file) && sameName(key.function, function)) {
+          return i;
+        }
+        if (key.file == nullptr && key.function == nullptr) {
+          key.file = file;
+          key.function = function;
+          key.line = line;
+          ++_numberOfSites;
+          return i;
+        }
+        i = (i + 1) % MaxSites;
+      }
+      return MaxSites;
+    }
+
+    /**
+     * Returns the site allocator, that owns the block, or nullptr
+     */
+    SiteAllocator *ownerOf(const block &b)
+    {
+      for (auto &s : _sites) {
+        if (s.owns(b)) {
+          return &s;
+        }
+      }
+      return nullptr;
+    }
+
+  public:
+    using site_allocator = SiteAllocator;
+    using overflow_allocator = Overflow;
+    static const size_t max_sites = MaxSites;
+    static const bool supports_truncated_deallocation =
+        SiteAllocator::supports_truncated_deallocation && Overflow::supports_truncated_deallocation;
+
+    callsite_segregator()
+      : _numberOfSites(0)
+    {
+      ::memset(_keys, 0, sizeof(_keys));
+    }
+
+    /**
+     * Allocates n bytes by the allocator of the given call site
+     * \param n The requested number of bytes
+     * \param file The file name of the caller location
+     * \param function The callers function
+     * \param line The callers line in source code
+     */
+    block allocate(size_t n, const char *file = nullptr, const char *function = nullptr,
+                   int line = 0)
+    {
+      if (n == 0) {
+        return {};
+      }
+      if (file != nullptr || function != nullptr) {
+        const auto i = siteIndex(file, function, line);
+        if (i < MaxSites) {
+          auto result = _sites[i].allocate(n);
+          if (result) {
+            return result;
+          }
+        }
+      }
+      return _overflow.allocate(n);
+    }
+
+    void deallocate(block &b)
+    {
+      if (!b) {
+        return;
+      }
+      if (auto s = ownerOf(b)) {
+        s->deallocate(b);
+      }
+      else {
+        _overflow.deallocate(b);
+      }
+    }
+
+    /**
+     * Reallocates the block within its site allocator. If that fails, the block
+     * is moved to the Overflow allocator.
+     * \param b The block to be reallocated
+     * \param n The new size
+     * \return True, if the operation was successful
+     */
+    bool reallocate(block &b, size_t n)
+    {
+      if (internal::reallocator<callsite_segregator>::isHandledDefault(*this, b, n)) {
+        return true;
+      }
+      if (auto s = ownerOf(b)) {
+        if (s->reallocate(b, n)) {
+          return true;
+        }
+        return internal::reallocateWithCopy(*s, _overflow, b, n);
+      }
+      return _overflow.reallocate(b, n);
+    }
+
+    /**
+     * Checks the ownership of the given block. This is only available if the
+     * Overflow allocator implements ::owns().
+     */
+    template <typename U = Overflow>
+    typename std::enable_if<traits::has_owns<U>::value, bool>::type
+    owns(const block &b) const
+    {
+      for (auto &s : _sites) {
+        if (s.owns(b)) {
+          return true;
+        }
+      }
+      return _overflow.owns(b);
+    }
+
+    /**
+     * Returns the index of the call site, whose allocator owns the block, or
+     * max_sites, if the block belongs to the Overflow allocator
+     */
+    size_t siteOf(const block &b) const
+    {
+      for (size_t i = 0; i < MaxSites; ++i) {
+        if (_sites[i].owns(b)) {
+          return i;
+        }
+      }
+      return MaxSites;
+    }
+
+    /**
+     * Returns the number of call sites, that have an own allocator
+     */
+    size_t sites() const
+    {
+      return _numberOfSites;
+    }
+  };
+
+  template <class SiteAllocator, class Overflow, size_t MaxSites>
+  const size_t callsite_segregator<SiteAllocator, Overflow, MaxSites>::max_sites;
+}
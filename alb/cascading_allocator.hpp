@@ -12,6 +12,7 @@
 #include "allocator_base.hpp"
 #include "internal/noatomic.hpp"
 #include "internal/reallocator.hpp"
+#include "internal/tracepoints.hpp"
 #include <atomic>
 #include <boost/assert.hpp>
 
@@ -99,6 +100,7 @@ namespace alb {
 
       // Move the node from the stack to the allocated space
       *result = std::move(nodeOnStack);
+      ALB_TRACE2(cascading_new_node, this, result);
 
       return result;
     }
@@ -299,6 +301,23 @@ namespace alb {
       return findOwningNode(b) != nullptr;
     }
 
+    /**
+     * Returns the length, that the given block with its requested length
+     * really covers within the owning allocator
+     * This is only available if the Allocator implements it
+     * \param b The block with its requested length
+     */
+    template <typename U = Allocator>
+    typename std::enable_if<traits::has_goodSize<U>::value, size_t>::type
+    goodSize(const block &b) const
+    {
+      auto p = findOwningNode(b);
+      if (p == nullptr) {
+        return b.length;
+      }
+      return p->allocator.goodSize(b);
+    }
+
     /**
      * Deletes all allocated resources. All Blocks created by this instance
      * must not be used any more. Calling this method while other threads
@@ -0,0 +1,91 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_base.hpp"
+#include "bucketizer.hpp"
+#include "fallback_allocator.hpp"
+#include "freelist.hpp"
+#include "mallocator.hpp"
+
+#include <cstddef>
+#include <new>
+
+namespace alb {
+
+  /**
+   * The default composition for coroutine frames: frames of up to 1kB are
+   * served by freelists in buckets of 64 bytes, all bigger ones by ::malloc().
+   *
+   * \ingroup group_allocators
+   */
+  using default_frame_allocator =
+      fallback_allocator<bucketizer<freelist<mallocator, internal::DynasticDynamicSet,
+                                             internal::DynasticDynamicSet>,
+                                    1, 1024, 64>,
+                         mallocator>;
+
+  /**
+   * This mixin routes the allocation of coroutine frames to a thread local
+   * instance of the Allocator. It is intended as base class of a promise type:
+   *
+   *   struct promise_type : alb::coroutine_frame_allocator<> { ... };
+   *
+   * The compiler then allocates each frame of a coroutine with this promise
+   * type by promise_type::operator new() and frees it by the sized
+   * promise_type::operator delete(). Because frame sizes repeat, a
+   * composition of freelists reuses them without a call to the global new.
+   * The mixin can be used for any other class as well, it does not depend on
+   * coroutine support of the compiler.
+   * A frame must be destroyed on the thread that created it, unless the
+   * Allocator accepts blocks of other threads, e.g. alb::shared_freelist.
+   * \tparam Allocator The allocator of which each thread gets an instance. It
+   *         must accept the requested length on deallocation.
+   *
+   * \ingroup group_allocators
+   */
+  template <class Allocator = default_frame_allocator> class coroutine_frame_allocator {
+  public:
+    using allocator_type = Allocator;
+
+    /**
+     * Returns the instance of the Allocator of the current thread
+     */
+    static Allocator &allocator()
+    {
+      thread_local Allocator instance;
+      return instance;
+    }
+
+    static void *operator new(std::size_t n)
+    {
+      auto b = allocator().allocate(n);
+      if (!b) {
+        throw std::bad_alloc();
+      }
+      return b.ptr;
+    }
+
+    /**
+     * There is deliberately no unsized operator delete, the length of a block
+     * is not known without it. It is not needed: a coroutine frame is freed
+     * by the sized form, if the promise type declares no unsized one, and a
+     * delete expression passes the size of the object, if the class declares
+     * only the sized form. An object deleted through a pointer to its base
+     * needs a virtual destructor anyway, then the size of the most derived
+     * object is passed.
+     */
+    static void operator delete(void *p, std::size_t n)
+    {
+      block b(p, n);
+      allocator().deallocate(b);
+    }
+  };
+}
@@ -11,6 +11,7 @@
 
 #include "allocator_base.hpp"
 #include "internal/reallocator.hpp"
+#include "internal/tracepoints.hpp"
 #include <boost/type_traits/ice.hpp>
 
 namespace alb {
@@ -45,8 +46,10 @@ namespace alb {
         return {};
       }
       block result{Primary::allocate(n)};
-      if (!result)
+      if (!result) {
+        ALB_TRACE2(fallback_spill, this, n);
         result = Fallback::allocate(n);
+      }
 
       return result;
     }
@@ -136,6 +139,24 @@ namespace alb {
       return Primary::owns(b) || Fallback::owns(b);
     }
 
+    /**
+     * Returns the length, that the given block with its requested length
+     * really covers within the allocator that owns it.
+     * This method is only available if at least one of the allocators implements
+     * it
+     * \param b The block with its requested length
+     */
+    template <typename U = Primary, typename V = Fallback>
+    typename std::enable_if<traits::has_goodSize<U>::value || traits::has_goodSize<V>::value,
+                            size_t>::type
+    goodSize(const block &b) const
+    {
+      if (Primary::owns(b)) {
+        return traits::GoodSizer<U>::doIt(static_cast<const U &>(*this), b);
+      }
+      return traits::GoodSizer<V>::doIt(static_cast<const V &>(*this), b);
+    }
+
     template <typename U = Primary, typename V = Fallback>
     typename std::enable_if<traits::has_deallocateAll<U>::value &&
                                                 traits::has_deallocateAll<V>::value, void>::type
@@ -13,6 +13,7 @@
 #include "internal/dynastic.hpp"
 #include "internal/stack.hpp"
 #include "internal/reallocator.hpp"
+#include "internal/tracepoints.hpp"
 
 #ifdef _MSC_VER
 #pragma warning(push)
@@ -20,6 +21,7 @@
 #endif
 
 #include <boost/lockfree/stack.hpp>
+#include <atomic>
 
 namespace alb {
   /**
@@ -31,19 +33,38 @@ namespace alb {
    * It held until PoolSize blocks. More requested deallocations a forwarded to
    * the Allocator for deallocation.
    * NumberOfBatchAllocations specifies how blocks are allocated by the Allocator.
+   * The pool can be filled in advance by refill(), e.g. by the
+   * alb::freelist_refiller, so that a burst of allocations is served without
+   * the Allocator. The shared variant knows its number of free blocks only,
+   * if CountFreeBlocks is set, because the counter costs an additional atomic
+   * operation on each allocation and deallocation.
    * MinSize and MaxSize can be set at runtime by instantiating this with
    * ALB::DynasticDynamicSet.
    * Except the moment of instantiation, this allocator is thread safe and all
    * operations are lock free.
    * \tparam Shared Set to true, for a multi threaded usage, otherwise to false
+   * \tparam CountFreeBlocks Set to true, to count the free blocks of a shared
+   *         pool for free_blocks() and refill()
    * \tparam Allocator Then allocator that should be used, when a new resource is
    *                    needed
    *
    * \ingroup group_allocators group_shared
    */
   template <bool Shared, class Allocator, size_t MinSize, size_t MaxSize, unsigned PoolSize,
-            unsigned NumberOfBatchAllocations>
+            unsigned NumberOfBatchAllocations, bool CountFreeBlocks = false>
   class freelist_base {
+    struct no_counter {
+      explicit no_counter(size_t)
+      {
+      }
+      void operator++()
+      {
+      }
+      void operator--()
+      {
+      }
+    };
+
     Allocator _allocator;
 
     typename traits::type_switch<boost::lockfree::stack<void *, boost::lockfree::fixed_sized<true>,
@@ -57,13 +78,102 @@ namespace alb {
                                                                 : MaxSize),
                        internal::DynasticDynamicSet> _upperBound;
 
+    // is never less than the number of blocks in the shared _root, the not
+    // shared one knows its size
+    typename traits::type_switch<std::atomic<size_t>, no_counter, Shared && CountFreeBlocks>::type
+        _freeBlocks;
+
+    size_t freeBlocks(std::true_type) const
+    {
+      return _freeBlocks.load(std::memory_order_relaxed);
+    }
+
+    size_t freeBlocks(std::false_type) const
+    {
+      return _root.size();
+    }
+
+    bool push(void *p)
+    {
+      ++_freeBlocks;
+      if (_root.push(p)) {
+        return true;
+      }
+      --_freeBlocks;
+      return false;
+    }
+
+    bool pop(void *&p)
+    {
+      if (_root.pop(p)) {
+        --_freeBlocks;
+        return true;
+      }
+      return false;
+    }
+
+    /**
+     * Takes NumberOfBatchAllocations blocks from the Allocator and pushes them
+     * to the pool. If first is given, the first block is stored there instead.
+     * A block that does not fit into the pool any more, because it was filled
+     * in the meantime, is given back.
+     * \return The number of blocks kept from the Allocator, including first
+     */
+    size_t refillBatch(void **first)
+    {
+      const size_t blockSize = _upperBound.value();
+      if (supports_truncated_deallocation) {
+        // allocating in a bunch to gain of having the allocator code in the
+        // cache
+        auto batchAllocatedBlocks = _allocator.allocate(blockSize * NumberOfBatchAllocations);
+        if (!batchAllocatedBlocks) {
+          return 0;
+        }
+        auto p = static_cast<char *>(batchAllocatedBlocks.ptr);
+        size_t result = 0;
+        if (first != nullptr) {
+          *first = p;
+          result = 1;
+        }
+        for (size_t i = result; i < NumberOfBatchAllocations; i++) {
+          if (push(p + i * blockSize)) {
+            ++result;
+          }
+          else {
+            alb::block oldBlock(p + i * blockSize, blockSize);
+            _allocator.deallocate(oldBlock);
+          }
+        }
+        return result;
+      }
+
+      size_t result = 0;
+      for (; result < NumberOfBatchAllocations; result++) {
+        auto b = _allocator.allocate(blockSize);
+        if (!b) {
+          break;
+        }
+        if (first != nullptr && *first == nullptr) {
+          *first = b.ptr;
+        }
+        else if (!push(b.ptr)) { // the list is full in the meantime, so we
+                                 // exit early
+          _allocator.deallocate(b);
+          return result;
+        }
+      }
+      return result;
+    }
+
   public:
     using allocator = Allocator;
+    static const bool is_shared = Shared;
     static const unsigned pool_size = PoolSize;
     static const unsigned number_of_batch_allocations = NumberOfBatchAllocations;
     static const bool supports_truncated_deallocation = Allocator::supports_truncated_deallocation;
 
     freelist_base()
+      : _freeBlocks(0)
     {
     }
 
@@ -76,6 +186,7 @@ namespace alb {
      * \param maxSize The upper boundary accepted by this Allocator
      */
     freelist_base(size_t minSize, size_t maxSize)
+      : _freeBlocks(0)
     {
       _lowerBound.value(minSize);
       _upperBound.value(maxSize);
@@ -115,6 +226,17 @@ namespace alb {
       return _upperBound.value();
     }
 
+    /**
+     * Returns the number of blocks in the pool. In the shared case this is
+     * just a snapshot and it is only available with CountFreeBlocks.
+     */
+    size_t free_blocks() const
+    {
+      static_assert(!Shared || CountFreeBlocks,
+                    "A shared freelist counts its free blocks only with CountFreeBlocks!");
+      return freeBlocks(std::integral_constant<bool, Shared>());
+    }
+
     /**
      * Frees all resources. Beware of using allocated blocks given by
      * this allocator after calling this.
@@ -147,46 +269,53 @@ namespace alb {
       if (_lowerBound.value() <= n && n <= _upperBound.value()) {
         void *freeBlock = nullptr;
 
-        if (_root.pop(freeBlock)) {
+        if (pop(freeBlock)) {
+          ALB_TRACE3(allocate, this, n, freeBlock);
           return {freeBlock, _upperBound.value()};
         }
-        else {
-          size_t blockSize = _upperBound.value();
-          if (supports_truncated_deallocation) {
-            // allocating in a bunch to gain of having the allocator code in the
-            // cache
-            auto batchAllocatedBlocks = _allocator.allocate(blockSize * NumberOfBatchAllocations);
-
-            if (batchAllocatedBlocks) {
-              // we use the very first block directly so we start at 1
-              for (size_t i = 1; i < NumberOfBatchAllocations; i++) {
-                if (!_root.push(static_cast<char *>(batchAllocatedBlocks.ptr) + i * blockSize)) {
-                  BOOST_ASSERT(false);
-                  alb::block oldBlock(static_cast<char *>(batchAllocatedBlocks.ptr) + i * blockSize,
-                                      blockSize);
-                  _allocator.deallocate(oldBlock);
-                }
-              }
-              // returning the first within block
-              return {batchAllocatedBlocks.ptr, blockSize};
-            }
-            return _allocator.allocate(blockSize);
-          }
-          else {
-            for (size_t i = 0; i < NumberOfBatchAllocations - 1; i++) {
-              auto b = _allocator.allocate(blockSize);
-              if (!_root.push(b.ptr)) { // the list is full in the meantime, so we
-                                        // exit early
-                return b;
-              }
-            }
-            return _allocator.allocate(blockSize);
-          }
+        ALB_TRACE2(freelist_miss, this, n);
+        const auto taken = refillBatch(&freeBlock);
+        if (taken > 0) {
+          ALB_TRACE2(freelist_refill, this, taken);
+          // returning the first within the batch
+          return {freeBlock, _upperBound.value()};
         }
+        return _allocator.allocate(_upperBound.value());
       }
       return {};
     }
 
+    /**
+     * Fills the pool in advance with batches of NumberOfBatchAllocations
+     * blocks, the same as on a miss of allocate(), until it holds at least
+     * numberOfBlocks blocks. It stops earlier, if the next batch would not fit
+     * into the pool, would exceed maxBlocks or the Allocator fails. The limit
+     * matters for a shared pool, that may be drained during the refill.
+     * \param numberOfBlocks The number of blocks the pool should hold
+     * \param maxBlocks The maximum number of blocks taken from the Allocator
+     * \return The number of blocks taken from the Allocator
+     */
+    size_t refill(size_t numberOfBlocks, size_t maxBlocks = static_cast<size_t>(-1))
+    {
+      BOOST_ASSERT_MSG(_upperBound.value() != internal::DynasticUndefined,
+                       "The upper bound was not initialized!");
+
+      size_t result = 0;
+      while (free_blocks() < numberOfBlocks &&
+             free_blocks() + NumberOfBatchAllocations <= PoolSize &&
+             result + NumberOfBatchAllocations <= maxBlocks) {
+        const auto taken = refillBatch(nullptr);
+        if (taken == 0) {
+          break;
+        }
+        result += taken;
+      }
+      if (result > 0) {
+        ALB_TRACE2(freelist_refill, this, result);
+      }
+      return result;
+    }
+
     /**
      * Reallocates the given block. In this case only trivial case can lead to
      * a positive result. In general reallocation to a different size > 0 is not
@@ -221,7 +350,8 @@ namespace alb {
     void deallocate(block &b)
     {
       if (b && owns(b)) {
-        if (_root.push(b.ptr)) {
+        ALB_TRACE3(deallocate, this, b.ptr, b.length);
+        if (push(b.ptr)) {
           b.reset();
           return;
         }
@@ -237,18 +367,19 @@ namespace alb {
    * \ingroup group_allocator group_shared
    */
   template <class Allocator, size_t MinSize, size_t MaxSize, size_t PoolSize = 1024,
-            size_t NumberOfBatchAllocations = 8>
+            size_t NumberOfBatchAllocations = 8, bool CountFreeBlocks = false>
   class shared_freelist : public freelist_base<true, Allocator, MinSize, MaxSize, PoolSize,
-                                               NumberOfBatchAllocations> {
+                                               NumberOfBatchAllocations, CountFreeBlocks> {
   public:
     shared_freelist()
-      : freelist_base<true, Allocator, MinSize, MaxSize, PoolSize, NumberOfBatchAllocations>()
+      : freelist_base<true, Allocator, MinSize, MaxSize, PoolSize, NumberOfBatchAllocations,
+                      CountFreeBlocks>()
     {
     }
 
     shared_freelist(size_t minSize, size_t maxSize)
-      : freelist_base<true, Allocator, MinSize, MaxSize, PoolSize, NumberOfBatchAllocations>(
-            minSize, maxSize)
+      : freelist_base<true, Allocator, MinSize, MaxSize, PoolSize, NumberOfBatchAllocations,
+                      CountFreeBlocks>(minSize, maxSize)
     {
     }
   };
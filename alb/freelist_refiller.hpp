@@ -0,0 +1,223 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <boost/assert.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace alb {
+
+  /**
+   * The freelist_refiller keeps the pools of alb::freelist and
+   * alb::shared_freelist filled, so that the first allocations of a burst
+   * after an idle period do not take their blocks synchronously from the
+   * parent allocator.
+   * Each watched pool has a low and a high watermark. A tick() refills a pool
+   * with the batches of the freelist, if it holds fewer blocks than its low
+   * watermark plus the blocks consumed since the previous tick. Then it is
+   * filled up to its high watermark plus this consumption, so it is prepared
+   * for the demand just seen. A refill takes only as many blocks, as fit into
+   * the budget besides the blocks, that all watched pools hold right before
+   * it. Deallocations into shared pools by other threads may still let them
+   * exceed the budget, but the refiller itself never adds beyond it.
+   * tick() can be called explicitly, e.g. in the idle phase of an event loop,
+   * or periodically by a background thread after start(). The background
+   * thread may only be used, if all watched pools are shared ones. Shared
+   * pools must count their free blocks, see CountFreeBlocks of
+   * alb::shared_freelist.
+   * The pools must be watched before start() and must outlive the refiller.
+   *
+   * \ingroup group_allocators group_shared
+   */
+  class freelist_refiller {
+    struct watched_pool {
+      void *pool;
+      size_t (*freeBlocks)(const void *);
+      size_t (*refill)(void *, size_t, size_t);
+      size_t blockSize;
+      size_t batchSize;
+      size_t poolSize;
+      size_t lowWatermark;
+      size_t highWatermark;
+      size_t lastFreeBlocks;
+      bool shared;
+    };
+
+    const size_t _budget;
+    std::vector<watched_pool> _pools;
+    std::atomic<size_t> _refilledBlocks;
+    std::mutex _mutex;
+    std::condition_variable _wakeUp;
+    std::thread _thread;
+    bool _stop;
+
+    freelist_refiller(const freelist_refiller &) = delete;
+    freelist_refiller &operator=(const freelist_refiller &) = delete;
+
+    template <class Pool> static size_t freeBlocksOf(const void *pool)
+    {
+      return static_cast<const Pool *>(pool)->free_blocks();
+    }
+
+    template <class Pool>
+    static size_t refillOf(void *pool, size_t numberOfBlocks, size_t maxBlocks)
+    {
+      return static_cast<Pool *>(pool)->refill(numberOfBlocks, maxBlocks);
+    }
+
+    size_t refillPools()
+    {
+      size_t result = 0;
+      for (auto &p : _pools) {
+        const auto free = p.freeBlocks(p.pool);
+        const auto consumed = p.lastFreeBlocks > free ? p.lastFreeBlocks - free : 0;
+        if (free < p.lowWatermark + consumed) {
+          // shared pools change in the meantime, so the held blocks are read
+          // right before each refill
+          const auto held = idle();
+          const auto target = std::min(p.poolSize, p.highWatermark + consumed);
+          const auto allowed = held < _budget ? (_budget - held) / p.blockSize : 0;
+          // only whole batches are taken, so the budget is kept
+          const auto batches = std::min((target - std::min(target, free) + p.batchSize - 1) /
+                                            p.batchSize,
+                                        allowed / p.batchSize);
+          if (batches > 0) {
+            // a shared pool that is drained during the refill must not get
+            // more than the planned batches
+            result += p.refill(p.pool, free + batches * p.batchSize, batches * p.batchSize);
+          }
+        }
+        p.lastFreeBlocks = p.freeBlocks(p.pool);
+      }
+      _refilledBlocks += result;
+      return result;
+    }
+
+  public:
+    /**
+     * \param budget The number of bytes, that may be held by all watched pools
+     */
+    explicit freelist_refiller(size_t budget)
+      : _budget(budget)
+      , _refilledBlocks(0)
+      , _stop(false)
+    {
+    }
+
+    ~freelist_refiller()
+    {
+      stop();
+    }
+
+    /**
+     * Watches the pool of the given alb::freelist or alb::shared_freelist.
+     * \param pool The freelist, its bounds must be set already
+     * \param lowWatermark The pool is refilled, when it holds fewer blocks
+     * \param highWatermark The pool is refilled up to this number of blocks
+     */
+    template <class Pool>
+    void watch(Pool &pool, size_t lowWatermark = Pool::number_of_batch_allocations,
+               size_t highWatermark = 4 * Pool::number_of_batch_allocations)
+    {
+      BOOST_ASSERT_MSG(!_thread.joinable(), "Pools must be watched before the start!");
+      BOOST_ASSERT(lowWatermark <= highWatermark);
+      _pools.push_back({&pool, &freeBlocksOf<Pool>, &refillOf<Pool>, pool.max_size(),
+                        Pool::number_of_batch_allocations, Pool::pool_size, lowWatermark,
+                        std::min<size_t>(highWatermark, Pool::pool_size), pool.free_blocks(),
+                        Pool::is_shared});
+    }
+
+    /**
+     * Watches the pools of all buckets of the given alb::bucketizer of
+     * freelists with the same watermarks.
+     */
+    template <class Bucketizer>
+    void watchBuckets(Bucketizer &bucketizer, size_t lowWatermark, size_t highWatermark)
+    {
+      for (unsigned i = 0; i < Bucketizer::number_of_buckets; ++i) {
+        watch(bucketizer.bucket(i), lowWatermark, highWatermark);
+      }
+    }
+
+    /**
+     * Refills all pools below their watermark within the budget.
+     * \return The number of blocks taken from the parent allocators
+     */
+    size_t tick()
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return refillPools();
+    }
+
+    /**
+     * Starts a background thread, that calls tick() in the given interval.
+     * All watched pools must be shared ones.
+     */
+    void start(std::chrono::milliseconds interval)
+    {
+      BOOST_ASSERT_MSG(!_thread.joinable(), "The refiller is already started!");
+      BOOST_ASSERT_MSG(std::all_of(_pools.begin(), _pools.end(),
+                                   [](const watched_pool &p) { return p.shared; }),
+                       "Only shared pools can be refilled in the background!");
+      _stop = false;
+      _thread = std::thread([this, interval] {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (!_stop) {
+          refillPools();
+          _wakeUp.wait_for(lock, interval, [this] { return _stop; });
+        }
+      });
+    }
+
+    /**
+     * Stops the background thread, if it is running
+     */
+    void stop()
+    {
+      if (!_thread.joinable()) {
+        return;
+      }
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+      }
+      _wakeUp.notify_one();
+      _thread.join();
+    }
+
+    /**
+     * Returns the number of blocks taken from the parent allocators by all
+     * refills so far
+     */
+    size_t refilled_blocks() const
+    {
+      return _refilledBlocks.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Returns the number of bytes, that are held by all watched pools
+     */
+    size_t idle() const
+    {
+      size_t result = 0;
+      for (const auto &p : _pools) {
+        result += p.freeBlocks(p.pool) * p.blockSize;
+      }
+      return result;
+    }
+  };
+}
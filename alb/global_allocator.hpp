@@ -9,8 +9,11 @@
 ///////////////////////////////////////////////////////////////////
 #pragma once
 
+#include <cstddef>
+
 namespace alb {
-  struct length_prefix {
+  // The prefix keeps the following block aligned as by operator new
+  struct alignas(std::max_align_t) length_prefix {
     unsigned length;
   };
 
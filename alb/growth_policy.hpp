@@ -0,0 +1,171 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_base.hpp"
+#include "internal/reallocator.hpp"
+#include "internal/traits.hpp"
+
+#include <algorithm>
+
+namespace alb {
+  /**
+   * This allocator rounds every growing reallocation geometrically up, so that
+   * a block which is extended step by step, e.g. by single appends, is only
+   * copied O(log n) times instead of on every step.
+   * The new capacity is the old length multiplied by Numerator / Denominator,
+   * but at most MaxGrowth bytes more than needed, and it is rounded up to a
+   * multiple of Granularity, e.g. a page or a size class of the Allocator.
+   * A growth is tried in place by ::expand() first, if the Allocator
+   * implements it. The returned block length is the real capacity, and a
+   * reallocation to a size within it keeps the block unchanged, so an append
+   * loop can call ::reallocate() on every step. Only a shrink to a size, whose
+   * geometric capacity is smaller than the length, is passed to the Allocator.
+   * \tparam Allocator The allocator that is used as underlying allocator
+   * \tparam Numerator The numerator of the growth factor
+   * \tparam Denominator The denominator of the growth factor
+   * \tparam MaxGrowth The maximum number of bytes that are added beyond the
+   *         requested size
+   * \tparam Granularity Each capacity is a multiple of it
+   *
+   * \ingroup group_allocators group_shared
+   */
+  template <class Allocator, size_t Numerator = 2, size_t Denominator = 1,
+            size_t MaxGrowth = 64 * 1024 * 1024, size_t Granularity = 16>
+  class growth_policy {
+    static_assert(Numerator > Denominator, "The growth factor must be bigger than one!");
+    static_assert(Granularity > 0, "The granularity must be positive!");
+
+    Allocator _allocator;
+
+  public:
+    using allocator = Allocator;
+    static const bool supports_truncated_deallocation = Allocator::supports_truncated_deallocation;
+    static const size_t numerator = Numerator;
+    static const size_t denominator = Denominator;
+    static const size_t max_growth = MaxGrowth;
+    static const size_t granularity = Granularity;
+
+    /**
+     * Returns the capacity that is requested, when a block of the given length
+     * must grow to at least n bytes
+     */
+    static size_t capacityFor(size_t length, size_t n)
+    {
+      const auto geometric = length + length / Denominator * (Numerator - Denominator);
+      const auto capped = std::min(std::max(geometric, n), n + MaxGrowth);
+      return internal::roundToAlignment(Granularity, capped);
+    }
+
+    block allocate(size_t n)
+    {
+      if (n == 0) {
+        return {};
+      }
+      return _allocator.allocate(internal::roundToAlignment(Granularity, n));
+    }
+
+    void deallocate(block &b)
+    {
+      _allocator.deallocate(b);
+    }
+
+    /**
+     * Reallocates the given block. A growth is rounded up to the geometric
+     * capacity and tried in place first. If the capacity cannot be provided,
+     * the growth to exactly n bytes is tried. A size within the current length
+     * keeps the block and its capacity unchanged, as long as the length does
+     * not exceed the geometric capacity of the size. A larger shrink is passed
+     * unchanged to the Allocator, so that it can release the memory.
+     * \param b The block to be reallocated
+     * \param n The new minimum size
+     * \return True, if the operation was successful
+     */
+    bool reallocate(block &b, size_t n)
+    {
+      if (!b || n == 0) {
+        return internal::reallocator<growth_policy>::isHandledDefault(*this, b, n);
+      }
+      if (n <= b.length) {
+        if (capacityFor(n, n) >= b.length) {
+          return true;
+        }
+        return _allocator.reallocate(b, n);
+      }
+
+      const auto capacity = capacityFor(b.length, n);
+      if (traits::Expander<Allocator>::doIt(_allocator, b, capacity - b.length)) {
+        return true;
+      }
+      if (_allocator.reallocate(b, capacity)) {
+        return true;
+      }
+      return capacity != n && _allocator.reallocate(b, n);
+    }
+
+    /**
+     * Expands the given block in place by at least delta bytes. This is only
+     * available if the underlying Allocator implements ::expand().
+     */
+    template <typename U = Allocator>
+    typename std::enable_if<traits::has_expand<U>::value, bool>::type
+    expand(block &b, size_t delta)
+    {
+      return _allocator.expand(b, delta);
+    }
+
+    /**
+     * Checks the ownership of the given block. This is only available if the
+     * underlying Allocator implements ::owns().
+     */
+    template <typename U = Allocator>
+    typename std::enable_if<traits::has_owns<U>::value, bool>::type
+    owns(const block &b) const
+    {
+      return _allocator.owns(b);
+    }
+
+    /**
+     * Returns the length, that the given block with its requested length
+     * really covers. This is only available if the underlying Allocator
+     * implements ::goodSize().
+     */
+    template <typename U = Allocator>
+    typename std::enable_if<traits::has_goodSize<U>::value, size_t>::type
+    goodSize(const block &b) const
+    {
+      return _allocator.goodSize(block(b.ptr, internal::roundToAlignment(Granularity, b.length)));
+    }
+
+    /**
+     * Frees all memory of the underlying Allocator. This is only available
+     * if the underlying Allocator implements ::deallocateAll().
+     */
+    template <typename U = Allocator>
+    typename std::enable_if<traits::has_deallocateAll<U>::value, void>::type
+    deallocateAll()
+    {
+      _allocator.deallocateAll();
+    }
+  };
+
+  template <class Allocator, size_t Numerator, size_t Denominator, size_t MaxGrowth,
+            size_t Granularity>
+  const size_t growth_policy<Allocator, Numerator, Denominator, MaxGrowth, Granularity>::numerator;
+  template <class Allocator, size_t Numerator, size_t Denominator, size_t MaxGrowth,
+            size_t Granularity>
+  const size_t growth_policy<Allocator, Numerator, Denominator, MaxGrowth, Granularity>::denominator;
+  template <class Allocator, size_t Numerator, size_t Denominator, size_t MaxGrowth,
+            size_t Granularity>
+  const size_t growth_policy<Allocator, Numerator, Denominator, MaxGrowth, Granularity>::max_growth;
+  template <class Allocator, size_t Numerator, size_t Denominator, size_t MaxGrowth,
+            size_t Granularity>
+  const size_t growth_policy<Allocator, Numerator, Denominator, MaxGrowth, Granularity>::granularity;
+}
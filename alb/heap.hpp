@@ -13,6 +13,7 @@
 
 #include "internal/dynastic.hpp"
 #include "internal/reallocator.hpp"
+#include "internal/tracepoints.hpp"
 #include "internal/heap_helpers.hpp"
 
 #include <algorithm>
@@ -33,6 +34,8 @@ namespace alb {
    * _numberOfChunks.value() * _chunkSize.value()
    * It has a overhead of one bit per block and linear complexity for allocation
    * and deallocation operations.
+   * A deallocated block frees only the chunks its length covers completely,
+   * so a block with its requested length must be rounded up by ::goodSize().
    *
    * \ingroup group_allocators
    */
@@ -63,6 +66,7 @@ namespace alb {
 
   public:
     static const bool supports_truncated_deallocation = true;
+    static const bool shrinks_in_place = true;
 
     using allocator = Allocator;
 
@@ -112,6 +116,23 @@ namespace alb {
       return _chunkSize.value();
     }
 
+    /**
+     * Returns the complete memory region, out of which all blocks are served
+     */
+    const block &buffer() const
+    {
+      return _buffer;
+    }
+
+    /**
+     * Copies the control bitmap, a set bit means a free chunk
+     * \param target Must provide space for number_of_chunk() / 64 values
+     */
+    void copy_control(uint64_t *target) const
+    {
+      std::copy(_control, _control + _controlSize, target);
+    }
+
     ~heap()
     {
       shrink();
@@ -123,6 +144,16 @@ namespace alb {
              b.ptr < (static_cast<char *>(_buffer.ptr) + _buffer.length);
     }
 
+    /**
+     * Returns the length, that the given block with its requested length
+     * really covers. It must be passed on deallocation, if not the block of
+     * ::allocate() with its returned length is passed.
+     */
+    size_t goodSize(const block &b) const
+    {
+      return internal::roundToAlignment(_chunkSize.value(), b.length);
+    }
+
     block allocate(size_t n)
     {
       if (n == 0) {
@@ -138,25 +169,11 @@ namespace alb {
       size_t numberOfBlocks = numberOfAlignedBytes / _chunkSize.value();
       numberOfBlocks = std::max(size_t(1), numberOfBlocks);
 
-      if (numberOfBlocks < 64) {
-        auto result = allocateWithinASingleControlRegister(numberOfBlocks);
-        if (result) {
-          return result;
-        }
-      }
-      else if (numberOfBlocks == 64) {
-        auto result = allocateWithinCompleteControlRegister(numberOfBlocks);
-        if (result) {
-          return result;
-        }
-      }
-      else if ((numberOfBlocks % 64) == 0) {
-        auto result = allocateMultipleCompleteControlRegisters(numberOfBlocks);
-        if (result) {
-          return result;
-        }
-      }
-      return allocateWithRegisterOverlap(numberOfBlocks);
+      size_t scanned = 0;
+      auto result = allocateChunks(numberOfBlocks, scanned);
+      ALB_TRACE3(heap_scan, this, numberOfBlocks, scanned);
+      ALB_TRACE3(allocate, this, n, result.ptr);
+      return result;
     }
 
     void deallocate(block &b)
@@ -169,17 +186,8 @@ namespace alb {
         return;
       }
 
-      const auto context = blockToContext(b);
-
-      if (context.subIndex + context.usedChunks <= 64) {
-        setWithinSingleRegister<true>(context);
-      }
-      else if ((context.usedChunks % 64) == 0) {
-        deallocateForMultipleCompleteControlRegister(context);
-      }
-      else {
-        deallocateWithControlRegisterOverlap(context);
-      }
+      ALB_TRACE3(deallocate, this, b.ptr, b.length);
+      freeChunks(blockToContext(b));
       b.reset();
     }
 
@@ -189,6 +197,45 @@ namespace alb {
     }
 
     bool reallocate(block &b, size_t n)
+    {
+      const auto oldPtr = b.ptr;
+      const auto result = reallocateChunks(b, n);
+      // a failed reallocation is reported with a null pointer
+      ALB_TRACE4(reallocate, this, oldPtr, n, result ? b.ptr : nullptr);
+      return result;
+    }
+
+    bool expand(block &b, size_t delta)
+    {
+      if (delta == 0) {
+        return true;
+      }
+
+      const auto context = blockToContext(b);
+      const auto numberOfAdditionalNeededBlocks = static_cast<int>(
+          internal::roundToAlignment(_chunkSize.value(), delta) / _chunkSize.value());
+
+      // the extension starts behind the block, maybe in a following register
+      const auto extensionIndex =
+          context.registerIndex * 64 + context.subIndex + context.usedChunks;
+      if (static_cast<size_t>(extensionIndex + numberOfAdditionalNeededBlocks) >
+          _numberOfChunks.value()) {
+        return false;
+      }
+      const BlockContext extension(extensionIndex / 64, extensionIndex % 64,
+                                   numberOfAdditionalNeededBlocks);
+      const bool result = extension.subIndex + extension.usedChunks <= 64
+                              ? testAndSetWithinSingleRegister<false>(extension)
+                              : testAndSetOverMultipleRegisters<false>(extension);
+      ALB_TRACE4(expand, this, b.ptr, delta, result);
+      if (result) {
+        b.length += numberOfAdditionalNeededBlocks * _chunkSize.value();
+      }
+      return result;
+    }
+
+  private:
+    bool reallocateChunks(block &b, size_t n)
     {
       if (internal::reallocator<heap>::isHandledDefault(*this, b, n)) {
         return true;
@@ -202,16 +249,14 @@ namespace alb {
         return true;
       }
       if (b.length > n) {
-        auto context = blockToContext(b);
-        if (context.subIndex + context.usedChunks <= 64) {
-          setWithinSingleRegister<true>(BlockContext(context.registerIndex,
-                                                     context.subIndex + numberOfNewNeededBlocks,
-                                                     context.usedChunks - numberOfNewNeededBlocks));
-        }
-        else {
-          deallocateWithControlRegisterOverlap(
-              BlockContext(context.registerIndex, context.subIndex + numberOfNewNeededBlocks,
-                           context.usedChunks - numberOfNewNeededBlocks));
+        const auto context = blockToContext(b);
+        if (context.usedChunks > numberOfNewNeededBlocks) {
+          // the chunks behind the new end are freed like a block of their own,
+          // that may start in a following register
+          const block tail(static_cast<char *>(b.ptr) +
+                               numberOfNewNeededBlocks * _chunkSize.value(),
+                           (context.usedChunks - numberOfNewNeededBlocks) * _chunkSize.value());
+          freeChunks(blockToContext(tail));
         }
         b.length = numberOfNewNeededBlocks * _chunkSize.value();
         return true;
@@ -219,37 +264,32 @@ namespace alb {
       return internal::reallocateWithCopy(*this, *this, b, n);
     }
 
-    bool expand(block &b, size_t delta)
+    /**
+     * \param scanned Is increased by the number of control registers examined
+     */
+    block allocateChunks(size_t numberOfBlocks, size_t &scanned)
     {
-      if (delta == 0) {
-        return true;
+      if (numberOfBlocks < 64) {
+        auto result = allocateWithinASingleControlRegister(numberOfBlocks, scanned);
+        if (result) {
+          return result;
+        }
       }
-
-      const auto context = blockToContext(b);
-      const auto numberOfAdditionalNeededBlocks = static_cast<int>(
-          internal::roundToAlignment(_chunkSize.value(), delta) / _chunkSize.value());
-
-      if (context.subIndex + context.usedChunks + numberOfAdditionalNeededBlocks <= 64) {
-        if (testAndSetWithinSingleRegister<false>(
-                BlockContext(context.registerIndex, context.subIndex + context.usedChunks,
-                             numberOfAdditionalNeededBlocks))) {
-          b.length += numberOfAdditionalNeededBlocks * _chunkSize.value();
-          return true;
+      else if (numberOfBlocks == 64) {
+        auto result = allocateWithinCompleteControlRegister(numberOfBlocks, scanned);
+        if (result) {
+          return result;
         }
-        return false;
       }
-      else {
-        if (testAndSetOverMultipleRegisters<false>(
-                BlockContext(context.registerIndex, context.subIndex + context.usedChunks,
-                             numberOfAdditionalNeededBlocks))) {
-          b.length += numberOfAdditionalNeededBlocks * _chunkSize.value();
-          return true;
+      else if ((numberOfBlocks % 64) == 0) {
+        auto result = allocateMultipleCompleteControlRegisters(numberOfBlocks, scanned);
+        if (result) {
+          return result;
         }
       }
-      return false;
+      return allocateWithRegisterOverlap(numberOfBlocks, scanned);
     }
 
-  private:
     void init()
     {
       _controlSize = _numberOfChunks.value() / 64;
@@ -279,7 +319,10 @@ namespace alb {
       const auto blockIndex = static_cast<int>(
           (static_cast<char *>(b.ptr) - static_cast<char *>(_buffer.ptr)) / _chunkSize.value());
 
-      return {blockIndex / 64, blockIndex % 64, static_cast<int>(b.length / _chunkSize.value())};
+      // a truncated block frees only the chunks its length covers completely
+      const auto usedChunks = static_cast<int>(b.length / _chunkSize.value());
+
+      return {blockIndex / 64, blockIndex % 64, usedChunks};
     }
 
     template <bool Used> bool testAndSetWithinSingleRegister(const BlockContext &context)
@@ -360,7 +403,7 @@ namespace alb {
           chunksToTest = 0;
         }
         registerIndex++;
-        if (registerIndex > _controlSize) {
+        if (chunksToTest > 0 && registerIndex >= _controlSize) {
           return false;
         }
       } while (chunksToTest > 0);
@@ -384,7 +427,7 @@ namespace alb {
       _control[context.registerIndex] = newRegister;
     }
 
-    block allocateWithinASingleControlRegister(size_t numberOfBlocks)
+    block allocateWithinASingleControlRegister(size_t numberOfBlocks, size_t &scanned)
     {
       // first we have to look for at least one free block
       int controlIndex = 0;
@@ -403,6 +446,7 @@ namespace alb {
 
               _control[controlIndex] = newControlRegister;
 
+              scanned += controlIndex + 1;
               size_t ptrOffset = (controlIndex * 64 + i) * _chunkSize.value();
 
               return {static_cast<char *>(_buffer.ptr) + ptrOffset,
@@ -414,15 +458,17 @@ namespace alb {
         }
         controlIndex++;
       }
+      scanned += _controlSize;
       return {};
     }
 
-    block allocateWithinCompleteControlRegister(size_t numberOfBlocks)
+    block allocateWithinCompleteControlRegister(size_t numberOfBlocks, size_t &scanned)
     {
       // first we have to look for at least full free block
       auto freeChunk = std::find_if(_control, _control + _controlSize,
                                     [this](const uint64_t &v) { return v == (uint64_t)-1; });
 
+      scanned += std::min<size_t>(freeChunk - _control + 1, _controlSize);
       if (freeChunk == _control + _controlSize) {
         return {};
       }
@@ -433,7 +479,7 @@ namespace alb {
       return {static_cast<char *>(_buffer.ptr) + ptrOffset, numberOfBlocks * _chunkSize.value()};
     }
 
-    block allocateMultipleCompleteControlRegisters(size_t numberOfBlocks)
+    block allocateMultipleCompleteControlRegisters(size_t numberOfBlocks, size_t &scanned)
     {
       const auto neededChunks = static_cast<int>(numberOfBlocks / 64);
       auto freeFirstChunk =
@@ -441,8 +487,10 @@ namespace alb {
                         [](uint64_t const &v, uint64_t const &p) { return v == p; });
 
       if (freeFirstChunk == _control + _controlSize) {
+        scanned += _controlSize;
         return {};
       }
+      scanned += freeFirstChunk - _control + neededChunks;
       auto p = freeFirstChunk;
       while (p < freeFirstChunk + neededChunks) {
         *p = 0;
@@ -454,7 +502,7 @@ namespace alb {
                    numberOfBlocks * _chunkSize.value());
     }
 
-    block allocateWithRegisterOverlap(size_t numberOfBlocks)
+    block allocateWithRegisterOverlap(size_t numberOfBlocks, size_t &scanned)
     {
       // search for free area
       auto p = reinterpret_cast<unsigned char *>(_control);
@@ -482,6 +530,10 @@ namespace alb {
         p++;
       };
 
+      scanned += std::min<size_t>((p - reinterpret_cast<unsigned char *>(_control)) /
+                                          sizeof(uint64_t) +
+                                      1,
+                                  _controlSize);
       if (p != lastp && freeBlocksCount >= numberOfBlocks) {
         size_t ptrOffset =
             (chunkStart - reinterpret_cast<unsigned char *>(_control)) * 8 * _chunkSize.value();
@@ -504,6 +556,22 @@ namespace alb {
       }
     }
 
+    void freeChunks(const BlockContext &context)
+    {
+      if (context.usedChunks == 0) {
+        return;
+      }
+      if (context.subIndex + context.usedChunks <= 64) {
+        setWithinSingleRegister<true>(context);
+      }
+      else if (context.subIndex == 0 && (context.usedChunks % 64) == 0) {
+        deallocateForMultipleCompleteControlRegister(context);
+      }
+      else {
+        deallocateWithControlRegisterOverlap(context);
+      }
+    }
+
     void deallocateWithControlRegisterOverlap(const BlockContext &context)
     {
       setOverMultipleRegisters<true>(context);
@@ -0,0 +1,349 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_base.hpp"
+#include "mallocator.hpp"
+
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <utility>
+
+namespace alb {
+
+  namespace internal {
+    /**
+     * Writes the value as LEB128, seven bits per byte
+     * \ingroup group_internal
+     */
+    inline void writeVarint(std::ostream &out, uint64_t value)
+    {
+      do {
+        auto byte = static_cast<unsigned char>(value & 0x7f);
+        value >>= 7;
+        if (value != 0) {
+          byte |= 0x80;
+        }
+        out.put(static_cast<char>(byte));
+      } while (value != 0);
+    }
+
+    inline bool readVarint(std::istream &in, uint64_t &value)
+    {
+      value = 0;
+      for (unsigned shift = 0; shift < 64; shift += 7) {
+        const auto c = in.get();
+        if (c == std::istream::traits_type::eof()) {
+          return false;
+        }
+        value |= static_cast<uint64_t>(c & 0x7f) << shift;
+        if ((c & 0x80) == 0) {
+          return true;
+        }
+      }
+      return false;
+    }
+  }
+
+  /**
+   * A copy of the occupancy of an alb::heap or alb::shared_heap at one moment,
+   * to analyze its fragmentation, e.g. to choose the chunk size or the kind
+   * of allocator from the state of a production system.
+   * The copy is taken by ::copy_control() of the heap, which takes the lock
+   * of the shared_heap, so the state is consistent.
+   * The snapshot can be written to and read from a compact file, that
+   * contains the lengths of the alternating used and free runs of chunks.
+   * The tool HeapSnapshotTool renders such a file as PGM image and prints the
+   * statistics of it.
+   * \tparam Allocator The allocator for the copy of the control bitmap
+   *
+   * \ingroup group_allocators
+   */
+  template <class Allocator = mallocator> class heap_snapshot {
+    Allocator _allocator;
+    block _control;
+    size_t _numberOfChunks;
+    size_t _chunkSize;
+
+    heap_snapshot(const heap_snapshot &) = delete;
+    heap_snapshot &operator=(const heap_snapshot &) = delete;
+
+    static const char *magic()
+    {
+      return "ALBHEAP1";
+    }
+
+    uint64_t *control() const
+    {
+      return static_cast<uint64_t *>(_control.ptr);
+    }
+
+    bool resize(size_t numberOfChunks, size_t chunkSize)
+    {
+      _allocator.deallocate(_control);
+      _numberOfChunks = 0;
+      _chunkSize = 0;
+      if (numberOfChunks > max_number_of_chunks) {
+        return false;
+      }
+      const auto controlSize = numberOfChunks / 64 + (numberOfChunks % 64 != 0 ? 1 : 0);
+      if (controlSize > std::numeric_limits<size_t>::max() / sizeof(uint64_t)) {
+        return false;
+      }
+      if (controlSize > 0) {
+        _control = _allocator.allocate(controlSize * sizeof(uint64_t));
+        if (!_control) {
+          return false;
+        }
+      }
+      _numberOfChunks = numberOfChunks;
+      _chunkSize = chunkSize;
+      return true;
+    }
+
+    void setFree(size_t chunk)
+    {
+      control()[chunk / 64] |= 1uLL << (chunk % 64);
+    }
+
+  public:
+    /**
+     * The number of buckets of ::free_run_histogram()
+     */
+    static const size_t histogram_size = 64;
+
+    /**
+     * The maximum number of chunks, that a snapshot accepts, e.g. from a file
+     */
+    static const uint64_t max_number_of_chunks = std::numeric_limits<uint32_t>::max();
+
+    heap_snapshot()
+      : _numberOfChunks(0)
+      , _chunkSize(0)
+    {
+    }
+
+    /**
+     * Takes the snapshot of the given heap
+     * \param heap An alb::heap or alb::shared_heap
+     */
+    template <class Heap>
+    explicit heap_snapshot(Heap &heap)
+      : _numberOfChunks(0)
+      , _chunkSize(0)
+    {
+      if (resize(heap.number_of_chunk(), heap.chunk_size())) {
+        heap.copy_control(control());
+      }
+    }
+
+    heap_snapshot(heap_snapshot &&x)
+      : _numberOfChunks(0)
+      , _chunkSize(0)
+    {
+      *this = std::move(x);
+    }
+
+    heap_snapshot &operator=(heap_snapshot &&x)
+    {
+      if (this == &x) {
+        return *this;
+      }
+      _allocator.deallocate(_control);
+      _allocator = std::move(x._allocator);
+      _control = x._control;
+      _numberOfChunks = x._numberOfChunks;
+      _chunkSize = x._chunkSize;
+      x._control.reset();
+      x._numberOfChunks = 0;
+      x._chunkSize = 0;
+      return *this;
+    }
+
+    ~heap_snapshot()
+    {
+      _allocator.deallocate(_control);
+    }
+
+    size_t number_of_chunks() const
+    {
+      return _numberOfChunks;
+    }
+
+    size_t chunk_size() const
+    {
+      return _chunkSize;
+    }
+
+    bool is_free(size_t chunk) const
+    {
+      return (control()[chunk / 64] & (1uLL << (chunk % 64))) != 0;
+    }
+
+    size_t free_chunks() const
+    {
+      size_t result = 0;
+      for (size_t i = 0; i < _numberOfChunks / 64; ++i) {
+        result += std::bitset<64>(control()[i]).count();
+      }
+      for (size_t i = _numberOfChunks / 64 * 64; i < _numberOfChunks; ++i) {
+        result += is_free(i) ? 1 : 0;
+      }
+      return result;
+    }
+
+    /**
+     * Calls f(isFree, firstChunk, numberOfChunks) for each maximal run of
+     * free or used chunks in ascending order
+     */
+    template <class F> void for_each_run(F f) const
+    {
+      size_t start = 0;
+      for (size_t i = 1; i <= _numberOfChunks; ++i) {
+        if (i == _numberOfChunks || is_free(i) != is_free(start)) {
+          f(is_free(start), start, i - start);
+          start = i;
+        }
+      }
+    }
+
+    /**
+     * Returns the number of chunks of the biggest request, that the heap
+     * could serve at the moment of the snapshot
+     */
+    size_t largest_free_run() const
+    {
+      size_t result = 0;
+      for_each_run([&result](bool isFree, size_t, size_t length) {
+        if (isFree && length > result) {
+          result = length;
+        }
+      });
+      return result;
+    }
+
+    /**
+     * Counts the free runs by their length. Bucket i counts the runs of
+     * [2^i, 2^(i+1)) chunks.
+     */
+    void free_run_histogram(size_t (&histogram)[histogram_size]) const
+    {
+      std::fill(histogram, histogram + histogram_size, size_t(0));
+      for_each_run([&histogram](bool isFree, size_t, size_t length) {
+        if (isFree) {
+          size_t bucket = 0;
+          while (length > 1) {
+            length >>= 1;
+            ++bucket;
+          }
+          ++histogram[bucket];
+        }
+      });
+    }
+
+    /**
+     * Returns 1 - largest free run / free chunks. It is 0, if all free chunks
+     * are contiguous and approaches 1, if the free memory is scattered into
+     * many small runs.
+     */
+    double fragmentation_index() const
+    {
+      const auto freeChunks = free_chunks();
+      if (freeChunks == 0) {
+        return 0.0;
+      }
+      return 1.0 - static_cast<double>(largest_free_run()) / freeChunks;
+    }
+
+    /**
+     * Writes the snapshot run length encoded: the magic "ALBHEAP1", the number
+     * of chunks, the chunk size and the lengths of the alternating used and
+     * free runs, starting with a used one, all as LEB128 varints.
+     * \return False, if the stream failed
+     */
+    bool write(std::ostream &out) const
+    {
+      out.write(magic(), 8);
+      internal::writeVarint(out, _numberOfChunks);
+      internal::writeVarint(out, _chunkSize);
+      bool expectFree = false;
+      for_each_run([&out, &expectFree](bool isFree, size_t, size_t length) {
+        if (isFree != expectFree) {
+          internal::writeVarint(out, 0);
+        }
+        internal::writeVarint(out, length);
+        expectFree = !isFree;
+      });
+      return out.good();
+    }
+
+    /**
+     * Replaces the content by the one of a stream, that was written by ::write()
+     * \return False, if the stream is not a valid snapshot
+     */
+    bool read(std::istream &in)
+    {
+      char header[8];
+      uint64_t numberOfChunks = 0;
+      uint64_t chunkSize = 0;
+      if (!in.read(header, 8) || !std::equal(header, header + 8, magic()) ||
+          !internal::readVarint(in, numberOfChunks) || !internal::readVarint(in, chunkSize) ||
+          numberOfChunks > max_number_of_chunks || !resize(numberOfChunks, chunkSize)) {
+        return false;
+      }
+      std::fill(control(), control() + (_numberOfChunks + 63) / 64, uint64_t(0));
+
+      size_t chunk = 0;
+      bool isFree = false;
+      while (chunk < _numberOfChunks) {
+        uint64_t length = 0;
+        if (!internal::readVarint(in, length) || length > _numberOfChunks - chunk) {
+          resize(0, 0);
+          return false;
+        }
+        if (isFree) {
+          for (size_t i = chunk; i < chunk + length; ++i) {
+            setFree(i);
+          }
+        }
+        chunk += length;
+        isFree = !isFree;
+      }
+      return true;
+    }
+
+    /**
+     * Writes the occupancy as binary PGM image, one pixel per chunk, with
+     * free chunks white and used ones black.
+     * \param width The number of chunks per row
+     * \return False, if the stream failed
+     */
+    bool write_pgm(std::ostream &out, size_t width = 64) const
+    {
+      if (width == 0) {
+        return false;
+      }
+      const auto height = (_numberOfChunks + width - 1) / width;
+      out << "P5\n" << width << " " << height << "\n255\n";
+      for (size_t i = 0; i < width * height; ++i) {
+        // the padding of the last row is gray
+        out.put(static_cast<char>(i >= _numberOfChunks ? 128 : (is_free(i) ? 255 : 0)));
+      }
+      return out.good();
+    }
+  };
+
+  template <class Allocator> const size_t heap_snapshot<Allocator>::histogram_size;
+  template <class Allocator> const uint64_t heap_snapshot<Allocator>::max_number_of_chunks;
+}
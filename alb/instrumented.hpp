@@ -0,0 +1,430 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_base.hpp"
+#include "bucketizer.hpp"
+#include "cascading_allocator.hpp"
+#include "fallback_allocator.hpp"
+#include "freelist.hpp"
+#include "internal/reallocator.hpp"
+#include "internal/traits.hpp"
+#include "segregator.hpp"
+
+#include <boost/core/demangle.hpp>
+#include <algorithm>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+
+namespace alb {
+  /**
+   * The counters of one layer of an instrumented composition. The layers form
+   * a tree, that mirrors the composition: e.g. the layer of a segregator has
+   * the layers of its small and its large allocator as children.
+   * A miss is an allocation request, that the layer could not serve, so it
+   * spilled over to the next layer, e.g. from the primary to the fallback
+   * allocator. A spill is a served request, for that at least one of the
+   * layers below missed before.
+   *
+   * \ingroup group_allocators
+   */
+  class layer_statistics {
+    const std::type_info &_type;
+    layer_statistics *_parent;
+    layer_statistics *_firstChild;
+    layer_statistics *_nextSibling;
+
+    template <class Allocator> friend class counting_layer;
+    template <class Allocator> friend class layer_base;
+
+    explicit layer_statistics(const std::type_info &type)
+      : _type(type)
+      , _parent(nullptr)
+      , _firstChild(nullptr)
+      , _nextSibling(nullptr)
+      , hits(0)
+      , misses(0)
+      , spills(0)
+      , deallocations(0)
+      , reallocations(0)
+      , expansions(0)
+      , smallest(std::numeric_limits<size_t>::max())
+      , largest(0)
+    {
+    }
+
+    layer_statistics(const layer_statistics &) = delete;
+    layer_statistics &operator=(const layer_statistics &) = delete;
+
+    void attach(layer_statistics *parent)
+    {
+      _parent = parent;
+      if (parent == nullptr) {
+        return;
+      }
+      // appended, so that the children are in the order of the composition
+      auto p = &parent->_firstChild;
+      while (*p != nullptr) {
+        p = &(*p)->_nextSibling;
+      }
+      *p = this;
+    }
+
+    void detach()
+    {
+      if (_parent == nullptr) {
+        return;
+      }
+      auto p = &_parent->_firstChild;
+      while (*p != this) {
+        p = &(*p)->_nextSibling;
+      }
+      *p = _nextSibling;
+      _parent = nullptr;
+      _nextSibling = nullptr;
+    }
+
+  public:
+    size_t hits;
+    size_t misses;
+    size_t spills;
+    size_t deallocations;
+    size_t reallocations;
+    size_t expansions;
+    // the smallest and the largest served request
+    size_t smallest;
+    size_t largest;
+
+    /**
+     * Returns the name of the allocator of this layer without its template
+     * arguments, e.g. "alb::freelist"
+     */
+    std::string name() const
+    {
+      auto result = boost::core::demangle(_type.name());
+      return result.substr(0, result.find('<'));
+    }
+
+    const layer_statistics *parent() const
+    {
+      return _parent;
+    }
+
+    const layer_statistics *first_child() const
+    {
+      return _firstChild;
+    }
+
+    const layer_statistics *next_sibling() const
+    {
+      return _nextSibling;
+    }
+  };
+
+  namespace internal {
+    struct layer_context {
+      // the layer, that is currently constructed or allocating
+      layer_statistics *current;
+      // the number of misses of all layers of this thread
+      size_t misses;
+    };
+
+    inline layer_context &layerContext()
+    {
+      thread_local layer_context context = {nullptr, 0};
+      return context;
+    }
+  }
+
+  /**
+   * Owns the statistics of a alb::counting_layer. As first base class it is
+   * constructed before the wrapped allocator, so all layers, that are
+   * constructed inside of the allocator, become its children.
+   *
+   * \ingroup group_internal
+   */
+  template <class Allocator> class layer_base {
+    layer_base(const layer_base &) = delete;
+    layer_base &operator=(const layer_base &) = delete;
+
+  protected:
+    layer_statistics *_statistics;
+
+    layer_base()
+      : _statistics(new layer_statistics(typeid(Allocator)))
+    {
+      auto &context = internal::layerContext();
+      _statistics->attach(context.current);
+      context.current = _statistics;
+    }
+
+    layer_base(layer_base &&x)
+      : _statistics(x._statistics)
+    {
+      x._statistics = nullptr;
+    }
+
+    // The statistics of x keep their place in the tree
+    layer_base &operator=(layer_base &&x)
+    {
+      if (this != &x) {
+        releaseStatistics();
+        _statistics = x._statistics;
+        x._statistics = nullptr;
+      }
+      return *this;
+    }
+
+    ~layer_base()
+    {
+      releaseStatistics();
+    }
+
+    void releaseStatistics()
+    {
+      if (_statistics == nullptr) {
+        return;
+      }
+      auto &context = internal::layerContext();
+      if (context.current == _statistics) {
+        // the construction of the allocator has failed
+        context.current = _statistics->_parent;
+      }
+      _statistics->detach();
+      delete _statistics;
+      _statistics = nullptr;
+    }
+
+    void constructionFinished()
+    {
+      internal::layerContext().current = _statistics->_parent;
+    }
+  };
+
+  /**
+   * This allocator counts the requests to the Allocator, that it wraps, in its
+   * alb::layer_statistics. Its allocations are not altered in any way. All
+   * further operations of the Allocator, e.g. setMinMax() of a alb::freelist,
+   * are inherited, so it can be used as bucket in a alb::bucketizer.
+   * Usually it is not used directly, but via alb::instrumented.
+   * The counters are not synchronized, so shared compositions should only be
+   * instrumented for profiling by a single thread.
+   * \tparam Allocator The allocator, that shall be counted
+   *
+   * \ingroup group_allocators
+   */
+  template <class Allocator>
+  class counting_layer : layer_base<Allocator>, public Allocator {
+    using layer_base<Allocator>::_statistics;
+
+  public:
+    static const bool supports_truncated_deallocation =
+        Allocator::supports_truncated_deallocation;
+
+    using allocator = Allocator;
+
+    counting_layer()
+    {
+      layer_base<Allocator>::constructionFinished();
+    }
+
+    counting_layer(counting_layer &&x)
+      : layer_base<Allocator>(std::move(x))
+      , Allocator(std::move(x))
+    {
+    }
+
+    counting_layer &operator=(counting_layer &&x)
+    {
+      layer_base<Allocator>::operator=(std::move(x));
+      Allocator::operator=(std::move(x));
+      return *this;
+    }
+
+    /**
+     * Returns the counters of this layer and, via its children, of all layers
+     * below
+     */
+    const layer_statistics &statistics() const
+    {
+      return *_statistics;
+    }
+
+    block allocate(size_t n)
+    {
+      auto &context = internal::layerContext();
+      const auto missesBefore = context.misses;
+
+      // layers, that are created on demand, e.g. by a alb::cascading_allocator,
+      // become children of this layer
+      const auto outer = context.current;
+      context.current = _statistics;
+      auto result = Allocator::allocate(n);
+      context.current = outer;
+
+      if (result) {
+        ++_statistics->hits;
+        if (context.misses != missesBefore) {
+          ++_statistics->spills;
+        }
+        _statistics->smallest = std::min(_statistics->smallest, n);
+        _statistics->largest = std::max(_statistics->largest, n);
+      }
+      else {
+        ++_statistics->misses;
+        ++context.misses;
+      }
+      return result;
+    }
+
+    void deallocate(block &b)
+    {
+      if (b) {
+        ++_statistics->deallocations;
+      }
+      Allocator::deallocate(b);
+    }
+
+    bool reallocate(block &b, size_t n)
+    {
+      ++_statistics->reallocations;
+      return Allocator::reallocate(b, n);
+    }
+
+    template <typename U = Allocator>
+    typename std::enable_if<traits::has_expand<U>::value, bool>::type expand(block &b,
+                                                                            size_t delta)
+    {
+      if (Allocator::expand(b, delta)) {
+        ++_statistics->expansions;
+        return true;
+      }
+      return false;
+    }
+
+    template <typename U = Allocator>
+    typename std::enable_if<traits::has_owns<U>::value, bool>::type owns(const block &b) const
+    {
+      return Allocator::owns(b);
+    }
+
+    template <typename U = Allocator>
+    typename std::enable_if<traits::has_goodSize<U>::value, size_t>::type
+    goodSize(const block &b) const
+    {
+      return Allocator::goodSize(b);
+    }
+
+    template <typename U = Allocator>
+    typename std::enable_if<traits::has_deallocateAll<U>::value, void>::type deallocateAll()
+    {
+      Allocator::deallocateAll();
+    }
+  };
+
+  template <class Allocator>
+  const bool counting_layer<Allocator>::supports_truncated_deallocation;
+
+  namespace traits {
+    // Two layers share a base only if the counted allocators do
+    template <class A1, class A2>
+    struct both_same_base<counting_layer<A1>, counting_layer<A2>> : both_same_base<A1, A2> {
+    };
+  }
+
+  /**
+   * Transforms a composition at compile time, so that every sub-allocator is
+   * wrapped by a alb::counting_layer: both branches of a alb::segregator,
+   * each bucket of a alb::bucketizer, primary and fallback of a
+   * alb::fallback_allocator, each node of a cascading allocator and the
+   * parent allocator of a freelist. All other allocators are leaves.
+   * E.g. instrument<segregator<64, A, B>>::type is
+   *   counting_layer<segregator<64, counting_layer<A>, counting_layer<B>>>
+   * \tparam Allocator The composition, that shall be instrumented
+   *
+   * \ingroup group_allocators
+   */
+  template <class Allocator> struct instrument {
+    using type = counting_layer<Allocator>;
+  };
+
+  template <class Allocator> using instrumented = typename instrument<Allocator>::type;
+
+  template <size_t Threshold, class SmallAllocator, class LargeAllocator>
+  struct instrument<segregator<Threshold, SmallAllocator, LargeAllocator>> {
+    using type = counting_layer<
+        segregator<Threshold, instrumented<SmallAllocator>, instrumented<LargeAllocator>>>;
+  };
+
+  template <class Primary, class Fallback>
+  struct instrument<fallback_allocator<Primary, Fallback>> {
+    using type = counting_layer<fallback_allocator<instrumented<Primary>, instrumented<Fallback>>>;
+  };
+
+  template <class Allocator, unsigned MinSize, unsigned MaxSize, unsigned StepSize>
+  struct instrument<bucketizer<Allocator, MinSize, MaxSize, StepSize>> {
+    using type = counting_layer<bucketizer<instrumented<Allocator>, MinSize, MaxSize, StepSize>>;
+  };
+
+  template <class Allocator> struct instrument<cascading_allocator<Allocator>> {
+    using type = counting_layer<cascading_allocator<instrumented<Allocator>>>;
+  };
+
+  template <class Allocator> struct instrument<shared_cascading_allocator<Allocator>> {
+    using type = counting_layer<shared_cascading_allocator<instrumented<Allocator>>>;
+  };
+
+  template <class Allocator, size_t MinSize, size_t MaxSize, size_t PoolSize,
+            size_t NumberOfBatchAllocations>
+  struct instrument<freelist<Allocator, MinSize, MaxSize, PoolSize, NumberOfBatchAllocations>> {
+    using type = counting_layer<freelist<instrumented<Allocator>, MinSize, MaxSize, PoolSize,
+                                         NumberOfBatchAllocations>>;
+  };
+
+  template <class Allocator, size_t MinSize, size_t MaxSize, size_t PoolSize,
+            size_t NumberOfBatchAllocations, bool CountFreeBlocks>
+  struct instrument<shared_freelist<Allocator, MinSize, MaxSize, PoolSize,
+                                    NumberOfBatchAllocations, CountFreeBlocks>> {
+    using type = counting_layer<shared_freelist<instrumented<Allocator>, MinSize, MaxSize,
+                                                PoolSize, NumberOfBatchAllocations,
+                                                CountFreeBlocks>>;
+  };
+
+  /**
+   * Calls f(layer, depth) for the given layer and all layers below in depth
+   * first order. The given layer has the depth 0.
+   */
+  template <class F>
+  void for_each_layer(const layer_statistics &layer, F f, size_t depth = 0)
+  {
+    f(layer, depth);
+    for (auto child = layer.first_child(); child != nullptr; child = child->next_sibling()) {
+      for_each_layer(*child, f, depth + 1);
+    }
+  }
+
+  /**
+   * Prints the counters of the given layer and all layers below as indented
+   * tree, one layer per line
+   */
+  inline void print_layers(std::ostream &out, const layer_statistics &layer)
+  {
+    for_each_layer(layer, [&out](const layer_statistics &l, size_t depth) {
+      out << std::string(2 * depth, ' ') << l.name() << ": hits " << l.hits << ", misses "
+          << l.misses << ", spills " << l.spills << ", deallocations " << l.deallocations;
+      if (l.hits > 0) {
+        out << ", sizes [" << l.smallest << ", " << l.largest << "]";
+      }
+      out << "\n";
+    });
+  }
+}
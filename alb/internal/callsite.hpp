@@ -0,0 +1,91 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <boost/functional/hash.hpp>
+#include <cstring>
+#include <type_traits>
+
+namespace alb {
+  namespace internal {
+
+    /**
+     * Returns a hash of the contents of the file and function name and of the
+     * line of a call site, as they are passed by the ALLOCATE macro. So equal
+     * string literals of different translation units give the same hash.
+     *
+     * \ingroup group_internal
+     */
+    inline size_t callsiteHash(const char *file, const char *function, int line)
+    {
+      size_t result = 0;
+      if (file != nullptr) {
+        boost::hash_range(result, file, file + ::strlen(file));
+      }
+      if (function != nullptr) {
+        boost::hash_range(result, function, function + ::strlen(function));
+      }
+      boost::hash_combine(result, line);
+      return result;
+    }
+
+    /**
+     * Caches a value per call site by the pointers of its names and its line,
+     * so that the names must only be read, when a call site is not cached.
+     * Entries of colliding call sites replace each other. A call site without
+     * any name is never cached.
+     * \tparam T The cached value
+     * \tparam Size The number of entries
+     *
+     * \ingroup group_internal
+     */
+    template <typename T, size_t Size> class callsite_cache {
+      static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+
+      struct entry {
+        const char *file;
+        const char *function;
+        int line;
+        T value;
+      };
+
+      entry _entries[Size];
+
+    public:
+      callsite_cache()
+      {
+        ::memset(_entries, 0, sizeof(_entries));
+      }
+
+      /**
+       * Returns the cached value of the call site. If it is not cached, the
+       * value is computed by compute(file, function, line) and cached.
+       */
+      template <typename Compute>
+      T lookup(const char *file, const char *function, int line, Compute compute)
+      {
+        size_t slot = 0;
+        boost::hash_combine(slot, file);
+        boost::hash_combine(slot, function);
+        boost::hash_combine(slot, line);
+        auto &e = _entries[slot % Size];
+        if (e.file == file && e.function == function && e.line == line &&
+            (file != nullptr || function != nullptr)) {
+          return e.value;
+        }
+        e.value = compute(file, function, line);
+        e.file = file;
+        e.function = function;
+        e.line = line;
+        return e.value;
+      }
+    };
+  }
+}
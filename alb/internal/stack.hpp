@@ -64,6 +64,11 @@ namespace alb {
       {
         return _pos == -1;
       }
+
+      size_t size() const
+      {
+        return static_cast<size_t>(_pos + 1);
+      }
     };
   }
 }
\ No newline at end of file
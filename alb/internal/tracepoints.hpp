@@ -0,0 +1,58 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+/**
+ * Static tracepoints on the hot paths of the allocators. If ALB_TRACEPOINTS
+ * is defined, each ALB_TRACEn() is a USDT probe of the provider "alb" by the
+ * header only <sys/sdt.h> (systemtap-sdt-dev). Such a probe is a single nop
+ * with a note section entry that describes the location of its arguments.
+ * perf or bpftrace replace the nop by a breakpoint when attached, e.g.
+ *
+ *   bpftrace -e 'usdt:./app:alb:heap_scan { @[arg2] = count(); }'
+ *
+ * Without ALB_TRACEPOINTS the macros vanish completely. The arguments are
+ * only named in an unevaluated sizeof, so variables kept for a probe do not
+ * cause warnings. They must not have side effects.
+ *
+ * All probes pass the address of the allocator instance as first argument,
+ * so the layers of a composition can be told apart. A failed reallocate
+ * reports a null ptr:
+ *   allocate(layer, n, ptr)           deallocate(layer, ptr, length)
+ *   reallocate(layer, old, n, ptr)    expand(layer, ptr, delta, success)
+ *   freelist_miss(layer, n)           freelist_refill(layer, blocks)
+ *   heap_scan(layer, chunks, scanned_control_registers)
+ *   cascading_new_node(layer, node)   fallback_spill(layer, n)
+ *
+ * \ingroup group_internal
+ */
+
+#ifdef ALB_TRACEPOINTS
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define ALB_HAS_SDT 1
+#endif
+#endif
+#ifndef ALB_HAS_SDT
+#error "ALB_TRACEPOINTS needs <sys/sdt.h>, e.g. from the package systemtap-sdt-dev"
+#endif
+#endif
+
+#ifdef ALB_HAS_SDT
+#define ALB_TRACE2(name, a1, a2) STAP_PROBE2(alb, name, a1, a2)
+#define ALB_TRACE3(name, a1, a2, a3) STAP_PROBE3(alb, name, a1, a2, a3)
+#define ALB_TRACE4(name, a1, a2, a3, a4) STAP_PROBE4(alb, name, a1, a2, a3, a4)
+#else
+#define ALB_TRACE2(name, a1, a2) ((void)sizeof(((void)(a1), (void)(a2), 0)))
+#define ALB_TRACE3(name, a1, a2, a3) ((void)sizeof(((void)(a1), (void)(a2), (void)(a3), 0)))
+#define ALB_TRACE4(name, a1, a2, a3, a4)                                                         \
+  ((void)sizeof(((void)(a1), (void)(a2), (void)(a3), (void)(a4), 0)))
+#endif
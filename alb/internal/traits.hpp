@@ -76,6 +76,42 @@ namespace alb {
       static const bool value = (sizeof(func<T>(nullptr)) == sizeof(Yes));
     };
 
+    /**
+     * Trait that checks if the given class implements size_t goodSize(const Block&) const
+     *
+     * \ingroup group_traits
+     */
+    template <typename T> struct has_goodSize {
+    private:
+      typedef char Yes;
+      struct No {
+        char dummy[2];
+      };
+
+      template <typename U, size_t (U::*)(const block &) const> struct Check;
+      template <typename U> static Yes func(Check<U, &U::goodSize> *);
+      template <typename U> static No func(...);
+
+    public:
+      static const bool value = (sizeof(func<T>(nullptr)) == sizeof(Yes));
+    };
+
+    /**
+     * Trait that checks if ::reallocate() of the given class always shrinks a
+     * block in place, so that its content is never copied bytewise. A class
+     * states this by static const bool shrinks_in_place = true.
+     *
+     * \ingroup group_traits
+     */
+    template <typename T> struct shrinks_in_place {
+    private:
+      template <typename U> static std::integral_constant<bool, U::shrinks_in_place> func(int);
+      template <typename U> static std::false_type func(...);
+
+    public:
+      static const bool value = decltype(func<T>(0))::value;
+    };
+
     /**
      * This traits returns true if both passed types have the same type, resp.
      * template base type
@@ -136,6 +172,13 @@ namespace alb {
         : std::true_type {
     };
 
+    template <template <class, size_t, size_t, size_t, size_t, bool> class Allocator, class A1,
+              size_t P1, size_t P2, size_t P3, size_t P4, bool B1, class A2, size_t P5, size_t P6,
+              size_t P7, size_t P8, bool B2>
+    struct both_same_base<Allocator<A1, P1, P2, P3, P4, B1>, Allocator<A2, P5, P6, P7, P8, B2>>
+        : std::true_type {
+    };
+
     /**
     * This class implements or hides, depending on the Allocators properties, the
     * expand operation.
@@ -185,6 +228,47 @@ namespace alb {
       }
     };
 
+    /**
+    * This class implements or hides, depending on the Allocators properties, the
+    * goodSize operation. Without it, a block covers just its passed length.
+    *
+    * \ingroup group_traits
+    */
+    template <class Allocator, typename Enabled = void> struct GoodSizer;
+
+    template <class Allocator>
+    struct GoodSizer<Allocator, typename std::enable_if<has_goodSize<Allocator>::value>::type> {
+      static size_t doIt(const Allocator &a, const block &b)
+      {
+        return a.goodSize(b);
+      }
+    };
+
+    template <class Allocator>
+    struct GoodSizer<Allocator, typename std::enable_if<!has_goodSize<Allocator>::value>::type> {
+      template <class Block> static size_t doIt(const Allocator &, const Block &b)
+      {
+        return b.length;
+      }
+    };
+
+    /**
+     * Trait that provides the alignment, that the given allocator guarantees
+     * for the start of every allocated block. It is 1, if the allocator does
+     * not define a static member alignment.
+     *
+     * \ingroup group_traits
+     */
+    template <class Allocator, typename Enabled = void> struct guaranteed_alignment {
+      static const size_t value = 1;
+    };
+
+    template <class Allocator>
+    struct guaranteed_alignment<Allocator,
+                                typename std::enable_if<(Allocator::alignment > 0)>::type> {
+      static const size_t value = Allocator::alignment;
+    };
+
     /**
      * traits that defines "type" A or B depending on the passed bool
      * \tparam A This type is defined if the bool is true
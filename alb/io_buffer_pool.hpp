@@ -0,0 +1,186 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_base.hpp"
+#include "aligned_mallocator.hpp"
+#include "heap.hpp"
+
+#include <array>
+#include <new>
+#include <sys/uio.h>
+
+namespace alb {
+
+  /**
+   * Describes a buffer of the alb::io_buffer_pool. The index is the position
+   * of its first buffer within the pool, so it can be used as buffer index
+   * for fixed buffer operations, e.g. io_uring_prep_read_fixed().
+   *
+   * \ingroup group_allocators
+   */
+  struct io_buffer {
+    io_buffer()
+      : index(0)
+    {
+    }
+
+    io_buffer(size_t index, const block &memory)
+      : index(index)
+      , memory(memory)
+    {
+    }
+
+    explicit operator bool() const
+    {
+      return static_cast<bool>(memory);
+    }
+
+    /// The index of the first buffer of the pool that is covered
+    size_t index;
+
+    /// The memory of the buffer
+    block memory;
+  };
+
+  /**
+   * The io_buffer_pool provides buffers that are aligned to the Alignment,
+   * e.g. 4kB, as it is needed for I/O with O_DIRECT. All buffers are taken
+   * out of a single region that is allocated once, so the buffers can be
+   * registered once for the lifetime of the pool, e.g. as io_uring fixed
+   * buffers:
+   *   - iovecs() describes each buffer of the pool, the index of an
+   *     alb::io_buffer refers to them. Blocks that span more than one buffer
+   *     cannot be used for fixed buffer operations this way.
+   *   - region() describes the complete region, all blocks can be used for
+   *     fixed buffer operations with the index 0.
+   * The buffers are managed by a Heap, that may span multiple consecutive
+   * buffers for requests bigger than BufferSize. The pool is as far thread
+   * safe as the Heap is, e.g. alb::shared_heap.
+   * If the region cannot be allocated, the construction fails with
+   * std::bad_alloc, so a pool never describes buffers it does not have.
+   * This allocator is only available on POSIX systems.
+   * \tparam BufferSize The size of a single buffer, a multiple of Alignment
+   * \tparam NumberOfBuffers The number of buffers, a multiple of 64
+   * \tparam Alignment The alignment of the region and so of all buffers
+   * \tparam Heap The heap template that manages the buffers
+   *
+   * \ingroup group_allocators
+   */
+  template <size_t BufferSize = 4096, size_t NumberOfBuffers = 64, size_t Alignment = 4096,
+            template <class, size_t, size_t> class Heap = heap>
+  class io_buffer_pool {
+    static_assert(BufferSize % Alignment == 0, "The buffer size must be a multiple of the alignment!");
+    static_assert(NumberOfBuffers % 64 == 0, "The number of buffers must be a multiple of 64!");
+
+    Heap<aligned_mallocator<Alignment>, NumberOfBuffers, BufferSize> _heap;
+    std::array<iovec, NumberOfBuffers> _iovecs;
+
+    io_buffer_pool(const io_buffer_pool &) = delete;
+    io_buffer_pool &operator=(const io_buffer_pool &) = delete;
+
+  public:
+    static const size_t buffer_size = BufferSize;
+    static const size_t number_of_buffers = NumberOfBuffers;
+    static const size_t alignment = Alignment;
+
+    io_buffer_pool()
+    {
+      if (!_heap.buffer()) {
+        throw std::bad_alloc();
+      }
+      auto p = static_cast<char *>(_heap.buffer().ptr);
+      for (size_t i = 0; i < NumberOfBuffers; ++i) {
+        _iovecs[i].iov_base = p + i * BufferSize;
+        _iovecs[i].iov_len = BufferSize;
+      }
+    }
+
+    /**
+     * Allocates n bytes, rounded up to a multiple of the BufferSize
+     * \param n The number of requested bytes
+     * \return The buffer index and the memory or an empty buffer if the pool
+     *         is exhausted
+     */
+    io_buffer allocate(size_t n)
+    {
+      auto b = _heap.allocate(n);
+      if (!b) {
+        return {};
+      }
+      return {index_of(b), b};
+    }
+
+    /**
+     * Returns the buffer to the pool and resets it
+     */
+    void deallocate(io_buffer &b)
+    {
+      _heap.deallocate(b.memory);
+      b.index = 0;
+    }
+
+    /**
+     * Returns the block to the pool and resets it
+     */
+    void deallocate(block &b)
+    {
+      _heap.deallocate(b);
+    }
+
+    /**
+     * Checks the ownership of the given block
+     */
+    bool owns(const block &b) const
+    {
+      return _heap.owns(b);
+    }
+
+    /**
+     * Returns the index of the first buffer that is covered by the given block.
+     * The behavior is undefined, if the block is not owned by this pool.
+     */
+    size_t index_of(const block &b) const
+    {
+      return (static_cast<char *>(b.ptr) - static_cast<char *>(_heap.buffer().ptr)) / BufferSize;
+    }
+
+    /**
+     * Returns the description of all buffers of the pool. It is intended to be
+     * registered once, e.g. by io_uring_register_buffers(), the buffer index
+     * corresponds to alb::io_buffer::index.
+     */
+    const iovec *iovecs() const
+    {
+      return _iovecs.data();
+    }
+
+    /**
+     * Returns the description of the complete region of all buffers
+     */
+    iovec region() const
+    {
+      iovec result;
+      result.iov_base = _heap.buffer().ptr;
+      result.iov_len = _heap.buffer().length;
+      return result;
+    }
+  };
+
+  template <size_t BufferSize, size_t NumberOfBuffers, size_t Alignment,
+            template <class, size_t, size_t> class Heap>
+  const size_t io_buffer_pool<BufferSize, NumberOfBuffers, Alignment, Heap>::buffer_size;
+  template <size_t BufferSize, size_t NumberOfBuffers, size_t Alignment,
+            template <class, size_t, size_t> class Heap>
+  const size_t io_buffer_pool<BufferSize, NumberOfBuffers, Alignment, Heap>::number_of_buffers;
+  template <size_t BufferSize, size_t NumberOfBuffers, size_t Alignment,
+            template <class, size_t, size_t> class Heap>
+  const size_t io_buffer_pool<BufferSize, NumberOfBuffers, Alignment, Heap>::alignment;
+}
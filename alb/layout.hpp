@@ -0,0 +1,461 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_base.hpp"
+#include "internal/traits.hpp"
+
+#include <boost/assert.hpp>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+
+namespace alb {
+
+  /**
+   * Describes one array of a layout of several arrays that share one block.
+   * The member ptr is set by alb::allocate_layout and alb::reallocate_layout.
+   * \ingroup group_allocators
+   */
+  struct layout_item {
+    /// The size of a single element, e.g. sizeof(T)
+    size_t element_size;
+    /// The alignment of the first element, must be a power of two
+    size_t alignment;
+    /// The number of elements
+    size_t count;
+    /// Points to the first element, after the layout was allocated
+    void *ptr;
+  };
+
+  namespace internal {
+
+    /**
+     * Returns the biggest alignment of all items
+     * \ingroup group_internal
+     */
+    inline size_t layoutAlignment(const layout_item *first, const layout_item *last)
+    {
+      size_t result = 1;
+      for (; first != last; ++first) {
+        result = std::max(result, first->alignment);
+      }
+      return result;
+    }
+
+    /**
+     * Calculates the offset of each item relative to a base that is aligned
+     * to the layout alignment and returns the number of bytes of the layout.
+     * \param counts The element counts, that shall be used instead of the
+     *               item counts.
+     * \ingroup group_internal
+     */
+    inline size_t layoutOffsets(const layout_item *first, const layout_item *last,
+                                const size_t *counts, size_t *offsets)
+    {
+      size_t result = 0;
+      for (; first != last; ++first, ++counts, ++offsets) {
+        *offsets = roundToAlignment(first->alignment, result);
+        result = *offsets + first->element_size * *counts;
+      }
+      return result;
+    }
+
+    /**
+     * Returns the number of bytes that must be allocated for a layout of
+     * the given size, so that its base can be aligned inside the block.
+     * \ingroup group_internal
+     */
+    inline size_t layoutBlockSize(size_t layoutSize, size_t alignment)
+    {
+      return layoutSize == 0 ? 0 : layoutSize + alignment - 1;
+    }
+
+    /**
+     * Moves the content of all items inside the same block to the new offsets.
+     * The items that move to higher addresses are shifted starting with the
+     * last one and then all that move to lower addresses starting with the
+     * first one, so no content is overwritten before it was moved.
+     * \ingroup group_internal
+     */
+    inline void shiftLayout(char *base, layout_item *first, layout_item *last,
+                            const size_t *newCounts, const size_t *newOffsets)
+    {
+      const auto n = static_cast<size_t>(last - first);
+      for (size_t i = n; i-- > 0;) {
+        auto newPtr = base + newOffsets[i];
+        if (first[i].ptr != nullptr && newPtr > first[i].ptr) {
+          ::memmove(newPtr, first[i].ptr,
+                    first[i].element_size * std::min(first[i].count, newCounts[i]));
+        }
+      }
+      for (size_t i = 0; i < n; ++i) {
+        auto newPtr = base + newOffsets[i];
+        if (first[i].ptr != nullptr && newPtr < first[i].ptr) {
+          ::memmove(newPtr, first[i].ptr,
+                    first[i].element_size * std::min(first[i].count, newCounts[i]));
+        }
+        first[i].ptr = newPtr;
+        first[i].count = newCounts[i];
+      }
+    }
+
+    template <size_t N> struct layout_buffer {
+      std::array<size_t, N> counts;
+      std::array<size_t, N> offsets;
+    };
+  }
+
+  /**
+   * Allocates with a single allocation all arrays described by the items.
+   * Each array starts at its requested alignment. On success the ptr member of
+   * all items is set.
+   * \param allocator Any allocator of this library
+   * \param items The description of all arrays of the layout
+   * \return The block that must be used for the deallocation
+   *
+   * \ingroup group_allocators
+   */
+  template <class Allocator, size_t N>
+  block allocate_layout(Allocator &allocator, std::array<layout_item, N> &items)
+  {
+    internal::layout_buffer<N> buffer;
+    for (size_t i = 0; i < N; ++i) {
+      buffer.counts[i] = items[i].count;
+    }
+    const auto alignment = internal::layoutAlignment(items.data(), items.data() + N);
+    const auto size = internal::layoutOffsets(items.data(), items.data() + N,
+                                              buffer.counts.data(), buffer.offsets.data());
+
+    auto result = allocator.allocate(internal::layoutBlockSize(size, alignment));
+    if (!result) {
+      return result;
+    }
+    auto base = internal::alignUp(static_cast<char *>(result.ptr), alignment);
+    for (size_t i = 0; i < N; ++i) {
+      items[i].ptr = base + buffer.offsets[i];
+    }
+    return result;
+  }
+
+  /**
+   * Changes the element counts of all arrays of an allocated layout. If the
+   * block is big enough or it can be expanded in place, then the arrays are
+   * shifted inside the block. Otherwise a new block is allocated and
+   * min(old count, new count) elements of each array are copied. The content
+   * is moved bytewise, so the element types must be trivially copyable.
+   * \param allocator The allocator that allocated b
+   * \param b The block of the layout
+   * \param items The items as they were set by the last allocation
+   * \param newCounts The new number of elements per item
+   * \return True, if the operation was successful
+   *
+   * \ingroup group_allocators
+   */
+  template <class Allocator, size_t N>
+  bool reallocate_layout(Allocator &allocator, block &b, std::array<layout_item, N> &items,
+                         const std::array<size_t, N> &newCounts)
+  {
+    if (!b) {
+      for (size_t i = 0; i < N; ++i) {
+        items[i].count = newCounts[i];
+      }
+      b = allocate_layout(allocator, items);
+      return static_cast<bool>(b);
+    }
+
+    internal::layout_buffer<N> buffer;
+    buffer.counts = newCounts;
+    const auto alignment = internal::layoutAlignment(items.data(), items.data() + N);
+    const auto size = internal::layoutOffsets(items.data(), items.data() + N,
+                                              buffer.counts.data(), buffer.offsets.data());
+    const auto neededLength = internal::layoutBlockSize(size, alignment);
+
+    if (neededLength <= b.length ||
+        traits::Expander<Allocator>::doIt(allocator, b, neededLength - b.length)) {
+      auto base = internal::alignUp(static_cast<char *>(b.ptr), alignment);
+      internal::shiftLayout(base, items.data(), items.data() + N, buffer.counts.data(),
+                            buffer.offsets.data());
+      return true;
+    }
+
+    auto newBlock = allocator.allocate(neededLength);
+    if (!newBlock) {
+      return false;
+    }
+    auto base = internal::alignUp(static_cast<char *>(newBlock.ptr), alignment);
+    for (size_t i = 0; i < N; ++i) {
+      auto newPtr = base + buffer.offsets[i];
+      ::memcpy(newPtr, items[i].ptr,
+               items[i].element_size * std::min(items[i].count, newCounts[i]));
+      items[i].ptr = newPtr;
+      items[i].count = newCounts[i];
+    }
+    allocator.deallocate(b);
+    b = newBlock;
+    return true;
+  }
+
+  /**
+   * Changes the element counts of all arrays of an allocated layout, but only
+   * if this is possible without moving the block. This is only available if
+   * the allocator implements ::expand().
+   * \return True, if the operation was successful
+   *
+   * \ingroup group_allocators
+   */
+  template <class Allocator, size_t N>
+  typename std::enable_if<traits::has_expand<Allocator>::value, bool>::type
+  expand_layout(Allocator &allocator, block &b, std::array<layout_item, N> &items,
+                const std::array<size_t, N> &newCounts)
+  {
+    if (!b) {
+      return false;
+    }
+    internal::layout_buffer<N> buffer;
+    buffer.counts = newCounts;
+    const auto alignment = internal::layoutAlignment(items.data(), items.data() + N);
+    const auto size = internal::layoutOffsets(items.data(), items.data() + N,
+                                              buffer.counts.data(), buffer.offsets.data());
+    const auto neededLength = internal::layoutBlockSize(size, alignment);
+
+    if (neededLength > b.length && !allocator.expand(b, neededLength - b.length)) {
+      return false;
+    }
+    auto base = internal::alignUp(static_cast<char *>(b.ptr), alignment);
+    internal::shiftLayout(base, items.data(), items.data() + N, buffer.counts.data(),
+                          buffer.offsets.data());
+    return true;
+  }
+
+  /**
+   * Simple view on a contiguous array of elements
+   * \ingroup group_allocators
+   */
+  template <typename T> class span {
+    T *_data;
+    size_t _size;
+
+  public:
+    using value_type = T;
+    using iterator = T *;
+
+    span()
+      : _data(nullptr)
+      , _size(0)
+    {
+    }
+
+    span(T *data, size_t size)
+      : _data(data)
+      , _size(size)
+    {
+    }
+
+    T *data() const
+    {
+      return _data;
+    }
+
+    size_t size() const
+    {
+      return _size;
+    }
+
+    bool empty() const
+    {
+      return _size == 0;
+    }
+
+    T &operator[](size_t i) const
+    {
+      return _data[i];
+    }
+
+    T *begin() const
+    {
+      return _data;
+    }
+
+    T *end() const
+    {
+      return _data + _size;
+    }
+  };
+
+  namespace traits {
+    template <bool...> struct bool_pack;
+
+    /**
+     * Trait that is true, if all passed values are true
+     * \ingroup group_traits
+     */
+    template <bool... Values>
+    struct all_of : std::is_same<bool_pack<true, Values...>, bool_pack<Values..., true>> {
+    };
+  }
+
+  /**
+   * A structure of arrays that shares a single block. Each array of type
+   * Ts... starts at least at the alignment of its type or at the requested
+   * alignment, e.g. a cache line.
+   * All types must be trivially copyable, because the content is moved
+   * bytewise when the layout is resized.
+   * A layout can only be moved, so that just one object holds the block.
+   * \tparam Ts The element types of the arrays
+   *
+   * \ingroup group_allocators
+   */
+  template <typename... Ts> class layout {
+    static_assert(traits::all_of<std::is_trivially_copyable<Ts>::value...>::value,
+                  "All element types of a layout must be trivially copyable!");
+
+    layout(const layout &) = delete;
+    layout &operator=(const layout &) = delete;
+
+    void clear()
+    {
+      _block.reset();
+      for (auto &item : _items) {
+        item.ptr = nullptr;
+      }
+    }
+
+  public:
+    static const size_t number_of_arrays = sizeof...(Ts);
+
+    using counts_type = std::array<size_t, sizeof...(Ts)>;
+
+    template <size_t I> using element_type = typename std::tuple_element<I, std::tuple<Ts...>>::type;
+
+    /**
+     * Describes a layout, without allocating it.
+     * \param counts The number of elements per array
+     * \param alignments The minimum alignment per array, zero means the
+     *                   alignment of its type
+     */
+    explicit layout(const counts_type &counts, const counts_type &alignments = counts_type{})
+      : _items{{layout_item{sizeof(Ts), alignof(Ts), 0, nullptr}...}}
+    {
+      for (size_t i = 0; i < number_of_arrays; ++i) {
+        _items[i].count = counts[i];
+        _items[i].alignment = std::max(_items[i].alignment, alignments[i]);
+      }
+    }
+
+    /**
+     * Takes over the block of x, x is unallocated afterwards
+     */
+    layout(layout &&x)
+      : _items(x._items)
+      , _block(x._block)
+    {
+      x.clear();
+    }
+
+    /**
+     * Takes over the block of x, x is unallocated afterwards. This layout
+     * must not be allocated, because it cannot free its block by itself.
+     */
+    layout &operator=(layout &&x)
+    {
+      BOOST_ASSERT_MSG(!_block, "An allocated layout must be deallocated before!");
+      if (this != &x) {
+        _items = x._items;
+        _block = x._block;
+        x.clear();
+      }
+      return *this;
+    }
+
+    /**
+     * Returns a view on the I-th array. It is empty if the layout is not
+     * allocated.
+     */
+    template <size_t I> span<element_type<I>> get() const
+    {
+      return {static_cast<element_type<I> *>(_items[I].ptr), _items[I].ptr ? _items[I].count : 0};
+    }
+
+    /**
+     * Returns the block that holds all arrays
+     */
+    const block &memory() const
+    {
+      return _block;
+    }
+
+    /**
+     * Allocates all arrays with a single allocation of the allocator
+     * \return True, if the operation was successful
+     */
+    template <class Allocator> bool allocate(Allocator &allocator)
+    {
+      BOOST_ASSERT(!_block);
+      _block = allocate_layout(allocator, _items);
+      return static_cast<bool>(_block);
+    }
+
+    /**
+     * Changes the number of elements of all arrays. See alb::reallocate_layout
+     */
+    template <class Allocator> bool reallocate(Allocator &allocator, const counts_type &counts)
+    {
+      return reallocate_layout(allocator, _block, _items, counts);
+    }
+
+    /**
+     * Changes the number of elements of all arrays in place. See
+     * alb::expand_layout
+     */
+    template <class Allocator> bool expand(Allocator &allocator, const counts_type &counts)
+    {
+      return expand_layout(allocator, _block, _items, counts);
+    }
+
+    /**
+     * Frees the block of all arrays
+     */
+    template <class Allocator> void deallocate(Allocator &allocator)
+    {
+      allocator.deallocate(_block);
+      clear();
+    }
+
+  private:
+    std::array<layout_item, sizeof...(Ts)> _items;
+    block _block;
+  };
+
+  template <typename... Ts> const size_t layout<Ts...>::number_of_arrays;
+
+  /**
+   * Creates a layout of arrays of Ts... and allocates it with a single
+   * allocation. The result is unallocated if the allocator ran out of memory.
+   * \param allocator Any allocator of this library
+   * \param counts The number of elements per array
+   * \param alignments The minimum alignment per array, zero means the alignment
+   *                   of its type
+   *
+   * \ingroup group_allocators
+   */
+  template <typename... Ts, class Allocator>
+  layout<Ts...> allocate_layout(Allocator &allocator,
+                                const typename layout<Ts...>::counts_type &counts,
+                                const typename layout<Ts...>::counts_type &alignments =
+                                    typename layout<Ts...>::counts_type{})
+  {
+    layout<Ts...> result(counts, alignments);
+    result.allocate(allocator);
+    return result;
+  }
+}
@@ -0,0 +1,372 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_base.hpp"
+#include "internal/callsite.hpp"
+#include "internal/reallocator.hpp"
+
+#include <boost/functional/hash.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace alb {
+  /**
+   * This allocator learns at runtime, which allocations are short-lived, and
+   * serves them from a Region, that is reset in bulk as soon as all of its
+   * blocks are freed. All other allocations go to the General allocator, so
+   * that long-lived blocks are packed densely there and are not interleaved
+   * with short-lived ones.
+   * Allocations are grouped into classes, either by their call site, when
+   * passed by the ALLOCATE macro, or by their size. Call sites and sizes have
+   * separate tables of NumberOfClasses classes each. A call site is identified
+   * like by alb::callsite_segregator by the contents of its names, so equal
+   * string literals of different translation units share their class, while
+   * different call sites never do. The call sites beyond NumberOfClasses are
+   * grouped by their size. Of every class each
+   * SampleRate-th allocation is sampled: its allocation time is remembered and
+   * the lifetime is measured on deallocation. The time is the number of
+   * allocations in between. A class is predicted as short-lived, when the
+   * average lifetime of its samples is below ShortLifetime.
+   * Mispredictions are handled gracefully:
+   *   - A sampled block, that lives longer than ShortLifetime, raises the
+   *     average of its class, even if it is never freed.
+   *   - If the Region is exhausted, e.g. because a long-lived block prevents
+   *     the reset, the allocation is served by the General allocator.
+   *   - A block of the Region that grows is moved to the General allocator.
+   * This class is not thread safe!
+   * \tparam Region The allocator for short-lived blocks. It must implement
+   *         ::owns() and ::deallocateAll(), e.g. alb::stack_allocator.
+   * \tparam General The allocator for all other blocks, e.g. alb::heap
+   * \tparam ShortLifetime The number of allocations, that a short-lived block
+   *         lives on average at most
+   * \tparam SampleRate Every SampleRate-th allocation of a class is sampled
+   * \tparam NumberOfClasses The number of distinguished size classes and call
+   *         sites each
+   *
+   * \ingroup group_allocators
+   */
+  template <class Region, class General, size_t ShortLifetime = 1024, unsigned SampleRate = 16,
+            size_t NumberOfClasses = 64>
+  class lifetime_segregator {
+    static_assert(SampleRate > 0, "The sample rate must be positive!");
+
+    struct statistic {
+      uint64_t allocations;
+      uint64_t samples;
+      // fixed point with 4 fractional bits
+      uint64_t averageLifetime;
+    };
+
+    struct sample {
+      void *ptr;
+      uint64_t time;
+      size_t classIndex;
+    };
+
+    struct site {
+      const char *file;
+      const char *function;
+      int line;
+      size_t hash;
+    };
+
+    static const size_t number_of_samples = 64;
+    static const uint64_t min_samples = 4;
+
+    Region _region;
+    General _general;
+    // the size classes are followed by the classes of the call sites
+    statistic _statistics[2 * NumberOfClasses];
+    sample _samples[number_of_samples];
+    site _sites[NumberOfClasses];
+    size_t _numberOfSites;
+    internal::callsite_cache<size_t, NumberOfClasses> _callsites;
+    uint64_t _time;
+    size_t _regionBlocks;
+    size_t _regionResets;
+
+    lifetime_segregator(const lifetime_segregator &) = delete;
+    lifetime_segregator &operator=(const lifetime_segregator &) = delete;
+
+    static size_t sizeClassOf(size_t n)
+    {
+      // size classes by powers of two
+      size_t result = 0;
+      while (n > 1) {
+        n >>= 1;
+        ++result;
+      }
+      return result % NumberOfClasses;
+    }
+
+    static bool sameName(const char *a, const char *b)
+    {
+      return a == b || (a != nullptr && b != nullptr && ::strcmp(a, b) == 0);
+    }
+
+    static bool isEmpty(const site &key)
+    {
+      return key.file == nullptr && key.function == nullptr;
+    }
+
+    /**
+     * Returns the index of the call site within _sites or of the empty entry,
+     * where it belongs. If the table is full and the site is not in it,
+     * NumberOfClasses is returned.
+     */
+    size_t findSite(const char *file, const char *function, int line, size_t hash) const
+    {
+      auto i = hash % NumberOfClasses;
+      for (size_t probe = 0; probe < NumberOfClasses; ++probe) {
+        const auto &key = _sites[i];
+        if (isEmpty(key) || (key.hash == hash && key.line == line && sameName(key.file, file) &&
+                             sameName(key.function, function))) {
+          return i;
+        }
+        i = (i + 1) % NumberOfClasses;
+      }
+      return NumberOfClasses;
+    }
+
+    /**
+     * Returns the index of the call site within _sites, an unknown site is
+     * added. If the table is full, NumberOfClasses is returned.
+     */
+    size_t siteIndex(const char *file, const char *function, int line)
+    {
+      const auto hash = internal::callsiteHash(file, function, line);
+      const auto i = findSite(file, function, line, hash);
+      if (i < NumberOfClasses && isEmpty(_sites[i])) {
+        _sites[i] = {file, function, line, hash};
+        ++_numberOfSites;
+      }
+      return i;
+    }
+
+    /**
+     * Returns the class of an allocation. A call site gets its own class,
+     * as long as there is room for it, otherwise the size class is taken.
+     * The class of a call site is cached by the pointers of its names.
+     */
+    size_t classOf(size_t n, const char *file, const char *function, int line)
+    {
+      if (file == nullptr && function == nullptr) {
+        return sizeClassOf(n);
+      }
+      const auto i =
+          _callsites.lookup(file, function, line, [this](const char *f, const char *fn, int l) {
+            return siteIndex(f, fn, l);
+          });
+      return i < NumberOfClasses ? NumberOfClasses + i : sizeClassOf(n);
+    }
+
+    static size_t sampleSlot(const void *p)
+    {
+      return boost::hash<const void *>()(p) % number_of_samples;
+    }
+
+    void record(size_t classIndex, uint64_t lifetime)
+    {
+      auto &s = _statistics[classIndex];
+      const auto value = std::min(lifetime, uint64_t(ShortLifetime) * 16) << 4;
+      if (s.samples == 0) {
+        s.averageLifetime = value;
+      }
+      else {
+        // exponentially weighted with 1/8 for the newest sample
+        s.averageLifetime = s.averageLifetime - s.averageLifetime / 8 + value / 8;
+      }
+      ++s.samples;
+    }
+
+    void takeSample(const block &b, size_t classIndex)
+    {
+      auto &slot = _samples[sampleSlot(b.ptr)];
+      if (slot.ptr != nullptr && _time - slot.time > ShortLifetime) {
+        // the displaced block is still alive, so it is long-lived
+        record(slot.classIndex, _time - slot.time);
+      }
+      slot.ptr = b.ptr;
+      slot.time = _time;
+      slot.classIndex = classIndex;
+    }
+
+    void finishSample(const block &b)
+    {
+      auto &slot = _samples[sampleSlot(b.ptr)];
+      if (slot.ptr == b.ptr) {
+        record(slot.classIndex, _time - slot.time);
+        slot.ptr = nullptr;
+      }
+    }
+
+    bool isShortLived(size_t classIndex) const
+    {
+      const auto &s = _statistics[classIndex];
+      return s.samples >= min_samples && (s.averageLifetime >> 4) < ShortLifetime;
+    }
+
+    void releaseFromRegion(block &b)
+    {
+      _region.deallocate(b);
+      if (--_regionBlocks == 0) {
+        _region.deallocateAll();
+        ++_regionResets;
+      }
+    }
+
+  public:
+    using region_allocator = Region;
+    using general_allocator = General;
+    static const size_t short_lifetime = ShortLifetime;
+    static const unsigned sample_rate = SampleRate;
+    static const bool supports_truncated_deallocation =
+        Region::supports_truncated_deallocation && General::supports_truncated_deallocation;
+
+    lifetime_segregator()
+      : _numberOfSites(0)
+      , _time(0)
+      , _regionBlocks(0)
+      , _regionResets(0)
+    {
+      ::memset(_statistics, 0, sizeof(_statistics));
+      ::memset(_samples, 0, sizeof(_samples));
+      ::memset(_sites, 0, sizeof(_sites));
+    }
+
+    /**
+     * Allocates n bytes from the Region, if the allocation is predicted to be
+     * short-lived, otherwise from the General allocator.
+     * \param n The requested number of bytes
+     * \param file The file name of the caller location
+     * \param function The callers function
+     * \param line The callers line in source code
+     */
+    block allocate(size_t n, const char *file = nullptr, const char *function = nullptr,
+                   int line = 0)
+    {
+      if (n == 0) {
+        return {};
+      }
+      ++_time;
+      const auto classIndex = classOf(n, file, function, line);
+      block result;
+      if (isShortLived(classIndex)) {
+        result = _region.allocate(n);
+        if (result) {
+          ++_regionBlocks;
+        }
+      }
+      if (!result) {
+        result = _general.allocate(n);
+      }
+      if (result && _statistics[classIndex].allocations++ % SampleRate == 0) {
+        takeSample(result, classIndex);
+      }
+      return result;
+    }
+
+    void deallocate(block &b)
+    {
+      if (!b) {
+        return;
+      }
+      finishSample(b);
+      if (_region.owns(b)) {
+        releaseFromRegion(b);
+      }
+      else {
+        _general.deallocate(b);
+      }
+      b.reset();
+    }
+
+    /**
+     * Reallocates the given block. A block of the Region is shrunk in place,
+     * but moved to the General allocator if it grows.
+     */
+    bool reallocate(block &b, size_t n)
+    {
+      if (internal::reallocator<lifetime_segregator>::isHandledDefault(*this, b, n)) {
+        return true;
+      }
+      if (!_region.owns(b)) {
+        return _general.reallocate(b, n);
+      }
+      if (n < b.length) {
+        return _region.reallocate(b, n);
+      }
+      auto newBlock = _general.allocate(n);
+      if (!newBlock) {
+        return false;
+      }
+      internal::blockCopy(b, newBlock);
+      deallocate(b);
+      b = newBlock;
+      return true;
+    }
+
+    /**
+     * Checks the ownership of the given block. This is only available if the
+     * General allocator implements ::owns().
+     */
+    template <typename U = General>
+    typename std::enable_if<traits::has_owns<U>::value, bool>::type
+    owns(const block &b) const
+    {
+      return _region.owns(b) || _general.owns(b);
+    }
+
+    /**
+     * Returns true, if an allocation with the given properties would be served
+     * by the Region
+     */
+    bool predicts_short_lived(size_t n, const char *file = nullptr,
+                              const char *function = nullptr, int line = 0) const
+    {
+      if (file == nullptr && function == nullptr) {
+        return isShortLived(sizeClassOf(n));
+      }
+      const auto i = findSite(file, function, line, internal::callsiteHash(file, function, line));
+      if (i < NumberOfClasses && !isEmpty(_sites[i])) {
+        return isShortLived(NumberOfClasses + i);
+      }
+      // an unknown call site is grouped by its size only if there is no room
+      return _numberOfSites == NumberOfClasses && isShortLived(sizeClassOf(n));
+    }
+
+    /**
+     * Returns the number of blocks, that are currently allocated in the Region
+     */
+    size_t region_blocks() const
+    {
+      return _regionBlocks;
+    }
+
+    /**
+     * Returns how often the Region was reset, because all its blocks were freed
+     */
+    size_t region_resets() const
+    {
+      return _regionResets;
+    }
+  };
+
+  template <class Region, class General, size_t ShortLifetime, unsigned SampleRate,
+            size_t NumberOfClasses>
+  const size_t
+      lifetime_segregator<Region, General, ShortLifetime, SampleRate, NumberOfClasses>::short_lifetime;
+  template <class Region, class General, size_t ShortLifetime, unsigned SampleRate,
+            size_t NumberOfClasses>
+  const unsigned
+      lifetime_segregator<Region, General, ShortLifetime, SampleRate, NumberOfClasses>::sample_rate;
+}
@@ -11,7 +11,10 @@
 
 #include "allocator_base.hpp"
 #include "internal/reallocator.hpp"
+#include "internal/tracepoints.hpp"
 #include <boost/config/suffix.hpp>
+#include <cstddef>
+#include <cstdlib>
 
 namespace alb {
 
@@ -23,6 +26,9 @@ namespace alb {
   class mallocator {
   public:
     static const bool supports_truncated_deallocation = false;
+    /// ::malloc() returns memory that is suitable aligned for any fundamental type
+    static const size_t alignment = alignof(std::max_align_t);
+
     /**
      * Allocates the specified number of bytes.
      * If the system cannot allocate the specified amount of memory then
@@ -36,6 +42,7 @@ namespace alb {
         return {};
       }
       void *p = ::malloc(n);
+      ALB_TRACE3(allocate, this, n, p);
       if (p != nullptr) {
         return {p, n};
       }
@@ -55,6 +62,7 @@ namespace alb {
       }
 
       block reallocatedBlock(::realloc(b.ptr, n), n);
+      ALB_TRACE4(reallocate, this, b.ptr, n, reallocatedBlock.ptr);
 
       if (reallocatedBlock.ptr != nullptr) {
         b = reallocatedBlock;
@@ -70,6 +78,7 @@ namespace alb {
     void deallocate(block &b)
     {
       if (b) {
+        ALB_TRACE3(deallocate, this, b.ptr, b.length);
         ::free(b.ptr);
         b.reset();
       }
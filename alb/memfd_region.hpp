@@ -0,0 +1,494 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_base.hpp"
+#include "internal/reallocator.hpp"
+
+#include <boost/assert.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace alb {
+
+  namespace internal {
+    /**
+     * Writes all pages of the given private file mapping, that were modified
+     * since they were mapped, back to the file at the same offsets. The
+     * modified pages are detected by /proc/self/pagemap, because they became
+     * anonymous copies. If that is not readable, all pages are written.
+     * \ingroup group_internal
+     */
+    inline bool writeBackPrivatePages(int fd, char *p, size_t length)
+    {
+      const auto pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+      const auto numberOfPages = length / pageSize;
+      const uint64_t present = uint64_t(1) << 63;
+      const uint64_t swapped = uint64_t(1) << 62;
+      const uint64_t fileOrShared = uint64_t(1) << 61;
+
+      const int pagemap = ::open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+      if (pagemap < 0) {
+        return ::pwrite(fd, p, length, 0) == static_cast<ssize_t>(length);
+      }
+
+      bool result = true;
+      const size_t batchSize = 512;
+      uint64_t entries[batchSize];
+      for (size_t first = 0; first < numberOfPages && result; first += batchSize) {
+        const auto count = std::min(batchSize, numberOfPages - first);
+        const auto offset = (reinterpret_cast<uintptr_t>(p) / pageSize + first) * sizeof(uint64_t);
+        if (::pread(pagemap, entries, count * sizeof(uint64_t), static_cast<off_t>(offset)) !=
+            static_cast<ssize_t>(count * sizeof(uint64_t))) {
+          result = ::pwrite(fd, p, length, 0) == static_cast<ssize_t>(length);
+          break;
+        }
+        for (size_t i = 0; i < count; ++i) {
+          if ((entries[i] & (present | swapped)) != 0 && (entries[i] & fileOrShared) == 0) {
+            const auto pageOffset = (first + i) * pageSize;
+            if (::pwrite(fd, p + pageOffset, pageSize, static_cast<off_t>(pageOffset)) !=
+                static_cast<ssize_t>(pageSize)) {
+              result = false;
+              break;
+            }
+          }
+        }
+      }
+      ::close(pagemap);
+      return result;
+    }
+  }
+
+  /**
+   * This allocator serves memory like the alb::stack_allocator out of a
+   * region of MaxSize bytes, but the region is a shared mapping of an
+   * anonymous memory file (memfd). So a consistent snapshot of the complete
+   * region can be taken in O(1), independent of its size:
+   * take_snapshot() maps the file a second time read only for the snapshot and
+   * remaps the region copy-on-write at the same address. All following writes
+   * to allocated blocks go to private pages, while the file and so the
+   * snapshot stay frozen. When the snapshot is released, only the modified
+   * pages are written back to the file and the region is shared again.
+   * Only one snapshot can exist at a time.
+   * The snapshot can be read while the region is still in use, e.g. by
+   * another thread that persists it. But it must be released by the thread
+   * that modifies the region, because a write between the write back and
+   * the remapping would be lost. Otherwise this class is not thread safe!
+   * This allocator is only available on Linux.
+   * \tparam MaxSize The maximum number of bytes that can be allocated, it is
+   *         rounded up to a multiple of the page size
+   * \tparam Alignment Each allocation is aligned by this value
+   *
+   * \ingroup group_allocators
+   */
+  template <size_t MaxSize, size_t Alignment = 16> class memfd_region {
+    int _fd;
+    char *_data;
+    char *_p;
+    size_t _size;
+    bool _snapshotActive;
+    // the region is still mapped copy-on-write after a failed write back
+    bool _detached;
+    // the region could not be remapped and must not be used any more
+    bool _lost;
+    std::thread::id _owner;
+
+    memfd_region(const memfd_region &) = delete;
+    memfd_region &operator=(const memfd_region &) = delete;
+
+    bool isLastUsedBlock(const block &b) const
+    {
+      return static_cast<char *>(b.ptr) + b.length == _p;
+    }
+
+    bool remapLive(int flags)
+    {
+      return ::mmap(_data, _size, PROT_READ | PROT_WRITE, flags | MAP_FIXED, _fd, 0) == _data;
+    }
+
+    // Writes the private pages back and shares the region again
+    bool attach()
+    {
+      if (!internal::writeBackPrivatePages(_fd, _data, _size)) {
+        return false;
+      }
+      if (!remapLive(MAP_SHARED)) {
+        // MAP_FIXED may have unmapped the region already
+        _lost = true;
+        _p = _data + _size;
+        return false;
+      }
+      _detached = false;
+      return true;
+    }
+
+    bool releaseSnapshot(void *view, bool force)
+    {
+      BOOST_ASSERT_MSG(_owner == std::this_thread::get_id(),
+                       "The snapshot must be released by the thread that modifies the region!");
+      const auto result = attach();
+      if (!result && !force && !_lost) {
+        // the snapshot stays, so the release can be tried again
+        return false;
+      }
+      _detached = !result && !_lost;
+      ::munmap(view, _size);
+      _snapshotActive = false;
+      return result;
+    }
+
+  public:
+    static const bool supports_truncated_deallocation = true;
+    static const bool shrinks_in_place = true;
+    static const size_t max_size = MaxSize;
+    static const size_t alignment = Alignment;
+
+    /**
+     * A read only, point in time image of all bytes of the region. Its
+     * destruction ends the snapshot.
+     */
+    class snapshot {
+      friend class memfd_region;
+
+      memfd_region *_region;
+      char *_view;
+      size_t _used;
+
+      snapshot(memfd_region *region, char *view, size_t used)
+        : _region(region)
+        , _view(view)
+        , _used(used)
+      {
+      }
+
+      snapshot(const snapshot &) = delete;
+      snapshot &operator=(const snapshot &) = delete;
+
+    public:
+      snapshot()
+        : _region(nullptr)
+        , _view(nullptr)
+        , _used(0)
+      {
+      }
+
+      snapshot(snapshot &&x)
+        : _region(x._region)
+        , _view(x._view)
+        , _used(x._used)
+      {
+        x._region = nullptr;
+        x._view = nullptr;
+        x._used = 0;
+      }
+
+      snapshot &operator=(snapshot &&x)
+      {
+        if (this != &x) {
+          reset();
+          std::swap(_region, x._region);
+          std::swap(_view, x._view);
+          std::swap(_used, x._used);
+        }
+        return *this;
+      }
+
+      /**
+       * Ends the snapshot like reset(). If the modifications cannot be written
+       * back, the region stays copy-on-write and the next take_snapshot()
+       * tries it again.
+       */
+      ~snapshot()
+      {
+        if (_region) {
+          _region->releaseSnapshot(_view, true);
+        }
+      }
+
+      /**
+       * Ends the snapshot and merges the modifications of the region, that
+       * happened in the meantime. It must be called by the thread, that
+       * modifies the region.
+       * \return False, if the modifications could not be written back, then
+       *         the snapshot stays and reset() can be called again, or if the
+       *         region could not be shared again, then the region is lost
+       *         (see memfd_region::is_lost())
+       */
+      bool reset()
+      {
+        if (!_region) {
+          return true;
+        }
+        if (!_region->releaseSnapshot(_view, false) && _region->has_snapshot()) {
+          return false;
+        }
+        const auto result = !_region->is_lost();
+        _region = nullptr;
+        _view = nullptr;
+        _used = 0;
+        return result;
+      }
+
+      explicit operator bool() const
+      {
+        return _view != nullptr;
+      }
+
+      /**
+       * Returns all bytes, that were allocated at the moment of the snapshot
+       */
+      block memory() const
+      {
+        return {_view, _used};
+      }
+
+      size_t size() const
+      {
+        return _used;
+      }
+
+      /**
+       * Returns the image of the given block of the region
+       * \param b A block that was allocated before the snapshot was taken
+       * \return The block within the snapshot or an empty block, if it is
+       *         not covered by the snapshot
+       */
+      block at(const block &b) const
+      {
+        if (!_region || !b || b.ptr < _region->_data) {
+          return {};
+        }
+        const auto offset = static_cast<size_t>(static_cast<char *>(b.ptr) - _region->_data);
+        if (offset + b.length > _used) {
+          return {};
+        }
+        return {_view + offset, b.length};
+      }
+
+      /**
+       * Copies n bytes at offset of the snapshot to p
+       * \return True, if the range was covered by the snapshot
+       */
+      bool read(size_t offset, void *p, size_t n) const
+      {
+        if (offset > _used || n > _used - offset) {
+          return false;
+        }
+        ::memcpy(p, _view + offset, n);
+        return true;
+      }
+
+      /**
+       * Calls f(block) for consecutive pieces of at most chunkSize bytes, that
+       * cover the snapshot, e.g. for writing it piecewise to disk. The
+       * iteration ends early if f returns false.
+       */
+      template <class F> void for_each_chunk(size_t chunkSize, F f) const
+      {
+        BOOST_ASSERT(chunkSize > 0);
+        for (size_t offset = 0; offset < _used; offset += chunkSize) {
+          if (!f(block(_view + offset, std::min(chunkSize, _used - offset)))) {
+            return;
+          }
+        }
+      }
+    };
+
+    memfd_region()
+      : _fd(-1)
+      , _data(nullptr)
+      , _p(nullptr)
+      , _size(0)
+      , _snapshotActive(false)
+      , _detached(false)
+      , _lost(false)
+    {
+      const auto pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+      const auto size = internal::roundToAlignment(pageSize, MaxSize);
+
+      // MFD_CLOEXEC
+      const auto fd = static_cast<int>(::syscall(SYS_memfd_create, "alb_memfd_region", 1u));
+      if (fd < 0) {
+        return;
+      }
+      if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        ::close(fd);
+        return;
+      }
+      auto p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (p == MAP_FAILED) {
+        ::close(fd);
+        return;
+      }
+      _fd = fd;
+      _data = _p = static_cast<char *>(p);
+      _size = size;
+    }
+
+    /**
+     * Unmaps the region. An existing snapshot must be released before.
+     */
+    ~memfd_region()
+    {
+      BOOST_ASSERT_MSG(!_snapshotActive, "The snapshot must be released before the region!");
+      if (_data) {
+        ::munmap(_data, _size);
+        ::close(_fd);
+      }
+    }
+
+    block allocate(size_t n)
+    {
+      if (n == 0) {
+        return {};
+      }
+      const auto alignedLength = internal::roundToAlignment(Alignment, n);
+      if (alignedLength > static_cast<size_t>(_data + _size - _p)) {
+        return {};
+      }
+      block result(_p, alignedLength);
+      _p += alignedLength;
+      return result;
+    }
+
+    /**
+     * Frees the block. The memory is only reused, if it was the most recently
+     * allocated block.
+     */
+    void deallocate(block &b)
+    {
+      if (!b) {
+        return;
+      }
+      BOOST_ASSERT(owns(b));
+      if (isLastUsedBlock(b)) {
+        _p = static_cast<char *>(b.ptr);
+      }
+      b.reset();
+    }
+
+    bool reallocate(block &b, size_t n)
+    {
+      if (internal::reallocator<memfd_region>::isHandledDefault(*this, b, n)) {
+        return true;
+      }
+      const auto alignedLength = internal::roundToAlignment(Alignment, n);
+      if (isLastUsedBlock(b)) {
+        if (alignedLength <= static_cast<size_t>(_data + _size - static_cast<char *>(b.ptr))) {
+          b.length = alignedLength;
+          _p = static_cast<char *>(b.ptr) + alignedLength;
+          return true;
+        }
+        return false;
+      }
+      if (b.length > n) {
+        b.length = alignedLength;
+        return true;
+      }
+      auto newBlock = allocate(alignedLength);
+      if (newBlock) {
+        internal::blockCopy(b, newBlock);
+        b = newBlock;
+        return true;
+      }
+      return false;
+    }
+
+    /**
+     * Expands the given block insito by delta bytes, if it is the most
+     * recently allocated one
+     */
+    bool expand(block &b, size_t delta)
+    {
+      if (delta == 0) {
+        return true;
+      }
+      if (!b) {
+        b = allocate(delta);
+        return static_cast<bool>(b);
+      }
+      const auto alignedBytes = internal::roundToAlignment(Alignment, delta);
+      if (!isLastUsedBlock(b) || alignedBytes > static_cast<size_t>(_data + _size - _p)) {
+        return false;
+      }
+      _p += alignedBytes;
+      b.length += alignedBytes;
+      return true;
+    }
+
+    bool owns(const block &b) const
+    {
+      return b && b.ptr >= _data && b.ptr < _data + _size;
+    }
+
+    /**
+     * Sets all memory to free. An existing snapshot is not affected.
+     */
+    void deallocateAll()
+    {
+      _p = _data;
+    }
+
+    /**
+     * Takes a snapshot of the region in O(1). All allocated blocks stay valid
+     * and can be modified without affecting the snapshot.
+     * \return The snapshot or an empty snapshot, if another snapshot exists or
+     *         the remapping failed
+     */
+    snapshot take_snapshot()
+    {
+      if (!_data || _lost || _snapshotActive || (_detached && !attach())) {
+        return {};
+      }
+      auto view = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, _fd, 0);
+      if (view == MAP_FAILED) {
+        return {};
+      }
+      if (!remapLive(MAP_PRIVATE)) {
+        ::munmap(view, _size);
+        return {};
+      }
+      _snapshotActive = true;
+      _owner = std::this_thread::get_id();
+      return {this, static_cast<char *>(view), static_cast<size_t>(_p - _data)};
+    }
+
+    /**
+     * Returns true, if a snapshot currently exists
+     */
+    bool has_snapshot() const
+    {
+      return _snapshotActive;
+    }
+
+    /**
+     * Returns true, if the region could not be remapped at the end of a
+     * snapshot. Then its blocks must not be used any more and all further
+     * allocations fail.
+     */
+    bool is_lost() const
+    {
+      return _lost;
+    }
+  };
+
+  template <size_t MaxSize, size_t Alignment>
+  const size_t memfd_region<MaxSize, Alignment>::max_size;
+  template <size_t MaxSize, size_t Alignment>
+  const size_t memfd_region<MaxSize, Alignment>::alignment;
+}
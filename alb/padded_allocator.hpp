@@ -0,0 +1,200 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_base.hpp"
+#include "internal/reallocator.hpp"
+#include "internal/traits.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace alb {
+  /**
+   * This allocator guarantees for every block, that it starts at a multiple of
+   * Alignment and that at least Padding bytes beyond the end of the block are
+   * readable. So vectorized loops can load full vectors until the end of the
+   * block without a scalar epilogue. The content of the padding is undefined
+   * and it must not be written.
+   * The returned block length is the usable length; it contains any rounding
+   * of the underlying Allocator, e.g. of a heap or a freelist, so it may be
+   * bigger than requested. The Padding is requested on top of n, but as the
+   * Allocator rounds the whole request, the padding costs no memory, if it
+   * fits into the rounding slack of n.
+   * If the Allocator does not guarantee the Alignment by itself (see
+   * traits::guaranteed_alignment), then Alignment additional bytes are
+   * allocated and the distance to the aligned start is stored in the byte
+   * in front of the returned block.
+   * \tparam Allocator The allocator that is used as underlying allocator
+   * \tparam Alignment The alignment of all returned blocks, at most 256
+   * \tparam Padding The number of readable bytes beyond each block
+   *
+   * \ingroup group_allocators group_shared
+   */
+  template <class Allocator, size_t Alignment = 64, size_t Padding = 64> class padded_allocator {
+    static_assert(Alignment > 0 && (Alignment & (Alignment - 1)) == 0,
+                  "The alignment must be a power of two!");
+    static_assert(Alignment <= 256, "The alignment offset must fit into a single byte!");
+
+    Allocator _allocator;
+
+    static const bool realigns = traits::guaranteed_alignment<Allocator>::value < Alignment;
+    static const size_t overhead = Padding + (realigns ? Alignment : 0);
+
+    static size_t offsetOf(const block &b)
+    {
+      return realigns ? static_cast<unsigned char *>(b.ptr)[-1] + size_t(1) : 0;
+    }
+
+    static size_t offsetOf(char *innerPtr)
+    {
+      return realigns ? internal::alignUp(innerPtr + 1, Alignment) - innerPtr : 0;
+    }
+
+    block toInnerBlock(const block &b) const
+    {
+      const auto offset = offsetOf(b);
+      return {static_cast<char *>(b.ptr) - offset, b.length + offset + Padding};
+    }
+
+    block toOuterBlock(const block &b) const
+    {
+      auto p = static_cast<char *>(b.ptr);
+      const auto offset = offsetOf(p);
+      if (realigns) {
+        p[offset - 1] = static_cast<char>(offset - 1);
+      }
+      return {p + offset, b.length - offset - Padding};
+    }
+
+  public:
+    using allocator = Allocator;
+    static const size_t alignment = Alignment;
+    static const size_t padding = Padding;
+    // the offset in front of a block must be read on deallocation
+    static const bool supports_truncated_deallocation = false;
+
+    /**
+     * Allocates at least n bytes, aligned to Alignment and followed by Padding
+     * readable bytes.
+     * \param n The number of requested bytes
+     * \return The block with the usable length
+     */
+    block allocate(size_t n)
+    {
+      if (n == 0) {
+        return {};
+      }
+      auto innerBlock = _allocator.allocate(n + overhead);
+      if (!innerBlock) {
+        return {};
+      }
+      return toOuterBlock(innerBlock);
+    }
+
+    /**
+     * Frees the given block and resets it
+     * \param b The block to be freed
+     */
+    void deallocate(block &b)
+    {
+      if (!b) {
+        return;
+      }
+      auto innerBlock = toInnerBlock(b);
+      _allocator.deallocate(innerBlock);
+      b.reset();
+    }
+
+    /**
+     * Reallocates the given block by the underlying Allocator. The content and
+     * the alignment are kept, even if the underlying allocator moves the block
+     * to a differently aligned location.
+     * \param b The block to be reallocated
+     * \param n The new size
+     * \return True, if the operation was successful
+     */
+    bool reallocate(block &b, size_t n)
+    {
+      if (internal::reallocator<padded_allocator>::isHandledDefault(*this, b, n)) {
+        return true;
+      }
+      const auto oldOffset = offsetOf(b);
+      const auto oldLength = b.length;
+      auto innerBlock = toInnerBlock(b);
+
+      if (!_allocator.reallocate(innerBlock, n + overhead)) {
+        return false;
+      }
+      auto p = static_cast<char *>(innerBlock.ptr);
+      const auto newOffset = offsetOf(p);
+      if (newOffset != oldOffset) {
+        ::memmove(p + newOffset, p + oldOffset, std::min(oldLength, n));
+      }
+      b = toOuterBlock(innerBlock);
+      return true;
+    }
+
+    /**
+     * Expands the given block in place by at least delta bytes. This is only
+     * available if the underlying Allocator implements ::expand().
+     * \param b The block that should be expanded
+     * \param delta The number of bytes that the block should be increased
+     * \return True, if the operation was successful.
+     */
+    template <typename U = Allocator>
+    typename std::enable_if<traits::has_expand<U>::value, bool>::type
+    expand(block &b, size_t delta)
+    {
+      if (delta == 0) {
+        return true;
+      }
+      if (!b) {
+        b = allocate(delta);
+        return static_cast<bool>(b);
+      }
+      const auto offset = offsetOf(b);
+      auto innerBlock = toInnerBlock(b);
+      if (_allocator.expand(innerBlock, delta)) {
+        b.length = innerBlock.length - offset - Padding;
+        return true;
+      }
+      return false;
+    }
+
+    /**
+     * Checks the ownership of the given block. This is only available if the
+     * underlying Allocator implements ::owns().
+     * \param b The block to be checked
+     */
+    template <typename U = Allocator>
+    typename std::enable_if<traits::has_owns<U>::value, bool>::type
+    owns(const block &b) const
+    {
+      return b && _allocator.owns(toInnerBlock(b));
+    }
+
+    /**
+     * Frees all memory of the underlying Allocator. This is only available
+     * if the underlying Allocator implements ::deallocateAll().
+     */
+    template <typename U = Allocator>
+    typename std::enable_if<traits::has_deallocateAll<U>::value, void>::type
+    deallocateAll()
+    {
+      _allocator.deallocateAll();
+    }
+  };
+
+  template <class Allocator, size_t Alignment, size_t Padding>
+  const size_t padded_allocator<Allocator, Alignment, Padding>::alignment;
+  template <class Allocator, size_t Alignment, size_t Padding>
+  const size_t padded_allocator<Allocator, Alignment, Padding>::padding;
+}
@@ -0,0 +1,399 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_base.hpp"
+#include "internal/reallocator.hpp"
+
+#include <boost/assert.hpp>
+#include <boost/functional/hash.hpp>
+#include <cstring>
+
+namespace alb {
+  /**
+   * This allocator provides purgeable blocks for in-process caches. Each
+   * block is registered with an eviction callback and a cost hint. When the
+   * sum of all blocks would exceed the budget, when the Allocator cannot
+   * serve a request or when ::trim() is called, cold blocks are evicted in
+   * CLOCK order: the callback is called, so that the cache can drop its
+   * reference, and afterwards the memory is freed. The clock hand runs over
+   * a ring of MaxBlocks entries, so no list has to be updated on access.
+   * A block gets cost many rounds of the clock hand before it is evicted,
+   * and each ::touch() or ::pin() resets that credit. So expensive to
+   * recompute and frequently used blocks survive longer. Pinned blocks and
+   * blocks without callback are never evicted.
+   * Other allocations can get memory back from the caches by calling
+   * ::trim(), e.g. as a fall-back of a failed request.
+   * The callback is called after the block was removed from the allocator,
+   * so it may allocate or deallocate other blocks.
+   * This class is not thread safe!
+   * \tparam Allocator The allocator that is used as underlying allocator
+   * \tparam Budget The initial maximum number of bytes of all blocks
+   * \tparam MaxBlocks The maximum number of blocks at the same time
+   *
+   * \ingroup group_allocators
+   */
+  template <class Allocator, size_t Budget, size_t MaxBlocks = 1024> class purgeable_allocator {
+  public:
+    /**
+     * The type of the eviction callback. It gets the context, that was passed
+     * on allocation, and the block, that is freed after the call.
+     */
+    using eviction_callback = void (*)(void *context, const block &b);
+
+  private:
+    struct entry {
+      block memory;
+      eviction_callback callback;
+      void *context;
+      unsigned pins;
+      unsigned cost;
+      unsigned credit;
+    };
+
+    // The index is only half filled, so that the linear probing stays short
+    static const size_t number_of_slots = 2 * MaxBlocks;
+
+    Allocator _allocator;
+    // The clock hand runs over the entries, the index maps pointers to them
+    entry _entries[MaxBlocks];
+    size_t _index[number_of_slots];
+    size_t _freeEntries[MaxBlocks];
+    size_t _numberOfFreeEntries;
+    size_t _hand;
+    size_t _used;
+    size_t _budget;
+    size_t _evictions;
+
+    purgeable_allocator(const purgeable_allocator &) = delete;
+    purgeable_allocator &operator=(const purgeable_allocator &) = delete;
+
+    static size_t homeOf(const void *p)
+    {
+      return boost::hash<const void *>()(p) % number_of_slots;
+    }
+
+    const void *keyOf(size_t slot) const
+    {
+      return _entries[_index[slot] - 1].memory.ptr;
+    }
+
+    /**
+     * Returns the index slot of the given pointer or number_of_slots
+     */
+    size_t find(const void *p) const
+    {
+      if (p == nullptr) {
+        return number_of_slots;
+      }
+      for (auto i = homeOf(p); _index[i] != 0; i = (i + 1) % number_of_slots) {
+        if (keyOf(i) == p) {
+          return i;
+        }
+      }
+      return number_of_slots;
+    }
+
+    entry *entryOf(const block &b)
+    {
+      const auto i = find(b.ptr);
+      return i == number_of_slots ? nullptr : &_entries[_index[i] - 1];
+    }
+
+    void insert(const entry &e)
+    {
+      BOOST_ASSERT(_numberOfFreeEntries > 0);
+      const auto entryIndex = _freeEntries[--_numberOfFreeEntries];
+      _entries[entryIndex] = e;
+      auto i = homeOf(e.memory.ptr);
+      while (_index[i] != 0) {
+        i = (i + 1) % number_of_slots;
+      }
+      _index[i] = entryIndex + 1;
+      _used += e.memory.length;
+    }
+
+    /**
+     * Removes the entry of the given index slot and shifts all following
+     * slots of the probing sequence backwards, so no tombstones are necessary.
+     */
+    entry erase(size_t i)
+    {
+      const auto entryIndex = _index[i] - 1;
+      auto result = _entries[entryIndex];
+      _entries[entryIndex] = entry();
+      _freeEntries[_numberOfFreeEntries++] = entryIndex;
+      _used -= result.memory.length;
+
+      for (auto j = (i + 1) % number_of_slots; _index[j] != 0; j = (j + 1) % number_of_slots) {
+        const auto home = homeOf(keyOf(j));
+        const bool stays = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+        if (!stays) {
+          _index[i] = _index[j];
+          i = j;
+        }
+      }
+      _index[i] = 0;
+      return result;
+    }
+
+    /**
+     * Evicts the next cold block by the clock hand
+     * \return False, if there is no evictable block
+     */
+    bool evictOne()
+    {
+      bool candidates = false;
+      for (size_t steps = 0;; ++steps) {
+        if (steps == MaxBlocks) {
+          if (!candidates) {
+            return false;
+          }
+          steps = 0;
+          candidates = false;
+        }
+        auto &e = _entries[_hand];
+        _hand = (_hand + 1) % MaxBlocks;
+        if (!e.memory || e.pins > 0 || e.callback == nullptr) {
+          continue;
+        }
+        candidates = true;
+        if (e.credit > 0) {
+          --e.credit;
+          continue;
+        }
+        auto victim = erase(find(e.memory.ptr));
+        ++_evictions;
+        victim.callback(victim.context, victim.memory);
+        _allocator.deallocate(victim.memory);
+        return true;
+      }
+    }
+
+  public:
+    using allocator = Allocator;
+    static const size_t max_blocks = MaxBlocks;
+    // a block is looked up by its exact start on deallocation
+    static const bool supports_truncated_deallocation = false;
+
+    purgeable_allocator()
+      : _numberOfFreeEntries(MaxBlocks)
+      , _hand(0)
+      , _used(0)
+      , _budget(Budget)
+      , _evictions(0)
+    {
+      ::memset(_index, 0, sizeof(_index));
+      // the lowest entries are used first
+      for (size_t i = 0; i < MaxBlocks; ++i) {
+        _entries[i] = entry();
+        _freeEntries[i] = MaxBlocks - 1 - i;
+      }
+    }
+
+    /**
+     * Frees all blocks without calling their callbacks, so the caches must
+     * not outlive this allocator
+     */
+    ~purgeable_allocator()
+    {
+      for (auto &e : _entries) {
+        if (e.memory) {
+          _allocator.deallocate(e.memory);
+        }
+      }
+    }
+
+    /**
+     * Allocates a purgeable block of n bytes. Cold blocks are evicted, if
+     * the budget or the Allocator is exhausted.
+     * \param n The requested number of bytes
+     * \param callback Is called before the block is evicted. If it is
+     *        nullptr, the block is never evicted.
+     * \param context Is passed to the callback
+     * \param cost The number of rounds of the clock hand the block survives
+     *        without being touched
+     * \return The block or an empty block, if not enough blocks could be
+     *         evicted
+     */
+    block allocate(size_t n, eviction_callback callback = nullptr, void *context = nullptr,
+                   unsigned cost = 1)
+    {
+      if (n == 0 || n > _budget) {
+        return {};
+      }
+      while (_used + n > _budget || _numberOfFreeEntries == 0) {
+        if (!evictOne()) {
+          return {};
+        }
+      }
+      auto result = _allocator.allocate(n);
+      while (!result && evictOne()) {
+        result = _allocator.allocate(n);
+      }
+      if (result) {
+        insert({result, callback, context, 0, cost, cost});
+      }
+      return result;
+    }
+
+    /**
+     * Frees the given block without calling its eviction callback
+     */
+    void deallocate(block &b)
+    {
+      if (!b) {
+        return;
+      }
+      const auto i = find(b.ptr);
+      BOOST_ASSERT_MSG(i != number_of_slots, "It is not wise to let me deallocate a foreign Block!");
+      if (i == number_of_slots) {
+        return;
+      }
+      auto e = erase(i);
+      _allocator.deallocate(e.memory);
+      b.reset();
+    }
+
+    /**
+     * Reallocates the given block, its callback, cost and pins are kept.
+     * Other cold blocks are evicted, if the budget is exhausted.
+     */
+    bool reallocate(block &b, size_t n)
+    {
+      if (internal::reallocator<purgeable_allocator>::isHandledDefault(*this, b, n)) {
+        return true;
+      }
+      auto e = entryOf(b);
+      if (e == nullptr || n > _budget) {
+        return false;
+      }
+      // protect the block itself while others are evicted
+      ++e->pins;
+      while (_used - e->memory.length + n > _budget && evictOne()) {
+      }
+      --e->pins;
+      if (_used - e->memory.length + n > _budget) {
+        return false;
+      }
+      // the block may move, so it is registered again at the same position
+      // of the clock
+      auto moved = erase(find(b.ptr));
+      const bool result = _allocator.reallocate(moved.memory, n);
+      insert(moved);
+      b = moved.memory;
+      return result;
+    }
+
+    /**
+     * Checks the ownership of the given block. This is only available if the
+     * underlying Allocator implements ::owns().
+     */
+    template <typename U = Allocator>
+    typename std::enable_if<traits::has_owns<U>::value, bool>::type
+    owns(const block &b) const
+    {
+      return _allocator.owns(b);
+    }
+
+    /**
+     * Marks the block as recently used, so it survives again cost many
+     * rounds of the clock hand.
+     * \return False, if the block is not known, e.g. because it was evicted
+     */
+    bool touch(const block &b)
+    {
+      auto e = entryOf(b);
+      if (e == nullptr) {
+        return false;
+      }
+      e->credit = e->cost;
+      return true;
+    }
+
+    /**
+     * Protects the block against eviction until the same number of ::unpin()
+     * calls were made.
+     * \return False, if the block is not known, e.g. because it was evicted
+     */
+    bool pin(const block &b)
+    {
+      auto e = entryOf(b);
+      if (e == nullptr) {
+        return false;
+      }
+      ++e->pins;
+      e->credit = e->cost;
+      return true;
+    }
+
+    void unpin(const block &b)
+    {
+      auto e = entryOf(b);
+      BOOST_ASSERT(e != nullptr && e->pins > 0);
+      if (e != nullptr && e->pins > 0) {
+        --e->pins;
+      }
+    }
+
+    /**
+     * Evicts cold blocks until at most target bytes are used
+     * \param target The number of bytes, that may stay allocated
+     * \return The number of freed bytes
+     */
+    size_t trim(size_t target = 0)
+    {
+      const auto before = _used;
+      while (_used > target && evictOne()) {
+      }
+      return before - _used;
+    }
+
+    /**
+     * Sets a new budget and evicts cold blocks until it is kept
+     */
+    void set_budget(size_t budget)
+    {
+      _budget = budget;
+      trim(budget);
+    }
+
+    size_t budget() const
+    {
+      return _budget;
+    }
+
+    /**
+     * Returns the number of bytes of all blocks
+     */
+    size_t used() const
+    {
+      return _used;
+    }
+
+    size_t blocks() const
+    {
+      return MaxBlocks - _numberOfFreeEntries;
+    }
+
+    /**
+     * Returns the number of blocks, that were evicted so far
+     */
+    size_t evictions() const
+    {
+      return _evictions;
+    }
+  };
+
+  template <class Allocator, size_t Budget, size_t MaxBlocks>
+  const size_t purgeable_allocator<Allocator, Budget, MaxBlocks>::max_blocks;
+  template <class Allocator, size_t Budget, size_t MaxBlocks>
+  const size_t purgeable_allocator<Allocator, Budget, MaxBlocks>::number_of_slots;
+}
@@ -0,0 +1,585 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_base.hpp"
+#include "freelist.hpp"
+#include "mallocator.hpp"
+#include "typed_allocation.hpp"
+
+#include <boost/assert.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace alb {
+
+  /**
+   * A freelist that is dimensioned at compile time for the segments of a
+   * alb::segmented_deque
+   * \tparam T The type of the elements
+   * \tparam ElementsPerSegment The number of elements of a segment
+   * \tparam PoolSize The maximum number of free segments that are kept
+   *
+   * \ingroup group_allocators
+   */
+  template <typename T, size_t ElementsPerSegment = 64, size_t PoolSize = 1024>
+  using segment_pool_for = freelist<internal::pool_parent_for<T>, sizeof(T) * ElementsPerSegment,
+                                    sizeof(T) * ElementsPerSegment, PoolSize>;
+
+  /**
+   * A sequence container like std::deque, whose elements never move: they
+   * are stored in segments of ElementsPerSegment elements, that are taken
+   * from a pool, by default a alb::freelist, that may be shared by many
+   * containers. So filling and draining a container does not reach malloc.
+   * The segments are kept in a ring of pointers, the index, so that push and
+   * pop at both ends as well as the random access are O(1). A segment is
+   * given back to the pool as soon as it becomes empty, clear() gives back
+   * all of them at once.
+   * Only the index is taken from the IndexAllocator, it grows geometrically.
+   * This class is not thread safe, the pool must outlive the container.
+   * \tparam T The type of the elements
+   * \tparam ElementsPerSegment The number of elements of a segment, it must be
+   *         a power of two
+   * \tparam Allocator The pool of the segments, it must accept blocks of
+   *         sizeof(T) * ElementsPerSegment bytes
+   * \tparam IndexAllocator The allocator of the index
+   *
+   * \ingroup group_allocators
+   */
+  template <typename T, size_t ElementsPerSegment = 64,
+            class Allocator = segment_pool_for<T, ElementsPerSegment>,
+            class IndexAllocator = mallocator>
+  class segmented_deque {
+    static_assert(ElementsPerSegment > 0 && (ElementsPerSegment & (ElementsPerSegment - 1)) == 0,
+                  "The number of elements per segment must be a power of two!");
+
+    static const size_t segment_bytes = sizeof(T) * ElementsPerSegment;
+    static const size_t mask = ElementsPerSegment - 1;
+
+    Allocator *_segments;
+    IndexAllocator _indexAllocator;
+    block _indexBlock;
+    T **_index;
+    size_t _indexCapacity;
+    size_t _firstSegment;
+    size_t _numberOfSegments;
+    // the position of the first element within the first segment
+    size_t _begin;
+    size_t _size;
+
+    template <typename V> class iterator_base {
+      friend class segmented_deque;
+      using container =
+          typename std::conditional<std::is_const<V>::value, const segmented_deque,
+                                    segmented_deque>::type;
+
+      container *_container;
+      size_t _position;
+
+      iterator_base(container *c, size_t position)
+        : _container(c)
+        , _position(position)
+      {
+      }
+
+    public:
+      using iterator_category = std::random_access_iterator_tag;
+      using value_type = T;
+      using difference_type = ptrdiff_t;
+      using pointer = V *;
+      using reference = V &;
+
+      iterator_base()
+        : _container(nullptr)
+        , _position(0)
+      {
+      }
+
+      // an iterator converts to a const_iterator
+      template <typename W, typename = typename std::enable_if<std::is_const<V>::value &&
+                                                               !std::is_const<W>::value>::type>
+      iterator_base(const iterator_base<W> &x)
+        : _container(x._container)
+        , _position(x._position)
+      {
+      }
+
+      reference operator*() const
+      {
+        return (*_container)[_position];
+      }
+
+      pointer operator->() const
+      {
+        return &(*_container)[_position];
+      }
+
+      reference operator[](difference_type n) const
+      {
+        return (*_container)[_position + n];
+      }
+
+      iterator_base &operator++()
+      {
+        ++_position;
+        return *this;
+      }
+
+      iterator_base operator++(int)
+      {
+        auto result = *this;
+        ++_position;
+        return result;
+      }
+
+      iterator_base &operator--()
+      {
+        --_position;
+        return *this;
+      }
+
+      iterator_base operator--(int)
+      {
+        auto result = *this;
+        --_position;
+        return result;
+      }
+
+      iterator_base &operator+=(difference_type n)
+      {
+        _position += n;
+        return *this;
+      }
+
+      iterator_base &operator-=(difference_type n)
+      {
+        _position -= n;
+        return *this;
+      }
+
+      iterator_base operator+(difference_type n) const
+      {
+        return iterator_base(_container, _position + n);
+      }
+
+      iterator_base operator-(difference_type n) const
+      {
+        return iterator_base(_container, _position - n);
+      }
+
+      difference_type operator-(const iterator_base &x) const
+      {
+        return static_cast<difference_type>(_position) - static_cast<difference_type>(x._position);
+      }
+
+      bool operator==(const iterator_base &x) const
+      {
+        return _position == x._position;
+      }
+
+      bool operator!=(const iterator_base &x) const
+      {
+        return _position != x._position;
+      }
+
+      bool operator<(const iterator_base &x) const
+      {
+        return _position < x._position;
+      }
+
+      bool operator>(const iterator_base &x) const
+      {
+        return _position > x._position;
+      }
+
+      bool operator<=(const iterator_base &x) const
+      {
+        return _position <= x._position;
+      }
+
+      bool operator>=(const iterator_base &x) const
+      {
+        return _position >= x._position;
+      }
+
+      template <typename W> friend class iterator_base;
+    };
+
+    T *&segment(size_t i) const
+    {
+      return _index[(_firstSegment + i) & (_indexCapacity - 1)];
+    }
+
+    T *slot(size_t position) const
+    {
+      return segment(position / ElementsPerSegment) + (position & mask);
+    }
+
+    T *allocateSegment()
+    {
+      auto b = _segments->allocate(segment_bytes);
+      if (!b) {
+        throw std::bad_alloc();
+      }
+      return static_cast<T *>(b.ptr);
+    }
+
+    void deallocateSegment(T *p)
+    {
+      block b(p, segment_bytes);
+      _segments->deallocate(b);
+    }
+
+    void reserveIndex()
+    {
+      if (_numberOfSegments < _indexCapacity) {
+        return;
+      }
+      const auto newCapacity = std::max(size_t(4), 2 * _indexCapacity);
+      auto newBlock = _indexAllocator.allocate(newCapacity * sizeof(T *));
+      if (!newBlock) {
+        throw std::bad_alloc();
+      }
+      auto newIndex = static_cast<T **>(newBlock.ptr);
+      for (size_t i = 0; i < _numberOfSegments; ++i) {
+        newIndex[i] = segment(i);
+      }
+      _indexAllocator.deallocate(_indexBlock);
+      _indexBlock = newBlock;
+      _index = newIndex;
+      _indexCapacity = newCapacity;
+      _firstSegment = 0;
+    }
+
+    // Returns the place of a new last element, a new segment is appended if
+    // necessary
+    T *slotAtBack()
+    {
+      if (_begin + _size == _numberOfSegments * ElementsPerSegment) {
+        reserveIndex();
+        auto p = allocateSegment();
+        segment(_numberOfSegments) = p;
+        ++_numberOfSegments;
+      }
+      return slot(_begin + _size);
+    }
+
+    // Returns the place of a new first element, a new segment is prepended if
+    // necessary
+    T *slotAtFront()
+    {
+      if (_begin == 0) {
+        reserveIndex();
+        auto p = allocateSegment();
+        _firstSegment = (_firstSegment + _indexCapacity - 1) & (_indexCapacity - 1);
+        segment(0) = p;
+        ++_numberOfSegments;
+        _begin = ElementsPerSegment;
+      }
+      return slot(_begin - 1);
+    }
+
+    void releaseEmptySegments()
+    {
+      while (_numberOfSegments > 0 &&
+             _begin + _size <= (_numberOfSegments - 1) * ElementsPerSegment) {
+        --_numberOfSegments;
+        deallocateSegment(segment(_numberOfSegments));
+      }
+      while (_numberOfSegments > 0 && _begin >= ElementsPerSegment) {
+        deallocateSegment(segment(0));
+        _firstSegment = (_firstSegment + 1) & (_indexCapacity - 1);
+        --_numberOfSegments;
+        _begin -= ElementsPerSegment;
+      }
+      // an empty container starts again at the beginning of a segment
+      if (_size == 0) {
+        for (size_t i = 0; i < _numberOfSegments; ++i) {
+          deallocateSegment(segment(i));
+        }
+        _numberOfSegments = 0;
+        _firstSegment = 0;
+        _begin = 0;
+      }
+    }
+
+  public:
+    using value_type = T;
+    using size_type = size_t;
+    using difference_type = ptrdiff_t;
+    using reference = T &;
+    using const_reference = const T &;
+    using iterator = iterator_base<T>;
+    using const_iterator = iterator_base<const T>;
+    using allocator = Allocator;
+
+    static const size_t elements_per_segment = ElementsPerSegment;
+
+    explicit segmented_deque(Allocator &segments)
+      : _segments(std::addressof(segments))
+      , _index(nullptr)
+      , _indexCapacity(0)
+      , _firstSegment(0)
+      , _numberOfSegments(0)
+      , _begin(0)
+      , _size(0)
+    {
+    }
+
+    /**
+     * Copies the elements into segments of the same pool
+     */
+    segmented_deque(const segmented_deque &x)
+      : segmented_deque(*x._segments)
+    {
+      for (const auto &e : x) {
+        push_back(e);
+      }
+    }
+
+    segmented_deque(segmented_deque &&x)
+      : segmented_deque(*x._segments)
+    {
+      swap(x);
+    }
+
+    ~segmented_deque()
+    {
+      clear();
+      _indexAllocator.deallocate(_indexBlock);
+    }
+
+    segmented_deque &operator=(segmented_deque x)
+    {
+      swap(x);
+      return *this;
+    }
+
+    void swap(segmented_deque &x)
+    {
+      using std::swap;
+      swap(_segments, x._segments);
+      swap(_indexAllocator, x._indexAllocator);
+      swap(_indexBlock, x._indexBlock);
+      swap(_index, x._index);
+      swap(_indexCapacity, x._indexCapacity);
+      swap(_firstSegment, x._firstSegment);
+      swap(_numberOfSegments, x._numberOfSegments);
+      swap(_begin, x._begin);
+      swap(_size, x._size);
+    }
+
+    size_t size() const
+    {
+      return _size;
+    }
+
+    bool empty() const
+    {
+      return _size == 0;
+    }
+
+    /**
+     * Returns the number of segments, that are currently taken from the pool
+     */
+    size_t segments() const
+    {
+      return _numberOfSegments;
+    }
+
+    T &operator[](size_t i)
+    {
+      BOOST_ASSERT(i < _size);
+      return *slot(_begin + i);
+    }
+
+    const T &operator[](size_t i) const
+    {
+      BOOST_ASSERT(i < _size);
+      return *slot(_begin + i);
+    }
+
+    T &at(size_t i)
+    {
+      if (i >= _size) {
+        throw std::out_of_range("segmented_deque::at");
+      }
+      return (*this)[i];
+    }
+
+    const T &at(size_t i) const
+    {
+      if (i >= _size) {
+        throw std::out_of_range("segmented_deque::at");
+      }
+      return (*this)[i];
+    }
+
+    T &front()
+    {
+      return (*this)[0];
+    }
+
+    const T &front() const
+    {
+      return (*this)[0];
+    }
+
+    T &back()
+    {
+      return (*this)[_size - 1];
+    }
+
+    const T &back() const
+    {
+      return (*this)[_size - 1];
+    }
+
+    iterator begin()
+    {
+      return iterator(this, 0);
+    }
+
+    iterator end()
+    {
+      return iterator(this, _size);
+    }
+
+    const_iterator begin() const
+    {
+      return const_iterator(this, 0);
+    }
+
+    const_iterator end() const
+    {
+      return const_iterator(this, _size);
+    }
+
+    const_iterator cbegin() const
+    {
+      return begin();
+    }
+
+    const_iterator cend() const
+    {
+      return end();
+    }
+
+    template <typename... Args> T &emplace_back(Args &&... args)
+    {
+      auto p = slotAtBack();
+      ::new (p) T(std::forward<Args>(args)...);
+      ++_size;
+      return *p;
+    }
+
+    template <typename... Args> T &emplace_front(Args &&... args)
+    {
+      auto p = slotAtFront();
+      ::new (p) T(std::forward<Args>(args)...);
+      --_begin;
+      ++_size;
+      return *p;
+    }
+
+    void push_back(const T &x)
+    {
+      emplace_back(x);
+    }
+
+    void push_back(T &&x)
+    {
+      emplace_back(std::move(x));
+    }
+
+    void push_front(const T &x)
+    {
+      emplace_front(x);
+    }
+
+    void push_front(T &&x)
+    {
+      emplace_front(std::move(x));
+    }
+
+    void pop_back()
+    {
+      BOOST_ASSERT(_size > 0);
+      back().~T();
+      --_size;
+      releaseEmptySegments();
+    }
+
+    void pop_front()
+    {
+      BOOST_ASSERT(_size > 0);
+      front().~T();
+      ++_begin;
+      --_size;
+      releaseEmptySegments();
+    }
+
+    /**
+     * Destroys all elements and gives all segments back to the pool
+     */
+    void clear()
+    {
+      for_each_segment([](T *first, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+          first[i].~T();
+        }
+      });
+      for (size_t i = 0; i < _numberOfSegments; ++i) {
+        deallocateSegment(segment(i));
+      }
+      _numberOfSegments = 0;
+      _firstSegment = 0;
+      _begin = 0;
+      _size = 0;
+    }
+
+    /**
+     * Calls f(first, count) for the contiguous elements of each segment in
+     * order, so that they can be processed without any index lookup
+     */
+    template <class F> void for_each_segment(F f)
+    {
+      size_t position = _begin;
+      const size_t end = _begin + _size;
+      while (position < end) {
+        const auto count = std::min(ElementsPerSegment - (position & mask), end - position);
+        f(slot(position), count);
+        position += count;
+      }
+    }
+
+    template <class F> void for_each_segment(F f) const
+    {
+      const_cast<segmented_deque *>(this)->for_each_segment(
+          [&f](T *first, size_t count) { f(static_cast<const T *>(first), count); });
+    }
+  };
+
+  template <typename T, size_t ElementsPerSegment, class Allocator, class IndexAllocator>
+  const size_t segmented_deque<T, ElementsPerSegment, Allocator,
+                               IndexAllocator>::elements_per_segment;
+
+  template <typename T, size_t ElementsPerSegment, class Allocator, class IndexAllocator>
+  void swap(segmented_deque<T, ElementsPerSegment, Allocator, IndexAllocator> &a,
+            segmented_deque<T, ElementsPerSegment, Allocator, IndexAllocator> &b)
+  {
+    a.swap(b);
+  }
+}
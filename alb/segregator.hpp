@@ -106,8 +106,8 @@ namespace alb {
      * \return True, if the operation was successful
      */
     template <typename U = SmallAllocator, typename V = LargeAllocator>
-    typename std::enable_if<traits::has_expand<SmallAllocator>::value ||
-                            traits::has_expand<LargeAllocator>::value, bool>::type
+    typename std::enable_if<traits::has_expand<U>::value ||
+                            traits::has_expand<V>::value, bool>::type
     expand(block &b, size_t delta)
     {
       if (b.length <= Threshold && b.length + delta > Threshold) {
@@ -134,8 +134,8 @@ namespace alb {
      * \return True if one of the allocator owns it.
      */
     template <typename U = SmallAllocator, typename V = LargeAllocator>
-    typename std::enable_if<traits::has_expand<SmallAllocator>::value ||
-      traits::has_expand<LargeAllocator>::value, bool>::type
+    typename std::enable_if<traits::has_owns<U>::value &&
+      traits::has_owns<V>::value, bool>::type
       owns(const block &b) const
     {
       if (b.length <= Threshold) {
@@ -144,13 +144,30 @@ namespace alb {
       return V::owns(b);
     }
 
+    /**
+     * Returns the length, that the given block with its requested length
+     * really covers.
+     * This is only available if one of the Allocators implements it
+     * \param b The block with its requested length
+     */
+    template <typename U = SmallAllocator, typename V = LargeAllocator>
+    typename std::enable_if<traits::has_goodSize<U>::value ||
+      traits::has_goodSize<V>::value, size_t>::type
+      goodSize(const block &b) const
+    {
+      if (b.length <= Threshold) {
+        return traits::GoodSizer<U>::doIt(static_cast<const U&>(*this), b);
+      }
+      return traits::GoodSizer<V>::doIt(static_cast<const V&>(*this), b);
+    }
+
     /**
      * Deallocates all memory.
      * This is available if one of the allocators implement it.
      */
     template <typename U = SmallAllocator, typename V = LargeAllocator>
-    typename std::enable_if<traits::has_expand<SmallAllocator>::value ||
-      traits::has_expand<LargeAllocator>::value, void>::type
+    typename std::enable_if<traits::has_deallocateAll<U>::value ||
+      traits::has_deallocateAll<V>::value, void>::type
     deallocateAll()
     {
       traits::AllDeallocator<U>::doIt(static_cast<U&>(*this));
@@ -0,0 +1,257 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_base.hpp"
+#include "affix_allocator.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+
+namespace alb {
+
+  namespace internal {
+    /**
+     * The reference counter, that is placed in front of every shared block.
+     * It keeps the alignment of the underlying allocator for the payload.
+     * \ingroup group_internal
+     */
+    struct alignas(std::max_align_t) shared_block_prefix {
+      std::atomic<size_t> references;
+    };
+  }
+
+  template <class Allocator> class shared_block_allocator;
+
+  /**
+   * A shared_block refers to a range of memory, that was allocated by an
+   * alb::shared_block_allocator, and shares the ownership of the complete
+   * allocation with all copies and slices of it. The memory is returned to
+   * the allocator, when the last of them is destroyed or reset.
+   * Copying, slicing and destroying are thread safe, because the reference
+   * counter is atomic; the content itself is not synchronized.
+   * \tparam Allocator The underlying allocator of the shared_block_allocator
+   *
+   * \ingroup group_allocators group_shared
+   */
+  template <class Allocator> class shared_block {
+    friend class shared_block_allocator<Allocator>;
+
+    shared_block_allocator<Allocator> *_owner;
+    block _origin;
+    void *_ptr;
+    size_t _length;
+
+    shared_block(shared_block_allocator<Allocator> *owner, const block &origin, void *ptr,
+                 size_t length)
+      : _owner(owner)
+      , _origin(origin)
+      , _ptr(ptr)
+      , _length(length)
+    {
+    }
+
+    internal::shared_block_prefix *prefix() const
+    {
+      return reinterpret_cast<internal::shared_block_prefix *>(_origin.ptr) - 1;
+    }
+
+    void acquire() const
+    {
+      if (_origin) {
+        prefix()->references.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+
+  public:
+    shared_block()
+      : _owner(nullptr)
+      , _ptr(nullptr)
+      , _length(0)
+    {
+    }
+
+    shared_block(const shared_block &x)
+      : _owner(x._owner)
+      , _origin(x._origin)
+      , _ptr(x._ptr)
+      , _length(x._length)
+    {
+      acquire();
+    }
+
+    shared_block(shared_block &&x)
+      : _owner(x._owner)
+      , _origin(x._origin)
+      , _ptr(x._ptr)
+      , _length(x._length)
+    {
+      x._owner = nullptr;
+      x._origin.reset();
+      x._ptr = nullptr;
+      x._length = 0;
+    }
+
+    shared_block &operator=(const shared_block &x)
+    {
+      if (this != &x) {
+        x.acquire();
+        reset();
+        _owner = x._owner;
+        _origin = x._origin;
+        _ptr = x._ptr;
+        _length = x._length;
+      }
+      return *this;
+    }
+
+    shared_block &operator=(shared_block &&x)
+    {
+      if (this != &x) {
+        reset();
+        _owner = x._owner;
+        _origin = x._origin;
+        _ptr = x._ptr;
+        _length = x._length;
+        x._owner = nullptr;
+        x._origin.reset();
+        x._ptr = nullptr;
+        x._length = 0;
+      }
+      return *this;
+    }
+
+    ~shared_block()
+    {
+      reset();
+    }
+
+    /**
+     * Releases the ownership. The last owner returns the memory to the
+     * allocator.
+     */
+    void reset()
+    {
+      if (!_origin) {
+        return;
+      }
+      if (prefix()->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        _owner->release(_origin);
+      }
+      _owner = nullptr;
+      _origin.reset();
+      _ptr = nullptr;
+      _length = 0;
+    }
+
+    /**
+     * Returns a view of n bytes starting at offset within this view, that
+     * shares the ownership of the complete allocation.
+     * \param offset The start relative to this view
+     * \param n The length, it is truncated to the end of this view
+     */
+    shared_block slice(size_t offset, size_t n) const
+    {
+      if (!_origin || offset > _length) {
+        return {};
+      }
+      acquire();
+      return {_owner, _origin, static_cast<char *>(_ptr) + offset, std::min(n, _length - offset)};
+    }
+
+    void *ptr() const
+    {
+      return _ptr;
+    }
+
+    size_t length() const
+    {
+      return _length;
+    }
+
+    /**
+     * Returns the viewed range as a plain block, without any ownership
+     */
+    block view() const
+    {
+      return {_ptr, _length};
+    }
+
+    /**
+     * Returns the number of shared_blocks that currently share the allocation
+     */
+    size_t use_count() const
+    {
+      return _origin ? prefix()->references.load(std::memory_order_relaxed) : 0;
+    }
+
+    explicit operator bool() const
+    {
+      return _origin.ptr != nullptr;
+    }
+  };
+
+  /**
+   * This allocator provides alb::shared_block instances, whose atomic reference
+   * counter is placed by an alb::affix_allocator as prefix in front of the
+   * payload. So no separate control block is allocated and a payload can be
+   * passed to many consumers without copying it.
+   * The allocator must outlive all blocks that it provided. It is as far thread
+   * safe as the underlying Allocator is.
+   * \tparam Allocator The allocator that is used as underlying allocator
+   *
+   * \ingroup group_allocators group_shared
+   */
+  template <class Allocator> class shared_block_allocator {
+    friend class shared_block<Allocator>;
+
+    affix_allocator<Allocator, internal::shared_block_prefix> _allocator;
+
+    void release(block &b)
+    {
+      _allocator.deallocate(b);
+    }
+
+  public:
+    using allocator = Allocator;
+    using block_type = shared_block<Allocator>;
+
+    shared_block_allocator()
+    {
+    }
+
+    shared_block_allocator(const shared_block_allocator &) = delete;
+    shared_block_allocator &operator=(const shared_block_allocator &) = delete;
+
+    /**
+     * Allocates n bytes with an initial reference count of one
+     * \param n The number of requested bytes
+     * \return The shared block, it is empty if no memory is available
+     */
+    shared_block<Allocator> allocate(size_t n)
+    {
+      auto b = _allocator.allocate(n);
+      if (!b) {
+        return {};
+      }
+      _allocator.outerToPrefix(b)->references.store(1, std::memory_order_relaxed);
+      return {this, b, b.ptr, b.length};
+    }
+
+    /**
+     * Checks if the given shared block was provided by this allocator
+     */
+    bool owns(const shared_block<Allocator> &b) const
+    {
+      return b._owner == this;
+    }
+  };
+}
@@ -14,6 +14,7 @@
 #include "internal/dynastic.hpp"
 #include "internal/reallocator.hpp"
 #include "internal/heap_helpers.hpp"
+#include "internal/tracepoints.hpp"
 
 #include <atomic>
 #include <algorithm>
@@ -39,6 +40,8 @@ namespace alb {
  * _numberOfChunks.value() * _chunkSize.value()
  * It has a overhead of one bit per block and linear complexity for allocation
  * and deallocation operations.
+ * A deallocated block frees only the chunks its length covers completely,
+ * so a block with its requested length must be rounded up by ::goodSize().
  * It is thread safe, except the moment of instantiation.
  * As far as possible only a shared lock + an atomic operation is used during
  * the memory operations
@@ -76,6 +79,7 @@ namespace alb {
 
   public:
     static const bool supports_truncated_deallocation = true;
+    static const bool shrinks_in_place = true;
 
     using allocator = Allocator;
 
@@ -131,6 +135,27 @@ namespace alb {
       return _chunkSize.value();
     }
 
+    /**
+     * Returns the complete memory region, out of which all blocks are served
+     */
+    const block &buffer() const
+    {
+      return _buffer;
+    }
+
+    /**
+     * Copies the control bitmap under the exclusive lock, so that no block
+     * over multiple registers is half allocated. A set bit means a free chunk
+     * \param target Must provide space for number_of_chunk() / 64 values
+     */
+    void copy_control(uint64_t *target)
+    {
+      boost::unique_lock<boost::shared_mutex> guard(_mutex);
+      for (size_t i = 0; i < _controlSize; ++i) {
+        target[i] = _control[i].load();
+      }
+    }
+
     ~shared_heap()
     {
       boost::unique_lock<boost::shared_mutex> guard(_mutex);
@@ -143,6 +168,16 @@ namespace alb {
              b.ptr < (static_cast<char *>(_buffer.ptr) + _buffer.length);
     }
 
+    /**
+     * Returns the length, that the given block with its requested length
+     * really covers. It must be passed on deallocation, if not the block of
+     * ::allocate() with its returned length is passed.
+     */
+    size_t goodSize(const block &b) const
+    {
+      return internal::roundToAlignment(_chunkSize.value(), b.length);
+    }
+
     block allocate(size_t n)
     {
       if (n == 0) {
@@ -158,25 +193,11 @@ namespace alb {
       size_t numberOfBlocks = numberOfAlignedBytes / _chunkSize.value();
       numberOfBlocks = std::max(static_cast<size_t>(1), numberOfBlocks);
 
-      if (numberOfBlocks < 64) {
-        auto result = allocateWithinASingleControlRegister(numberOfBlocks);
-        if (result) {
-          return result;
-        }
-      }
-      else if (numberOfBlocks == 64) {
-        auto result = allocateWithinCompleteControlRegister(numberOfBlocks);
-        if (result) {
-          return result;
-        }
-      }
-      else if ((numberOfBlocks % 64) == 0) {
-        auto result = allocateMultipleCompleteControlRegisters(numberOfBlocks);
-        if (result) {
-          return result;
-        }
-      }
-      return allocateWithRegisterOverlap(numberOfBlocks);
+      size_t scanned = 0;
+      auto result = allocateChunks(numberOfBlocks, scanned);
+      ALB_TRACE3(heap_scan, this, numberOfBlocks, scanned);
+      ALB_TRACE3(allocate, this, n, result.ptr);
+      return result;
     }
 
     void deallocate(block &b)
@@ -189,19 +210,8 @@ namespace alb {
         return;
       }
 
-      const auto context = blockToContext(b);
-
-      // printf("Used Block %d in thread %d\n", blockIndex,
-      // std::this_thread::get_id());
-      if (context.subIndex + context.usedChunks <= 64) {
-        setWithinSingleRegister<shared_helpers::SharedLock, true>(context);
-      }
-      else if ((context.usedChunks % 64) == 0) {
-        deallocateForMultipleCompleteControlRegister(context);
-      }
-      else {
-        deallocateWithControlRegisterOverlap(context);
-      }
+      ALB_TRACE3(deallocate, this, b.ptr, b.length);
+      freeChunks(blockToContext(b));
       b.reset();
     }
 
@@ -213,6 +223,45 @@ namespace alb {
     }
 
     bool reallocate(block &b, size_t n)
+    {
+      const auto oldPtr = b.ptr;
+      const auto result = reallocateChunks(b, n);
+      // a failed reallocation is reported with a null pointer
+      ALB_TRACE4(reallocate, this, oldPtr, n, result ? b.ptr : nullptr);
+      return result;
+    }
+
+    bool expand(block &b, size_t delta)
+    {
+      if (delta == 0) {
+        return true;
+      }
+
+      const auto context = blockToContext(b);
+      const auto numberOfAdditionalNeededBlocks = static_cast<int>(
+          internal::roundToAlignment(_chunkSize.value(), delta) / _chunkSize.value());
+
+      // the extension starts behind the block, maybe in a following register
+      const auto extensionIndex =
+          context.registerIndex * 64 + context.subIndex + context.usedChunks;
+      if (static_cast<size_t>(extensionIndex + numberOfAdditionalNeededBlocks) >
+          _numberOfChunks.value()) {
+        return false;
+      }
+      const BlockContext extension(extensionIndex / 64, extensionIndex % 64,
+                                   numberOfAdditionalNeededBlocks);
+      const bool result = extension.subIndex + extension.usedChunks <= 64
+                              ? testAndSetWithinSingleRegister<false>(extension)
+                              : testAndSetOverMultipleRegisters<false>(extension);
+      ALB_TRACE4(expand, this, b.ptr, delta, result);
+      if (result) {
+        b.length += numberOfAdditionalNeededBlocks * _chunkSize.value();
+      }
+      return result;
+    }
+
+  private:
+    bool reallocateChunks(block &b, size_t n)
     {
       if (internal::reallocator<shared_heap>::isHandledDefault(*this, b, n)) {
         return true;
@@ -226,16 +275,14 @@ namespace alb {
         return true;
       }
       if (b.length > n) {
-        auto context = blockToContext(b);
-        if (context.subIndex + context.usedChunks <= 64) {
-          setWithinSingleRegister<shared_helpers::SharedLock, true>(
-              BlockContext(context.registerIndex, context.subIndex + numberOfNewNeededBlocks,
-                           context.usedChunks - numberOfNewNeededBlocks));
-        }
-        else {
-          deallocateWithControlRegisterOverlap(
-              BlockContext(context.registerIndex, context.subIndex + numberOfNewNeededBlocks,
-                           context.usedChunks - numberOfNewNeededBlocks));
+        const auto context = blockToContext(b);
+        if (context.usedChunks > numberOfNewNeededBlocks) {
+          // the chunks behind the new end are freed like a block of their own,
+          // that may start in a following register
+          const block tail(static_cast<char *>(b.ptr) +
+                               numberOfNewNeededBlocks * _chunkSize.value(),
+                           (context.usedChunks - numberOfNewNeededBlocks) * _chunkSize.value());
+          freeChunks(blockToContext(tail));
         }
         b.length = numberOfNewNeededBlocks * _chunkSize.value();
         return true;
@@ -243,36 +290,29 @@ namespace alb {
       return internal::reallocateWithCopy(*this, *this, b, n);
     }
 
-    bool expand(block &b, size_t delta)
+    block allocateChunks(size_t numberOfBlocks, size_t &scanned)
     {
-      if (delta == 0) {
-        return true;
+      if (numberOfBlocks < 64) {
+        auto result = allocateWithinASingleControlRegister(numberOfBlocks, scanned);
+        if (result) {
+          return result;
+        }
       }
-
-      const auto context = blockToContext(b);
-      const auto numberOfAdditionalNeededBlocks = static_cast<int>(
-          internal::roundToAlignment(_chunkSize.value(), delta) / _chunkSize.value());
-
-      if (context.subIndex + context.usedChunks + numberOfAdditionalNeededBlocks <= 64) {
-        if (testAndSetWithinSingleRegister<false>(
-                BlockContext(context.registerIndex, context.subIndex + context.usedChunks,
-                             numberOfAdditionalNeededBlocks))) {
-          b.length += numberOfAdditionalNeededBlocks * _chunkSize.value();
-          return true;
+      else if (numberOfBlocks == 64) {
+        auto result = allocateWithinCompleteControlRegister(numberOfBlocks, scanned);
+        if (result) {
+          return result;
         }
-        return false;
       }
-      if (testAndSetOverMultipleRegisters<false>(BlockContext(context.registerIndex,
-                                                              context.subIndex + context.usedChunks,
-                                                              numberOfAdditionalNeededBlocks))) {
-        b.length += numberOfAdditionalNeededBlocks * _chunkSize.value();
-        return true;
+      else if ((numberOfBlocks % 64) == 0) {
+        auto result = allocateMultipleCompleteControlRegisters(numberOfBlocks, scanned);
+        if (result) {
+          return result;
+        }
       }
-
-      return false;
+      return allocateWithRegisterOverlap(numberOfBlocks, scanned);
     }
 
-  private:
     void init()
     {
       _controlSize = _numberOfChunks.value() / 64;
@@ -303,8 +343,10 @@ namespace alb {
       const auto blockIndex = static_cast<int>(
           (static_cast<char *>(b.ptr) - static_cast<char *>(_buffer.ptr)) / _chunkSize.value());
 
-      return BlockContext(blockIndex / 64, blockIndex % 64,
-                          static_cast<int>(b.length / _chunkSize.value()));
+      // a truncated block frees only the chunks its length covers completely
+      const auto usedChunks = static_cast<int>(b.length / _chunkSize.value());
+
+      return BlockContext(blockIndex / 64, blockIndex % 64, usedChunks);
     }
 
     template <bool Used> bool testAndSetWithinSingleRegister(const BlockContext &context)
@@ -393,7 +435,7 @@ namespace alb {
           chunksToTest = 0;
         }
         registerIndex++;
-        if (registerIndex > _controlSize) {
+        if (chunksToTest > 0 && registerIndex >= _controlSize) {
           return false;
         }
       } while (chunksToTest > 0);
@@ -418,7 +460,7 @@ namespace alb {
       } while (!CAS(_control[context.registerIndex], currentRegister, newRegister));
     }
 
-    block allocateWithinASingleControlRegister(size_t numberOfBlocks)
+    block allocateWithinASingleControlRegister(size_t numberOfBlocks, size_t &scanned)
     {
       // we must assume that we may find a free location, but that it is later
       // already used during the set operation
@@ -441,6 +483,7 @@ namespace alb {
                 boost::shared_lock<boost::shared_mutex> guard(_mutex);
 
                 if (CAS(_control[controlIndex], currentControlRegister, newControlRegister)) {
+                  scanned += controlIndex + 1;
                   size_t ptrOffset = (controlIndex * 64 + i) * _chunkSize.value();
 
                   return block(static_cast<char *>(_buffer.ptr) + ptrOffset,
@@ -454,12 +497,13 @@ namespace alb {
           controlIndex++;
         }
         if (controlIndex == _controlSize) {
+          scanned += _controlSize;
           return block();
         }
       } while (true);
     }
 
-    block allocateWithinCompleteControlRegister(size_t numberOfBlocks)
+    block allocateWithinCompleteControlRegister(size_t numberOfBlocks, size_t &scanned)
     {
       // we must assume that we may find a free location, but that it is later
       // already used during the CAS set operation
@@ -469,6 +513,7 @@ namespace alb {
             std::find_if(_control, _control + _controlSize,
                          [this](const std::atomic<uint64_t> &v) { return v.load() == all_set; });
 
+        scanned += std::min<size_t>(freeChunk - _control + 1, _controlSize);
         if (freeChunk == _control + _controlSize) {
           return block();
         }
@@ -484,7 +529,7 @@ namespace alb {
       } while (true);
     }
 
-    block allocateMultipleCompleteControlRegisters(size_t numberOfBlocks)
+    block allocateMultipleCompleteControlRegisters(size_t numberOfBlocks, size_t &scanned)
     {
       // This branch works on multiple chunks at the same time and so a real
       // lock is necessary.
@@ -496,8 +541,10 @@ namespace alb {
           [](const std::atomic<uint64_t> &v, const uint64_t &p) { return v.load() == p; });
 
       if (freeFirstChunk == _control + _controlSize) {
+        scanned += _controlSize;
         return block();
       }
+      scanned += freeFirstChunk - _control + neededChunks;
       auto p = freeFirstChunk;
       while (p < freeFirstChunk + neededChunks) {
         CAS_P(p, const_cast<uint64_t &>(all_set), all_zero);
@@ -509,7 +556,7 @@ namespace alb {
                    numberOfBlocks * _chunkSize.value());
     }
 
-    block allocateWithRegisterOverlap(size_t numberOfBlocks)
+    block allocateWithRegisterOverlap(size_t numberOfBlocks, size_t &scanned)
     {
       // search for free area
       static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t),
@@ -545,6 +592,10 @@ namespace alb {
         p++;
       };
 
+      scanned += std::min<size_t>((p - reinterpret_cast<unsigned char *>(_control)) /
+                                          sizeof(uint64_t) +
+                                      1,
+                                  _controlSize);
       if (p != lastp && freeBlocksCount >= numberOfBlocks) {
         size_t ptrOffset =
             (chunkStart - reinterpret_cast<unsigned char *>(_control)) * 8 * _chunkSize.value();
@@ -569,6 +620,22 @@ namespace alb {
       }
     }
 
+    void freeChunks(const BlockContext &context)
+    {
+      if (context.usedChunks == 0) {
+        return;
+      }
+      if (context.subIndex + context.usedChunks <= 64) {
+        setWithinSingleRegister<shared_helpers::SharedLock, true>(context);
+      }
+      else if (context.subIndex == 0 && (context.usedChunks % 64) == 0) {
+        deallocateForMultipleCompleteControlRegister(context);
+      }
+      else {
+        deallocateWithControlRegisterOverlap(context);
+      }
+    }
+
     void deallocateWithControlRegisterOverlap(const BlockContext &context)
     {
       setOverMultipleRegisters<shared_helpers::SharedLock, true>(context);
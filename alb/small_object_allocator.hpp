@@ -0,0 +1,382 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_base.hpp"
+#include "internal/dynastic.hpp"
+#include "internal/reallocator.hpp"
+
+#include <boost/assert.hpp>
+
+namespace alb {
+  /**
+   * The small_object_allocator is an implementation of the small object
+   * allocator as it was described by Andrei Alexandrescu in "Modern C++ Design".
+   * It is intended for very small blocks, e.g. 1 - 16 bytes, where the rounding
+   * of a freelist or the header of ::malloc() would cost more than the object
+   * itself.
+   * Memory is taken from the Allocator in chunks of NumberOfBlocks blocks. Each
+   * free block inside a chunk stores in its first byte the index of the next
+   * free block of the same chunk, so no additional memory per block is needed.
+   * The chunks are managed in an array, that is allocated by the Allocator as
+   * well. Allocations are served from the chunk that served the last
+   * allocation, deallocations search the owning chunk starting from the chunk
+   * that owned the last deallocated block.
+   * At most one completely unused chunk is kept, all others are returned to
+   * the Allocator.
+   * Each returned block has the size MaxSize, so by setting MinSize and MaxSize
+   * to the same value every object costs exactly its size. The returned blocks
+   * are not aligned beyond the block size.
+   * MinSize and MaxSize can be set at runtime by instantiating this with
+   * internal::DynasticDynamicSet, so it can be used within an alb::bucketizer
+   * with a step size of 1.
+   * This allocator is not thread safe!
+   * \tparam Allocator The allocator that is used to allocate the chunks
+   * \tparam MinSize The lower boundary of accepted requests
+   * \tparam MaxSize The upper boundary of accepted requests and the size of
+   *                 each block
+   * \tparam NumberOfBlocks The number of blocks per chunk, at most 255
+   *
+   * \ingroup group_allocators
+   */
+  template <class Allocator, size_t MinSize, size_t MaxSize, size_t NumberOfBlocks = 255>
+  class small_object_allocator {
+    static_assert(0 < NumberOfBlocks && NumberOfBlocks <= 255,
+                  "The number of blocks per chunk must be within [1, 255]!");
+
+    struct chunk {
+      unsigned char *data;
+      unsigned char firstAvailableBlock;
+      unsigned char blocksAvailable;
+    };
+
+    static const size_t npos = static_cast<size_t>(-1);
+
+    Allocator _allocator;
+
+    internal::dynastic<(MinSize == internal::DynasticDynamicSet ? internal::DynasticDynamicSet
+                                                                : MinSize),
+                       internal::DynasticDynamicSet> _lowerBound;
+    internal::dynastic<(MaxSize == internal::DynasticDynamicSet ? internal::DynasticDynamicSet
+                                                                : MaxSize),
+                       internal::DynasticDynamicSet> _upperBound;
+
+    block _chunkBuffer;
+    chunk *_chunks;
+    size_t _numberOfChunks;
+
+    size_t _allocChunk;
+    size_t _deallocChunk;
+    size_t _emptyChunk;
+
+    small_object_allocator(const small_object_allocator &) = delete;
+    small_object_allocator &operator=(const small_object_allocator &) = delete;
+
+    size_t chunkLength() const
+    {
+      return _upperBound.value() * NumberOfBlocks;
+    }
+
+    bool chunkContains(const chunk &c, const void *p) const
+    {
+      auto cp = static_cast<const unsigned char *>(p);
+      return c.data <= cp && cp < c.data + chunkLength();
+    }
+
+    bool growChunkBuffer()
+    {
+      const size_t capacity = _chunkBuffer.length / sizeof(chunk);
+      if (_numberOfChunks < capacity) {
+        return true;
+      }
+      const size_t newCapacity = capacity == 0 ? 4 : capacity * 2;
+      if (!_allocator.reallocate(_chunkBuffer, newCapacity * sizeof(chunk))) {
+        return false;
+      }
+      _chunks = static_cast<chunk *>(_chunkBuffer.ptr);
+      return true;
+    }
+
+    size_t addChunk()
+    {
+      if (!growChunkBuffer()) {
+        return npos;
+      }
+      auto chunkMem = _allocator.allocate(chunkLength());
+      if (!chunkMem) {
+        return npos;
+      }
+      auto &c = _chunks[_numberOfChunks];
+      c.data = static_cast<unsigned char *>(chunkMem.ptr);
+      c.firstAvailableBlock = 0;
+      c.blocksAvailable = static_cast<unsigned char>(NumberOfBlocks);
+
+      // every free block knows the index of its successor
+      const size_t blockSize = _upperBound.value();
+      for (size_t i = 0; i < NumberOfBlocks; ++i) {
+        c.data[i * blockSize] = static_cast<unsigned char>(i + 1);
+      }
+      return _numberOfChunks++;
+    }
+
+    void releaseChunk(size_t index)
+    {
+      block chunkMem(_chunks[index].data, chunkLength());
+      _allocator.deallocate(chunkMem);
+
+      // the last chunk fills the gap, so all hints to it must follow
+      const size_t last = _numberOfChunks - 1;
+      if (index != last) {
+        _chunks[index] = _chunks[last];
+      }
+      --_numberOfChunks;
+
+      for (auto hint : {&_allocChunk, &_deallocChunk, &_emptyChunk}) {
+        if (*hint == index) {
+          *hint = npos;
+        }
+        else if (*hint == last) {
+          *hint = index;
+        }
+      }
+    }
+
+    size_t findChunk(const void *p) const
+    {
+      if (_numberOfChunks == 0) {
+        return npos;
+      }
+      // search in both directions, starting at the last used chunk
+      auto lo = static_cast<ptrdiff_t>(_deallocChunk < _numberOfChunks ? _deallocChunk : 0);
+      auto hi = lo + 1;
+      const auto end = static_cast<ptrdiff_t>(_numberOfChunks);
+
+      while (lo >= 0 || hi < end) {
+        if (lo >= 0) {
+          if (chunkContains(_chunks[lo], p)) {
+            return static_cast<size_t>(lo);
+          }
+          --lo;
+        }
+        if (hi < end) {
+          if (chunkContains(_chunks[hi], p)) {
+            return static_cast<size_t>(hi);
+          }
+          ++hi;
+        }
+      }
+      return npos;
+    }
+
+    void shrink()
+    {
+      while (_numberOfChunks > 0) {
+        releaseChunk(_numberOfChunks - 1);
+      }
+      _allocator.deallocate(_chunkBuffer);
+      _chunks = nullptr;
+    }
+
+  public:
+    using allocator = Allocator;
+    static const size_t number_of_blocks = NumberOfBlocks;
+    static const bool supports_truncated_deallocation = false;
+
+    small_object_allocator()
+      : _chunks(nullptr)
+      , _numberOfChunks(0)
+      , _allocChunk(npos)
+      , _deallocChunk(npos)
+      , _emptyChunk(npos)
+    {
+    }
+
+    /**
+     * Constructs a small_object_allocator with the specified bounding edges
+     * This c'tor is just available if the template parameter MinSize
+     * and MaxSize are set to DynasticDynamicSet.
+     * \param minSize The lower boundary accepted by this Allocator
+     * \param maxSize The upper boundary accepted by this Allocator
+     */
+    small_object_allocator(size_t minSize, size_t maxSize)
+      : small_object_allocator()
+    {
+      _lowerBound.value(minSize);
+      _upperBound.value(maxSize);
+    }
+
+    /**
+     * Frees all chunks. Beware of using allocated blocks given by
+     * this allocator after calling this.
+     */
+    ~small_object_allocator()
+    {
+      shrink();
+    }
+
+    /**
+     * Set the min and max boundary of this allocator. This method is
+     * just available if the template parameter MinSize and MaxSize
+     * are set to DynasticDynamicSet.
+     * \param minSize The lower boundary accepted by this Allocator
+     * \param maxSize The upper boundary accepted by this Allocator
+     */
+    void setMinMax(size_t minSize, size_t maxSize)
+    {
+      BOOST_ASSERT_MSG(_numberOfChunks == 0,
+                       "Changing the bounds after the first allocation is not wise!");
+
+      _lowerBound.value(minSize);
+      _upperBound.value(maxSize);
+    }
+
+    /**
+     * Returns the lower boundary
+     */
+    size_t min_size() const
+    {
+      return _lowerBound.value();
+    }
+
+    /**
+     * Returns the upper boundary
+     */
+    size_t max_size() const
+    {
+      return _upperBound.value();
+    }
+
+    /**
+     * Provides a block of MaxSize bytes out of the current chunk. If no chunk
+     * has a free block any more, a new chunk is allocated.
+     * \param n The number of requested bytes. It must be within the boundary
+     *          of the allocator, otherwise an empty block is returned.
+     * \return The allocated block
+     */
+    block allocate(size_t n)
+    {
+      BOOST_ASSERT_MSG(_upperBound.value() != internal::DynasticUndefined,
+                       "The upper bound was not initialized!");
+
+      if (n == 0 || n < _lowerBound.value() || _upperBound.value() < n) {
+        return {};
+      }
+
+      if (_allocChunk == npos || _chunks[_allocChunk].blocksAvailable == 0) {
+        _allocChunk = npos;
+        for (size_t i = 0; i < _numberOfChunks; ++i) {
+          if (_chunks[i].blocksAvailable > 0) {
+            _allocChunk = i;
+            break;
+          }
+        }
+        if (_allocChunk == npos) {
+          _allocChunk = addChunk();
+          if (_allocChunk == npos) {
+            return {};
+          }
+          _deallocChunk = _allocChunk;
+        }
+      }
+
+      if (_allocChunk == _emptyChunk) {
+        _emptyChunk = npos;
+      }
+
+      auto &c = _chunks[_allocChunk];
+      BOOST_ASSERT(c.blocksAvailable > 0);
+
+      auto p = c.data + c.firstAvailableBlock * _upperBound.value();
+      c.firstAvailableBlock = *p;
+      --c.blocksAvailable;
+
+      return {p, _upperBound.value()};
+    }
+
+    /**
+     * Returns the given block to its chunk and resets it. If this chunk
+     * becomes completely unused and there is already another unused chunk,
+     * then it is returned to the Allocator.
+     * \param b The block to free
+     */
+    void deallocate(block &b)
+    {
+      if (!b) {
+        return;
+      }
+
+      const auto index = findChunk(b.ptr);
+      if (index == npos) {
+        BOOST_ASSERT_MSG(false, "It is not wise to let me deallocate a foreign Block!");
+        return;
+      }
+      _deallocChunk = index;
+
+      auto &c = _chunks[index];
+      auto p = static_cast<unsigned char *>(b.ptr);
+      BOOST_ASSERT((p - c.data) % _upperBound.value() == 0);
+
+      *p = c.firstAvailableBlock;
+      c.firstAvailableBlock = static_cast<unsigned char>((p - c.data) / _upperBound.value());
+      ++c.blocksAvailable;
+      b.reset();
+
+      if (c.blocksAvailable == NumberOfBlocks) {
+        if (_emptyChunk != npos && _emptyChunk != index) {
+          releaseChunk(index);
+        }
+        else {
+          _emptyChunk = index;
+        }
+      }
+    }
+
+    /**
+     * Reallocates the given block. In this case only trivial case can lead to
+     * a positive result. In general reallocation to a different size > 0 is not
+     * supported by this allocator.
+     * \param b The block to reallocate
+     * \param n The new size
+     * \return True, if the reallocation was successful.
+     */
+    bool reallocate(block &b, size_t n)
+    {
+      if (internal::reallocator<small_object_allocator>::isHandledDefault(*this, b, n)) {
+        return true;
+      }
+      return false;
+    }
+
+    /**
+     * Checks the ownership of the given block
+     * \param b The block to check
+     * \return True, if it is lies within one of the chunks of this allocator
+     */
+    bool owns(const block &b) const
+    {
+      return b && _lowerBound.value() <= b.length && b.length <= _upperBound.value() &&
+             findChunk(b.ptr) != npos;
+    }
+
+    /**
+     * Returns all chunks to the Allocator. Beware of using allocated blocks
+     * given by this allocator after calling this.
+     */
+    void deallocateAll()
+    {
+      while (_numberOfChunks > 0) {
+        releaseChunk(_numberOfChunks - 1);
+      }
+    }
+  };
+
+  template <class Allocator, size_t MinSize, size_t MaxSize, size_t NumberOfBlocks>
+  const size_t small_object_allocator<Allocator, MinSize, MaxSize, NumberOfBlocks>::number_of_blocks;
+}
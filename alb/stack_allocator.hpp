@@ -39,6 +39,7 @@ namespace alb {
     using allocator = stack_allocator;
 
     static const bool supports_truncated_deallocation = true;
+    static const bool shrinks_in_place = true;
     static const size_t max_size = MaxSize;
     static const size_t alignment = Alignment;
 
@@ -167,6 +168,17 @@ namespace alb {
       return b && (b.ptr >= _data && b.ptr < _data + MaxSize);
     }
 
+    /**
+     * Returns the length, that the given block with its requested length
+     * really covers. Only with it the most recently allocated block is
+     * recognized on deallocation.
+     * \param b The block with its requested length
+     */
+    size_t goodSize(const block &b) const
+    {
+      return internal::roundToAlignment(Alignment, b.length);
+    }
+
     /**
      * Sets all possibly provided memory to free.
      * Be warned that all usage of previously allocated blocks results in
@@ -0,0 +1,368 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_base.hpp"
+
+#include <boost/assert.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ALB_HAS_SSE2 1
+#endif
+
+namespace alb {
+
+  namespace internal {
+    /**
+     * FNV-1a hash over n bytes
+     * \ingroup group_internal
+     */
+    inline uint64_t hashBytes(const char *p, size_t n)
+    {
+      uint64_t result = 14695981039346656037ull;
+      for (size_t i = 0; i < n; ++i) {
+        result ^= static_cast<unsigned char>(p[i]);
+        result *= 1099511628211ull;
+      }
+      return result;
+    }
+  }
+
+  /**
+   * The string_interner stores every distinct string exactly once. Identical
+   * strings that are interned return the same, stable view, so they can be
+   * compared by comparing their data pointers.
+   * The characters are stored zero terminated and contiguously in segments of
+   * SegmentSize bytes, which are taken from the Allocator and used like a
+   * region. Strings that do not fit into a segment get a segment of their own.
+   * The strings are indexed by an open addressing hash table. Each slot has a
+   * control byte with seven bits of the hash, so that a group of 16 slots is
+   * checked with a single SSE2 compare (if available) before any string is
+   * compared.
+   * Single strings cannot be removed, but all can be released at once by
+   * deallocateAll().
+   * This class is not thread safe!
+   * \tparam Allocator The allocator that provides the segments and the table
+   * \tparam SegmentSize The number of bytes that are allocated at once for
+   *         storing the characters
+   *
+   * \ingroup group_allocators
+   */
+  template <class Allocator, size_t SegmentSize = 64 * 1024> class string_interner {
+    struct segment {
+      segment *next;
+      size_t length;
+    };
+
+    struct entry {
+      const char *data;
+      size_t length;
+      uint64_t hash;
+    };
+
+    static const size_t group_size = 16;
+    static const unsigned char empty_slot = 0x80;
+
+    static_assert(SegmentSize > sizeof(segment), "The segment size is too small!");
+
+    Allocator _allocator;
+
+    segment *_segments;
+    char *_current;
+    char *_end;
+
+    block _controlBuffer;
+    block _entryBuffer;
+    unsigned char *_control;
+    entry *_entries;
+    size_t _capacity;
+    size_t _size;
+
+    string_interner(const string_interner &) = delete;
+    string_interner &operator=(const string_interner &) = delete;
+
+    static unsigned char tagOf(uint64_t hash)
+    {
+      return static_cast<unsigned char>(hash & 0x7f);
+    }
+
+    /**
+     * Returns a bit mask of all slots within the group that carry the tag
+     */
+    static unsigned matchTag(const unsigned char *group, unsigned char tag)
+    {
+#ifdef ALB_HAS_SSE2
+      auto ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+      return static_cast<unsigned>(
+          _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(static_cast<char>(tag)))));
+#else
+      unsigned result = 0;
+      for (size_t i = 0; i < group_size; ++i) {
+        result |= (group[i] == tag ? 1u : 0u) << i;
+      }
+      return result;
+#endif
+    }
+
+    /**
+     * Returns a bit mask of all empty slots within the group
+     */
+    static unsigned matchEmpty(const unsigned char *group)
+    {
+#ifdef ALB_HAS_SSE2
+      auto ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+      return static_cast<unsigned>(_mm_movemask_epi8(ctrl));
+#else
+      unsigned result = 0;
+      for (size_t i = 0; i < group_size; ++i) {
+        result |= ((group[i] & empty_slot) ? 1u : 0u) << i;
+      }
+      return result;
+#endif
+    }
+
+    static size_t lowestBit(unsigned mask)
+    {
+      size_t result = 0;
+      while ((mask & 1u) == 0) {
+        mask >>= 1;
+        ++result;
+      }
+      return result;
+    }
+
+    const entry *lookup(const char *s, size_t n, uint64_t hash) const
+    {
+      if (_capacity == 0) {
+        return nullptr;
+      }
+      const auto tag = tagOf(hash);
+      const size_t groupMask = _capacity / group_size - 1;
+      size_t g = static_cast<size_t>(hash >> 7) & groupMask;
+
+      // triangular probing visits every group, because the number of groups is
+      // a power of two
+      for (size_t step = 1;; ++step) {
+        const auto group = _control + g * group_size;
+        auto candidates = matchTag(group, tag);
+        while (candidates) {
+          const auto i = lowestBit(candidates);
+          const auto &e = _entries[g * group_size + i];
+          if (e.hash == hash && e.length == n && ::memcmp(e.data, s, n) == 0) {
+            return &e;
+          }
+          candidates &= candidates - 1;
+        }
+        if (matchEmpty(group)) {
+          return nullptr;
+        }
+        g = (g + step) & groupMask;
+      }
+    }
+
+    void insert(const entry &e)
+    {
+      const size_t groupMask = _capacity / group_size - 1;
+      size_t g = static_cast<size_t>(e.hash >> 7) & groupMask;
+
+      for (size_t step = 1;; ++step) {
+        const auto group = _control + g * group_size;
+        const auto empties = matchEmpty(group);
+        if (empties) {
+          const auto slot = g * group_size + lowestBit(empties);
+          _control[slot] = tagOf(e.hash);
+          _entries[slot] = e;
+          ++_size;
+          return;
+        }
+        g = (g + step) & groupMask;
+      }
+    }
+
+    bool grow()
+    {
+      const size_t newCapacity = _capacity == 0 ? group_size : _capacity * 2;
+
+      auto newControl = _allocator.allocate(newCapacity);
+      if (!newControl) {
+        return false;
+      }
+      auto newEntries = _allocator.allocate(newCapacity * sizeof(entry));
+      if (!newEntries) {
+        _allocator.deallocate(newControl);
+        return false;
+      }
+
+      auto oldControlBuffer = _controlBuffer;
+      auto oldEntryBuffer = _entryBuffer;
+      auto oldControl = _control;
+      auto oldEntries = _entries;
+      const auto oldCapacity = _capacity;
+
+      _controlBuffer = newControl;
+      _entryBuffer = newEntries;
+      _control = static_cast<unsigned char *>(newControl.ptr);
+      _entries = static_cast<entry *>(newEntries.ptr);
+      _capacity = newCapacity;
+      _size = 0;
+      ::memset(_control, empty_slot, _capacity);
+
+      for (size_t i = 0; i < oldCapacity; ++i) {
+        if ((oldControl[i] & empty_slot) == 0) {
+          insert(oldEntries[i]);
+        }
+      }
+      _allocator.deallocate(oldControlBuffer);
+      _allocator.deallocate(oldEntryBuffer);
+      return true;
+    }
+
+    char *store(const char *s, size_t n)
+    {
+      if (_current == nullptr || static_cast<size_t>(_end - _current) < n + 1) {
+        const auto length = std::max(SegmentSize, sizeof(segment) + n + 1);
+        auto mem = _allocator.allocate(length);
+        if (!mem) {
+          return nullptr;
+        }
+        auto newSegment = static_cast<segment *>(mem.ptr);
+        newSegment->next = _segments;
+        newSegment->length = mem.length;
+        _segments = newSegment;
+        _current = static_cast<char *>(mem.ptr) + sizeof(segment);
+        _end = static_cast<char *>(mem.ptr) + mem.length;
+      }
+      auto result = _current;
+      if (n > 0) {
+        ::memcpy(result, s, n);
+      }
+      result[n] = '\0';
+      _current += n + 1;
+      return result;
+    }
+
+    void releaseSegments(segment *s)
+    {
+      while (s) {
+        auto next = s->next;
+        block mem(s, s->length);
+        _allocator.deallocate(mem);
+        s = next;
+      }
+    }
+
+  public:
+    using allocator = Allocator;
+    static const size_t segment_size = SegmentSize;
+
+    string_interner()
+      : _segments(nullptr)
+      , _current(nullptr)
+      , _end(nullptr)
+      , _control(nullptr)
+      , _entries(nullptr)
+      , _capacity(0)
+      , _size(0)
+    {
+    }
+
+    /**
+     * Frees all segments. All views returned by this instance become invalid.
+     */
+    ~string_interner()
+    {
+      releaseSegments(_segments);
+      _allocator.deallocate(_controlBuffer);
+      _allocator.deallocate(_entryBuffer);
+    }
+
+    /**
+     * Returns the stored copy of the given string. If the string was not
+     * interned before, it gets copied into the current segment.
+     * \param s Points to the characters of the string
+     * \param n The number of characters
+     * \return A view of the zero terminated copy that stays valid until
+     *         deallocateAll() is called or the interner is destroyed.
+     *         Its data() is nullptr if not enough memory was available.
+     */
+    boost::string_ref intern(const char *s, size_t n)
+    {
+      const auto hash = internal::hashBytes(s, n);
+      if (auto found = lookup(s, n, hash)) {
+        return {found->data, found->length};
+      }
+
+      // keep the load factor below 7/8, so that every probe sequence ends
+      if (_size + 1 > _capacity - _capacity / 8) {
+        if (!grow() && _size + 1 >= _capacity) {
+          return {};
+        }
+      }
+      auto copy = store(s, n);
+      if (!copy) {
+        return {};
+      }
+      insert(entry{copy, n, hash});
+      return {copy, n};
+    }
+
+    boost::string_ref intern(boost::string_ref s)
+    {
+      return intern(s.data(), s.size());
+    }
+
+    /**
+     * Returns the stored copy of the given string, without interning it.
+     * \return A view with a data() of nullptr, if it was not interned before
+     */
+    boost::string_ref find(boost::string_ref s) const
+    {
+      if (auto found = lookup(s.data(), s.size(), internal::hashBytes(s.data(), s.size()))) {
+        return {found->data, found->length};
+      }
+      return {};
+    }
+
+    /**
+     * Returns the number of distinct strings
+     */
+    size_t size() const
+    {
+      return _size;
+    }
+
+    /**
+     * Releases all strings at once. All segments except the most recent one
+     * are returned to the Allocator, the table keeps its capacity.
+     * Beware of using any previously returned view after calling this!
+     */
+    void deallocateAll()
+    {
+      if (_segments) {
+        releaseSegments(_segments->next);
+        _segments->next = nullptr;
+        _current = reinterpret_cast<char *>(_segments) + sizeof(segment);
+        _end = reinterpret_cast<char *>(_segments) + _segments->length;
+      }
+      if (_control) {
+        ::memset(_control, empty_slot, _capacity);
+      }
+      _size = 0;
+    }
+  };
+
+  template <class Allocator, size_t SegmentSize>
+  const size_t string_interner<Allocator, SegmentSize>::segment_size;
+}
@@ -0,0 +1,310 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_base.hpp"
+#include "internal/reallocator.hpp"
+
+#include <boost/assert.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+namespace alb {
+
+  namespace internal {
+    /**
+     * Returns a new identity for a alb::tlab_region, identities are never
+     * reused, so a thread never confuses a new region with a destroyed one.
+     * \ingroup group_internal
+     */
+    inline uint64_t nextTlabRegionId()
+    {
+      static std::atomic<uint64_t> id(0);
+      return ++id;
+    }
+  }
+
+  /**
+   * This allocator serves memory out of a region of RegionSize bytes, that is
+   * shared by all threads, by thread local allocation buffers (TLAB) as the
+   * JVM does: a thread takes a buffer of BufferSize bytes from the region with
+   * a single atomic operation and bump allocates within it without any
+   * atomic operation. When the request does not fit into the rest of the
+   * buffer, the buffer is retired and the thread takes a new one. If the
+   * rest is larger than an eighth of a buffer, the request is served directly
+   * by the region instead, so that not too much is wasted. Requests larger
+   * than a buffer are always served directly by the region.
+   * Like with the alb::stack_allocator, a block can only be given back, if it
+   * is the most recent one of the current buffer of the calling thread.
+   * Otherwise all memory is reclaimed by deallocateAll(), e.g. at the end of
+   * an epoch. It may only be called when no thread allocates, the other
+   * threads notice the new epoch on their next allocation and drop their
+   * buffers.
+   * Each thread keeps the buffers of the four regions of the same type, that
+   * it used most recently. When it switches between more regions, the buffer
+   * of the least recently used one is dropped with its rest.
+   * \tparam Allocator The allocator of the region
+   * \tparam RegionSize The size of the region in bytes
+   * \tparam BufferSize The size of the thread local buffers in bytes
+   * \tparam Alignment Each allocation is aligned by this value
+   *
+   * \ingroup group_allocators group_shared
+   */
+  template <class Allocator, size_t RegionSize, size_t BufferSize = 4096, size_t Alignment = 8>
+  class tlab_region {
+    static_assert(BufferSize <= RegionSize, "A buffer must not exceed the region!");
+    static_assert(BufferSize % Alignment == 0,
+                  "The buffer size must be a multiple of the alignment!");
+
+    struct thread_buffer {
+      uint64_t region;
+      uint64_t epoch;
+      char *p;
+      char *end;
+    };
+
+    static const size_t number_of_cached_regions = 4;
+    static const size_t refill_waste_limit = BufferSize / 8;
+
+    Allocator _allocator;
+    block _buffer;
+    const uint64_t _id;
+    std::atomic<size_t> _top;
+    std::atomic<uint64_t> _epoch;
+    std::atomic<size_t> _numberOfBuffers;
+
+    tlab_region(const tlab_region &) = delete;
+    tlab_region &operator=(const tlab_region &) = delete;
+
+    // The buffers are kept in the order of their last use, so a region, that
+    // is not cached, replaces the least recently used one
+    static thread_buffer &threadBufferOf(uint64_t region)
+    {
+      thread_local thread_buffer buffers[number_of_cached_regions] = {};
+      size_t i = 0;
+      while (i < number_of_cached_regions - 1 && buffers[i].region != region) {
+        ++i;
+      }
+      if (i > 0) {
+        const auto found = buffers[i];
+        std::copy_backward(buffers, buffers + i, buffers + i + 1);
+        buffers[0] = found;
+      }
+      return buffers[0];
+    }
+
+    // Returns the buffer of the calling thread, a buffer of an older epoch or
+    // of another region is dropped
+    thread_buffer &threadBuffer()
+    {
+      auto &result = threadBufferOf(_id);
+      const auto epoch = _epoch.load(std::memory_order_acquire);
+      if (result.region != _id || result.epoch != epoch) {
+        result.region = _id;
+        result.epoch = epoch;
+        result.p = nullptr;
+        result.end = nullptr;
+      }
+      return result;
+    }
+
+    // Takes between minimum and wanted bytes from the region
+    char *take(size_t minimum, size_t wanted, size_t &taken)
+    {
+      auto top = _top.load(std::memory_order_relaxed);
+      do {
+        if (RegionSize - top < minimum) {
+          return nullptr;
+        }
+        taken = std::min(wanted, RegionSize - top);
+      } while (!_top.compare_exchange_weak(top, top + taken, std::memory_order_relaxed));
+      return static_cast<char *>(_buffer.ptr) + top;
+    }
+
+    bool isLastOfThreadBuffer(const block &b)
+    {
+      auto &buffer = threadBuffer();
+      return static_cast<char *>(b.ptr) + b.length == buffer.p;
+    }
+
+  public:
+    static const bool supports_truncated_deallocation = true;
+    static const bool shrinks_in_place = true;
+    static const size_t region_size = RegionSize;
+    static const size_t buffer_size = BufferSize;
+    static const size_t alignment = Alignment;
+
+    using allocator = Allocator;
+
+    tlab_region()
+      : _id(internal::nextTlabRegionId())
+      , _top(0)
+      , _epoch(0)
+      , _numberOfBuffers(0)
+    {
+      _buffer = _allocator.allocate(RegionSize);
+      if (!_buffer) {
+        // nothing can be taken from an empty region
+        _top = RegionSize;
+      }
+    }
+
+    ~tlab_region()
+    {
+      _allocator.deallocate(_buffer);
+    }
+
+    block allocate(size_t n)
+    {
+      if (n == 0) {
+        return {};
+      }
+      const auto length = internal::roundToAlignment(Alignment, n);
+      auto &buffer = threadBuffer();
+      const auto rest = static_cast<size_t>(buffer.end - buffer.p);
+      if (length <= rest) {
+        block result(buffer.p, length);
+        buffer.p += length;
+        return result;
+      }
+
+      size_t taken = 0;
+      if (length > BufferSize || rest > refill_waste_limit) {
+        auto p = take(length, length, taken);
+        return p != nullptr ? block(p, length) : block();
+      }
+
+      auto p = take(length, BufferSize, taken);
+      if (p == nullptr) {
+        return {};
+      }
+      ++_numberOfBuffers;
+      buffer.p = p + length;
+      buffer.end = p + taken;
+      return {p, length};
+    }
+
+    /**
+     * Gives the block back, if it is the most recent one of the buffer of
+     * the calling thread. Otherwise it is reclaimed by deallocateAll().
+     */
+    void deallocate(block &b)
+    {
+      if (!b) {
+        return;
+      }
+      BOOST_ASSERT(owns(b));
+      const auto length = internal::roundToAlignment(Alignment, b.length);
+      if (isLastOfThreadBuffer(block(b.ptr, length))) {
+        threadBuffer().p = static_cast<char *>(b.ptr);
+      }
+      b.reset();
+    }
+
+    bool reallocate(block &b, size_t n)
+    {
+      if (internal::reallocator<tlab_region>::isHandledDefault(*this, b, n)) {
+        return true;
+      }
+      const auto length = internal::roundToAlignment(Alignment, n);
+      if (b.length > n) {
+        // a shrunk last block gives its rest back to the buffer
+        if (isLastOfThreadBuffer(b)) {
+          threadBuffer().p = static_cast<char *>(b.ptr) + length;
+        }
+        b.length = length;
+        return true;
+      }
+      if (expand(b, length - b.length)) {
+        return true;
+      }
+      return internal::reallocateWithCopy(*this, *this, b, length);
+    }
+
+    /**
+     * Expands the given block in place, if it is the most recent one of the
+     * buffer of the calling thread and the buffer has enough space left.
+     * \param b The block that should be expanded
+     * \param delta The number of bytes that should be appended
+     * \return true, if the operation was successful
+     */
+    bool expand(block &b, size_t delta)
+    {
+      if (delta == 0) {
+        return true;
+      }
+      if (!b) {
+        b = allocate(delta);
+        return b.length != 0;
+      }
+      if (!isLastOfThreadBuffer(b)) {
+        return false;
+      }
+      auto &buffer = threadBuffer();
+      const auto length = internal::roundToAlignment(Alignment, delta);
+      if (length > static_cast<size_t>(buffer.end - buffer.p)) {
+        return false;
+      }
+      buffer.p += length;
+      b.length += length;
+      return true;
+    }
+
+    bool owns(const block &b) const
+    {
+      return b && b.ptr >= _buffer.ptr &&
+             b.ptr < static_cast<char *>(_buffer.ptr) + _buffer.length;
+    }
+
+    /**
+     * Reclaims all blocks at once and starts a new epoch. No thread may
+     * allocate during this call and the blocks must not be used any more.
+     */
+    void deallocateAll()
+    {
+      _top.store(_buffer ? 0 : RegionSize, std::memory_order_relaxed);
+      _epoch.fetch_add(1, std::memory_order_release);
+    }
+
+    /**
+     * Returns the number of bytes, that were taken from the region in the
+     * current epoch, either as buffer or directly
+     */
+    size_t used() const
+    {
+      return _buffer ? _top.load(std::memory_order_relaxed) : 0;
+    }
+
+    /**
+     * Returns the number of thread local buffers taken since the construction
+     */
+    size_t buffers() const
+    {
+      return _numberOfBuffers.load(std::memory_order_relaxed);
+    }
+  };
+
+  template <class Allocator, size_t RegionSize, size_t BufferSize, size_t Alignment>
+  const bool
+      tlab_region<Allocator, RegionSize, BufferSize, Alignment>::supports_truncated_deallocation;
+
+  template <class Allocator, size_t RegionSize, size_t BufferSize, size_t Alignment>
+  const bool tlab_region<Allocator, RegionSize, BufferSize, Alignment>::shrinks_in_place;
+
+  template <class Allocator, size_t RegionSize, size_t BufferSize, size_t Alignment>
+  const size_t tlab_region<Allocator, RegionSize, BufferSize, Alignment>::region_size;
+
+  template <class Allocator, size_t RegionSize, size_t BufferSize, size_t Alignment>
+  const size_t tlab_region<Allocator, RegionSize, BufferSize, Alignment>::buffer_size;
+
+  template <class Allocator, size_t RegionSize, size_t BufferSize, size_t Alignment>
+  const size_t tlab_region<Allocator, RegionSize, BufferSize, Alignment>::alignment;
+}
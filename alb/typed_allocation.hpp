@@ -0,0 +1,289 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "allocator_base.hpp"
+#include "aligned_mallocator.hpp"
+#include "freelist.hpp"
+#include "mallocator.hpp"
+#include "internal/traits.hpp"
+
+#include <boost/assert.hpp>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace alb {
+
+  namespace internal {
+    /**
+     * Selects the parent allocator of a pool for objects of type T. Over
+     * aligned types get their alignment from an aligned_mallocator.
+     * \ingroup group_internal
+     */
+    template <typename T>
+    using pool_parent_for =
+        typename std::conditional<(alignof(T) > alignof(std::max_align_t)),
+                                  aligned_mallocator<alignof(T)>, mallocator>::type;
+  }
+
+  /**
+   * A freelist that is dimensioned at compile time for objects of type T. Its
+   * blocks have exactly sizeof(T) bytes, which is always a multiple of
+   * alignof(T), and are taken from an allocator that respects alignof(T).
+   * \tparam T The type of the pooled objects
+   * \tparam PoolSize The maximum number of free blocks that are kept
+   *
+   * \ingroup group_allocators
+   */
+  template <typename T, size_t PoolSize = 1024>
+  using pool_for = freelist<internal::pool_parent_for<T>, 1, sizeof(T), PoolSize>;
+
+  /**
+   * The deleter of the std::unique_ptr, that is returned by alb::make_unique.
+   * It stores the allocator and the length of the allocated block, rounded up
+   * by traits::GoodSizer, so that the block is returned with all the memory it
+   * covers.
+   *
+   * \ingroup group_allocators
+   */
+  template <typename T, class Allocator> class deleter {
+    Allocator *_allocator;
+    size_t _length;
+
+  public:
+    deleter()
+      : _allocator(nullptr)
+      , _length(0)
+    {
+    }
+
+    deleter(Allocator &allocator, size_t length)
+      : _allocator(&allocator)
+      , _length(length)
+    {
+    }
+
+    void operator()(T *p) const
+    {
+      p->~T();
+      block b(const_cast<typename std::remove_cv<T>::type *>(p), _length);
+      _allocator->deallocate(b);
+    }
+  };
+
+  template <typename T, class Allocator>
+  using unique_ptr = std::unique_ptr<T, deleter<T, Allocator>>;
+
+  /**
+   * Allocates the memory for an object of type T by the given allocator and
+   * constructs it with the given arguments.
+   * \param allocator The allocator, it must outlive the returned pointer
+   * \param args The arguments of the constructor of T
+   * \return The pointer, that owns the object, or an empty pointer if the
+   *         allocator could not provide the memory. If the constructor throws,
+   *         the memory is freed and the exception is propagated.
+   *
+   * \ingroup group_allocators
+   */
+  template <typename T, class Allocator, typename... Args>
+  unique_ptr<T, Allocator> make_unique(Allocator &allocator, Args &&... args)
+  {
+    auto b = allocator.allocate(sizeof(T));
+    if (!b) {
+      return {};
+    }
+    T *p = nullptr;
+    try {
+      p = ::new (b.ptr) T(std::forward<Args>(args)...);
+    }
+    catch (...) {
+      allocator.deallocate(b);
+      throw;
+    }
+    const auto length = traits::GoodSizer<Allocator>::doIt(allocator, b);
+    return unique_ptr<T, Allocator>(p, deleter<T, Allocator>(allocator, length));
+  }
+
+  /**
+   * This class adapts an alb allocator to the standard allocator interface
+   * by reference. In opposite to the alb::stl_allocator, it does not need a
+   * length prefix, because the standard containers and std::allocate_shared
+   * pass the number of elements on deallocation. The requested length is
+   * rounded up by traits::GoodSizer, so the Allocator must either implement
+   * ::goodSize(), like alb::heap and the compositions over it do, or accept
+   * the requested length on deallocation, e.g. a freelist or a mallocator.
+   *
+   * \ingroup group_allocators
+   */
+  template <typename T, class Allocator> class ref_allocator {
+    template <typename U, class A> friend class ref_allocator;
+
+    Allocator *_allocator;
+
+  public:
+    using value_type = T;
+
+    template <typename U> struct rebind {
+      typedef ref_allocator<U, Allocator> other;
+    };
+
+    explicit ref_allocator(Allocator &allocator)
+      : _allocator(std::addressof(allocator))
+    {
+    }
+
+    template <typename U>
+    ref_allocator(const ref_allocator<U, Allocator> &x)
+      : _allocator(x._allocator)
+    {
+    }
+
+    T *allocate(std::size_t n)
+    {
+      auto b = _allocator->allocate(n * sizeof(T));
+      if (!b) {
+        throw std::bad_alloc();
+      }
+      return static_cast<T *>(b.ptr);
+    }
+
+    void deallocate(T *p, std::size_t n)
+    {
+      block b(p, n * sizeof(T));
+      b.length = traits::GoodSizer<Allocator>::doIt(*_allocator, b);
+      _allocator->deallocate(b);
+    }
+
+    Allocator &allocator() const
+    {
+      return *_allocator;
+    }
+  };
+
+  template <typename T1, typename T2, class Allocator>
+  bool operator==(const ref_allocator<T1, Allocator> &a, const ref_allocator<T2, Allocator> &b)
+  {
+    return &a.allocator() == &b.allocator();
+  }
+
+  template <typename T1, typename T2, class Allocator>
+  bool operator!=(const ref_allocator<T1, Allocator> &a, const ref_allocator<T2, Allocator> &b)
+  {
+    return !(a == b);
+  }
+
+  /**
+   * Creates a std::shared_ptr whose control block and object are allocated
+   * together in a single block of the given allocator, without any prefix.
+   * \param allocator The allocator, it must outlive all copies of the pointer
+   * \param args The arguments of the constructor of T
+   * \return The shared pointer, std::bad_alloc is thrown if the allocator
+   *         could not provide the memory
+   *
+   * \ingroup group_allocators
+   */
+  template <typename T, class Allocator, typename... Args>
+  std::shared_ptr<T> allocate_shared(Allocator &allocator, Args &&... args)
+  {
+    return std::allocate_shared<T>(ref_allocator<T, Allocator>(allocator),
+                                   std::forward<Args>(args)...);
+  }
+
+  /**
+   * The default relocation of alb::reallocate_array: each object is move
+   * constructed at the new location, or copy constructed if its move
+   * constructor may throw, and then destroyed at the old location. If a
+   * copy constructor throws, the already created copies are destroyed and
+   * the old objects stay untouched.
+   *
+   * \ingroup group_allocators
+   */
+  struct relocate_objects {
+    template <typename T> void operator()(T *from, T *to, size_t count) const
+    {
+      size_t i = 0;
+      try {
+        for (; i < count; ++i) {
+          ::new (static_cast<void *>(to + i)) T(std::move_if_noexcept(from[i]));
+        }
+      }
+      catch (...) {
+        while (i > 0) {
+          to[--i].~T();
+        }
+        throw;
+      }
+      for (i = 0; i < count; ++i) {
+        from[i].~T();
+      }
+    }
+  };
+
+  /**
+   * Reallocates a block of objects of type T to the capacity of n objects.
+   * In opposite to ::reallocate() of the allocators, the objects are never
+   * moved by ::memcpy(), so it can be used for types that are not trivially
+   * relocatable.
+   * A growth is tried in place by ::expand() first, if the Allocator
+   * implements it. A shrink is done by ::reallocate() of the Allocator, if it
+   * keeps the block in place, see traits::shrinks_in_place. Only if the block
+   * must move, a new block is allocated, the live objects are passed to
+   * relocate and the old block is freed.
+   * Trivially copyable types are passed to ::reallocate() of the Allocator.
+   * \param allocator The allocator, that allocated the block
+   * \param b The block, it is updated on success
+   * \param count The number of live objects at the start of the block
+   * \param n The new capacity in objects, it must not be smaller than count
+   * \param relocate Is called as relocate(T *from, T *to, size_t count) and
+   *        must move construct the objects at to and destroy them at from
+   * \return True, if the operation was successful. Otherwise the block and
+   *         its objects are unchanged.
+   *
+   * \ingroup group_allocators
+   */
+  template <typename T, class Allocator, class Relocate>
+  bool reallocate_array(Allocator &allocator, block &b, size_t count, size_t n, Relocate relocate)
+  {
+    BOOST_ASSERT(count <= n && count * sizeof(T) <= b.length);
+    const auto length = n * sizeof(T);
+    if (!b || n == 0 || b.length == length || std::is_trivially_copyable<T>::value) {
+      return allocator.reallocate(b, length);
+    }
+    if (length > b.length && traits::Expander<Allocator>::doIt(allocator, b, length - b.length)) {
+      return true;
+    }
+    if (length < b.length && traits::shrinks_in_place<Allocator>::value) {
+      return allocator.reallocate(b, length);
+    }
+    auto newBlock = allocator.allocate(length);
+    if (!newBlock) {
+      return false;
+    }
+    try {
+      relocate(static_cast<T *>(b.ptr), static_cast<T *>(newBlock.ptr), count);
+    }
+    catch (...) {
+      allocator.deallocate(newBlock);
+      throw;
+    }
+    allocator.deallocate(b);
+    b = newBlock;
+    return true;
+  }
+
+  template <typename T, class Allocator>
+  bool reallocate_array(Allocator &allocator, block &b, size_t count, size_t n)
+  {
+    return reallocate_array<T>(allocator, b, count, n, relocate_objects());
+  }
+}
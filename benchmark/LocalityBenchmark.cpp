@@ -0,0 +1,382 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+
+// Measures how well the allocators place the nodes of linked structures. A
+// list, a binary search tree and hash chains are built through each
+// allocator, once in a fresh allocator and once after churn: before the
+// build many blocks are allocated and freed in random order and during the
+// build blocks of another structure are interleaved and freed afterwards.
+// Then the structures are traversed. Besides the time and the hardware
+// counters per key, the hops between successive nodes are reported: the
+// share of hops within 64 bytes and the median distance of a hop.
+//
+//   LocalityBenchmark [number of nodes [repetitions]]
+
+#include "Measure.h"
+
+#include <alb/fallback_allocator.hpp>
+#include <alb/freelist.hpp>
+#include <alb/heap.hpp>
+#include <alb/mallocator.hpp>
+#include <alb/stack_allocator.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+  const size_t node_size = 32;
+  const size_t max_nodes = 1 << 18;
+
+  using Stack = alb::stack_allocator<4 * max_nodes * node_size, 8>;
+  using Heap = alb::heap<alb::mallocator, 4 * max_nodes, node_size>;
+  using FreeList = alb::freelist<alb::mallocator, node_size, node_size, 2 * max_nodes, 64>;
+  using HeapWithFallback = alb::fallback_allocator<alb::heap<alb::mallocator, 1024, node_size>,
+                                                   alb::mallocator>;
+
+  struct ListNode {
+    ListNode *next;
+    uint64_t key;
+    uint64_t payload[2];
+  };
+
+  struct TreeNode {
+    TreeNode *left;
+    TreeNode *right;
+    uint64_t key;
+    uint64_t payload;
+  };
+
+  static_assert(sizeof(ListNode) == node_size, "All nodes must have the same size");
+  static_assert(sizeof(TreeNode) == node_size, "All nodes must have the same size");
+
+  /**
+   * Records the distances between successive nodes of a traversal
+   */
+  class hops {
+    std::vector<size_t> _distances;
+    const void *_last = nullptr;
+
+  public:
+    void operator()(const void *p)
+    {
+      if (_last != nullptr) {
+        const auto a = reinterpret_cast<uintptr_t>(_last);
+        const auto b = reinterpret_cast<uintptr_t>(p);
+        _distances.push_back(a < b ? b - a : a - b);
+      }
+      _last = p;
+    }
+
+    void restart()
+    {
+      _last = nullptr;
+    }
+
+    double nearShare() const
+    {
+      const auto near = std::count_if(_distances.begin(), _distances.end(),
+                                      [](size_t d) { return d <= 64; });
+      return _distances.empty() ? 0.0 : 100.0 * near / _distances.size();
+    }
+
+    size_t median()
+    {
+      if (_distances.empty()) {
+        return 0;
+      }
+      std::nth_element(_distances.begin(), _distances.begin() + _distances.size() / 2,
+                       _distances.end());
+      return _distances[_distances.size() / 2];
+    }
+  };
+
+  struct ignore_hops {
+    void operator()(const void *)
+    {
+    }
+    void restart()
+    {
+    }
+  };
+
+  /**
+   * Places the allocator on the heap, because some of them are too big for
+   * the stack. The global placement new bypasses the deleted operator new of
+   * the stack_allocator, which serves then as region.
+   */
+  template <class Allocator> class instance {
+    std::unique_ptr<char[]> _memory;
+
+  public:
+    instance()
+      : _memory(new char[sizeof(Allocator)])
+    {
+      ::new (_memory.get()) Allocator();
+    }
+
+    ~instance()
+    {
+      get().~Allocator();
+    }
+
+    Allocator &get()
+    {
+      return *reinterpret_cast<Allocator *>(_memory.get());
+    }
+  };
+
+  /**
+   * Allocates nodes and optionally interleaves blocks, that are freed after
+   * the build, to simulate other allocations of the program.
+   */
+  template <class Allocator> class node_source {
+    Allocator &_allocator;
+    std::vector<alb::block> _nodes;
+    std::vector<alb::block> _interleaved;
+    std::minstd_rand _random;
+    bool _interleave;
+
+  public:
+    node_source(Allocator &allocator, bool interleave)
+      : _allocator(allocator)
+      , _interleave(interleave)
+    {
+    }
+
+    template <typename T> T *create()
+    {
+      auto b = _allocator.allocate(node_size);
+      if (!b) {
+        std::printf("the allocator is exhausted\n");
+        std::exit(1);
+      }
+      _nodes.push_back(b);
+      if (_interleave && _random() % 2 == 0) {
+        _interleaved.push_back(_allocator.allocate(node_size));
+      }
+      return ::new (b.ptr) T();
+    }
+
+    void finishBuild()
+    {
+      for (auto &b : _interleaved) {
+        _allocator.deallocate(b);
+      }
+      _interleaved.clear();
+    }
+
+    ~node_source()
+    {
+      finishBuild();
+      for (auto &b : _nodes) {
+        _allocator.deallocate(b);
+      }
+    }
+  };
+
+  template <class Allocator> void churn(Allocator &allocator, size_t n)
+  {
+    std::vector<alb::block> blocks;
+    for (size_t i = 0; i < 2 * n; ++i) {
+      blocks.push_back(allocator.allocate(node_size));
+    }
+    std::shuffle(blocks.begin(), blocks.end(), std::minstd_rand());
+    for (auto &b : blocks) {
+      allocator.deallocate(b);
+    }
+  }
+
+  struct list {
+    static const char *name()
+    {
+      return "list";
+    }
+
+    ListNode *head = nullptr;
+
+    template <class Source> void build(Source &source, const std::vector<uint64_t> &keys)
+    {
+      ListNode **tail = &head;
+      for (auto key : keys) {
+        auto node = source.template create<ListNode>();
+        node->key = key;
+        *tail = node;
+        tail = &node->next;
+      }
+    }
+
+    template <class Hops> uint64_t traverse(const std::vector<uint64_t> &, Hops &hop) const
+    {
+      uint64_t sum = 0;
+      for (auto p = head; p != nullptr; p = p->next) {
+        hop(p);
+        sum += p->key;
+      }
+      return sum;
+    }
+  };
+
+  struct tree {
+    static const char *name()
+    {
+      return "tree";
+    }
+
+    TreeNode *root = nullptr;
+
+    template <class Source> void build(Source &source, const std::vector<uint64_t> &keys)
+    {
+      for (auto key : keys) {
+        auto node = source.template create<TreeNode>();
+        node->key = key;
+        auto p = &root;
+        while (*p != nullptr) {
+          p = key < (*p)->key ? &(*p)->left : &(*p)->right;
+        }
+        *p = node;
+      }
+    }
+
+    // looks up every key from the root
+    template <class Hops> uint64_t traverse(const std::vector<uint64_t> &keys, Hops &hop) const
+    {
+      uint64_t sum = 0;
+      for (auto key : keys) {
+        hop.restart();
+        auto p = root;
+        while (p != nullptr && p->key != key) {
+          hop(p);
+          p = key < p->key ? p->left : p->right;
+        }
+        sum += p->payload;
+      }
+      return sum;
+    }
+  };
+
+  struct hash_chains {
+    static const char *name()
+    {
+      return "hash chains";
+    }
+
+    std::vector<ListNode *> buckets;
+
+    size_t bucketOf(uint64_t key) const
+    {
+      return (key * 0x9E3779B97F4A7C15uLL >> 32) % buckets.size();
+    }
+
+    template <class Source> void build(Source &source, const std::vector<uint64_t> &keys)
+    {
+      // eight nodes per chain on average
+      buckets.assign(std::max(size_t(1), keys.size() / 8), nullptr);
+      for (auto key : keys) {
+        auto node = source.template create<ListNode>();
+        node->key = key;
+        auto &head = buckets[bucketOf(key)];
+        node->next = head;
+        head = node;
+      }
+    }
+
+    template <class Hops> uint64_t traverse(const std::vector<uint64_t> &keys, Hops &hop) const
+    {
+      uint64_t sum = 0;
+      for (auto key : keys) {
+        hop.restart();
+        auto p = buckets[bucketOf(key)];
+        while (p->key != key) {
+          hop(p);
+          p = p->next;
+        }
+        sum += p->payload[0];
+      }
+      return sum;
+    }
+  };
+
+  template <class Structure, class Allocator>
+  void run(const char *allocatorName, bool churned, const std::vector<uint64_t> &keys,
+           const std::vector<uint64_t> &lookups, int repetitions)
+  {
+    instance<Allocator> allocator;
+    if (churned) {
+      churn(allocator.get(), keys.size());
+    }
+    node_source<Allocator> source(allocator.get(), churned);
+    Structure structure;
+    structure.build(source, keys);
+    source.finishBuild();
+
+    hops hop;
+    structure.traverse(lookups, hop);
+
+    ignore_hops noHop;
+    uint64_t sum = 0;
+    const auto m = alb::benchmark::measure([&] {
+      for (int i = 0; i < repetitions; ++i) {
+        sum += structure.traverse(lookups, noHop);
+      }
+    });
+    alb::benchmark::doNotOptimize(sum);
+
+    const double operations = static_cast<double>(repetitions) * keys.size();
+    std::printf("%-12s %-20s %-8s %10.2f %12.1f %14zu", Structure::name(), allocatorName,
+                churned ? "churned" : "fresh", m.nanoseconds / operations, hop.nearShare(),
+                hop.median());
+    alb::benchmark::printCounters(m, operations);
+    std::printf("\n");
+  }
+
+  template <class Structure>
+  void runAll(const std::vector<uint64_t> &keys, const std::vector<uint64_t> &lookups,
+              int repetitions)
+  {
+    for (auto churned : {false, true}) {
+      run<Structure, alb::mallocator>("mallocator", churned, keys, lookups, repetitions);
+      run<Structure, Stack>("stack_allocator", churned, keys, lookups, repetitions);
+      run<Structure, Heap>("heap", churned, keys, lookups, repetitions);
+      run<Structure, FreeList>("freelist", churned, keys, lookups, repetitions);
+      run<Structure, HeapWithFallback>("heap + mallocator", churned, keys, lookups,
+                                       repetitions);
+    }
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  const size_t n = argc > 1 ? std::min(max_nodes, size_t(std::atol(argv[1]))) : 1 << 16;
+  const int repetitions = argc > 2 ? std::atoi(argv[2]) : 20;
+
+  std::vector<uint64_t> keys(n);
+  for (size_t i = 0; i < n; ++i) {
+    keys[i] = i;
+  }
+  // the tree is balanced on average by random insertion
+  std::shuffle(keys.begin(), keys.end(), std::minstd_rand(42));
+  auto lookups = keys;
+  std::shuffle(lookups.begin(), lookups.end(), std::minstd_rand(7));
+
+  std::printf("%zu nodes of %zu bytes, %d repetitions\n", n, node_size, repetitions);
+  std::printf("%-12s %-20s %-8s %10s %12s %14s", "structure", "allocator", "state", "ns/key",
+              "near hops %", "median hop [B]");
+  alb::benchmark::printCounterHeader();
+  std::printf("\n");
+  runAll<list>(keys, lookups, repetitions);
+  runAll<tree>(keys, lookups, repetitions);
+  runAll<hash_chains>(keys, lookups, repetitions);
+  return 0;
+}
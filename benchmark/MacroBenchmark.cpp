@@ -0,0 +1,458 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+
+// Runs application like kernels with the standard containers and compares
+// std::allocator with several compositions, each once through the
+// alb::stl_allocator and once through a std::pmr::memory_resource:
+//   - dom:       builds documents of a JSON like generator as tree of nodes
+//   - map:       insert heavy and erase heavy phases of std::map
+//   - hash map:  the same with std::unordered_map and string keys
+//   - tokens:    splits a text into a vector<string>, filters, counts and
+//                sorts the tokens
+//   - graph:     builds adjacency lists of a random graph and traverses it
+// Each kernel is repeated and the fastest run is reported with its hardware
+// counters in millions. The alb::stl_allocator adds an alb::length_prefix of
+// sizeof(std::max_align_t) bytes, 16 on x86-64, to each block, the memory
+// resource gets the length on deallocation.
+//
+//   MacroBenchmark [scale [repetitions]]
+
+#include "Measure.h"
+
+#include <alb/affix_allocator.hpp>
+#include <alb/bucketizer.hpp>
+#include <alb/fallback_allocator.hpp>
+#include <alb/freelist.hpp>
+#include <alb/global_allocator.hpp>
+#include <alb/heap.hpp>
+#include <alb/mallocator.hpp>
+#include <alb/segregator.hpp>
+#include <alb/stl_allocator.hpp>
+
+#include <boost/assert.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <memory_resource>
+#include <new>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+  using FreeListBuckets =
+      alb::segregator<256,
+                      alb::bucketizer<alb::freelist<alb::mallocator, alb::internal::DynasticDynamicSet,
+                                                    alb::internal::DynasticDynamicSet>,
+                                      1, 256, 16>,
+                      alb::mallocator>;
+  using HeapWithFallback =
+      alb::fallback_allocator<alb::heap<alb::mallocator, 1 << 12, 32>, alb::mallocator>;
+
+  /**
+   * Adapts a composition to the polymorphic memory resource. All used
+   * compositions align their blocks at least as malloc() does.
+   */
+  template <class Allocator> class alb_resource : public std::pmr::memory_resource {
+    Allocator _allocator;
+
+    void *do_allocate(size_t bytes, size_t alignment) override
+    {
+      BOOST_ASSERT(alignment <= alignof(std::max_align_t));
+      (void)alignment;
+      auto b = _allocator.allocate(bytes);
+      if (!b) {
+        throw std::bad_alloc();
+      }
+      return b.ptr;
+    }
+
+    void do_deallocate(void *p, size_t bytes, size_t) override
+    {
+      alb::block b(p, bytes);
+      _allocator.deallocate(b);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &x) const noexcept override
+    {
+      return this == &x;
+    }
+
+  public:
+    static alb_resource &instance()
+    {
+      static alb_resource resource;
+      return resource;
+    }
+  };
+
+  struct std_policy {
+    template <typename T> using allocator = std::allocator<T>;
+
+    static void start()
+    {
+    }
+    static void stop()
+    {
+    }
+  };
+
+  template <class Composition> struct stl_policy {
+    using global = alb::global_allocator<alb::affix_allocator<Composition, alb::length_prefix>>;
+
+    template <typename T> using allocator = alb::stl_allocator<T, global>;
+
+    static void start()
+    {
+    }
+    static void stop()
+    {
+    }
+  };
+
+  // All pmr containers take the default resource on construction
+  template <class Composition> struct pmr_policy {
+    template <typename T> using allocator = std::pmr::polymorphic_allocator<T>;
+
+    static void start()
+    {
+      std::pmr::set_default_resource(&alb_resource<Composition>::instance());
+    }
+    static void stop()
+    {
+      std::pmr::set_default_resource(nullptr);
+    }
+  };
+
+  struct string_hash {
+    template <class String> size_t operator()(const String &s) const
+    {
+      return std::hash<std::string_view>()(std::string_view(s.data(), s.size()));
+    }
+  };
+
+  template <class Policy> struct types {
+    template <typename T> using allocator = typename Policy::template allocator<T>;
+    using string = std::basic_string<char, std::char_traits<char>, allocator<char>>;
+    template <typename T> using vector = std::vector<T, allocator<T>>;
+    template <typename K, typename V>
+    using map = std::map<K, V, std::less<K>, allocator<std::pair<const K, V>>>;
+    template <typename K, typename V>
+    using unordered_map =
+        std::unordered_map<K, V, string_hash, std::equal_to<K>, allocator<std::pair<const K, V>>>;
+  };
+
+  struct input {
+    size_t scale;
+    std::vector<std::string> words;
+    std::vector<uint64_t> keys;
+    std::string text;
+  };
+
+  template <class String> String randomString(std::minstd_rand &random, size_t minLength,
+                                              size_t maxLength)
+  {
+    const auto length = minLength + random() % (maxLength - minLength + 1);
+    String result;
+    for (size_t i = 0; i < length; ++i) {
+      result.push_back(static_cast<char>('a' + random() % 26));
+    }
+    return result;
+  }
+
+  template <class Types> struct dom_node {
+    enum kind_t { number, text, array, object } kind;
+    double value;
+    typename Types::string content;
+    typename Types::template vector<dom_node> children;
+    typename Types::template vector<typename Types::string> keys;
+  };
+
+  template <class Types>
+  void generate(dom_node<Types> &node, int depth, std::minstd_rand &random, const input &in)
+  {
+    const auto r = random() % 10;
+    if (depth == 0 || (depth < 4 && r < 3)) {
+      node.kind = dom_node<Types>::object;
+      const auto members = 2 + random() % 7;
+      for (size_t i = 0; i < members; ++i) {
+        const auto &word = in.words[random() % in.words.size()];
+        node.keys.emplace_back(word.data(), word.size());
+        node.children.emplace_back();
+        generate(node.children.back(), depth + 1, random, in);
+      }
+    }
+    else if (depth < 4 && r < 5) {
+      node.kind = dom_node<Types>::array;
+      const auto elements = 1 + random() % 6;
+      for (size_t i = 0; i < elements; ++i) {
+        node.children.emplace_back();
+        generate(node.children.back(), depth + 1, random, in);
+      }
+    }
+    else if (r < 8) {
+      node.kind = dom_node<Types>::text;
+      node.content = randomString<typename Types::string>(random, 5, 60);
+    }
+    else {
+      node.kind = dom_node<Types>::number;
+      node.value = random() % 1000;
+    }
+  }
+
+  template <class Types> uint64_t checksum(const dom_node<Types> &node)
+  {
+    uint64_t result = node.content.size() + node.keys.size();
+    if (node.kind == dom_node<Types>::number) {
+      result += static_cast<uint64_t>(node.value);
+    }
+    for (const auto &child : node.children) {
+      result += checksum(child);
+    }
+    return result;
+  }
+
+  template <class Types> uint64_t domKernel(const input &in)
+  {
+    std::minstd_rand random(1);
+    typename Types::template vector<dom_node<Types>> documents;
+    for (size_t i = 0; i < 2000 * in.scale; ++i) {
+      documents.emplace_back();
+      generate(documents.back(), 0, random, in);
+    }
+    uint64_t result = 0;
+    for (const auto &d : documents) {
+      result += checksum(d);
+    }
+    return result;
+  }
+
+  template <class Types> uint64_t mapKernel(const input &in)
+  {
+    typename Types::template map<uint64_t, typename Types::string> map;
+    const typename Types::string value("a value beyond the small string buffer");
+    for (auto key : in.keys) {
+      map.emplace(key, value);
+    }
+    uint64_t result = map.size();
+    // erase heavy: each fourth erased key is replaced by a new one
+    for (size_t i = 0; i < in.keys.size(); ++i) {
+      map.erase(in.keys[i]);
+      if (i % 4 == 0) {
+        map.emplace(in.keys[i] + 1, value);
+      }
+    }
+    return result + map.size();
+  }
+
+  template <class Types> uint64_t hashMapKernel(const input &in)
+  {
+    typename Types::template unordered_map<typename Types::string, uint64_t> map;
+    std::minstd_rand random(2);
+    typename Types::template vector<typename Types::string> keys;
+    for (size_t i = 0; i < in.keys.size(); ++i) {
+      keys.push_back(randomString<typename Types::string>(random, 8, 32));
+      map.emplace(keys.back(), i);
+    }
+    uint64_t result = map.size();
+    for (size_t i = 0; i < keys.size(); ++i) {
+      map.erase(keys[i]);
+      if (i % 4 == 0) {
+        keys[i].push_back('x');
+        map.emplace(keys[i], i);
+      }
+    }
+    return result + map.size();
+  }
+
+  template <class Types> uint64_t tokenKernel(const input &in)
+  {
+    using string = typename Types::string;
+    typename Types::template vector<string> tokens;
+    size_t start = 0;
+    while (start < in.text.size()) {
+      auto end = in.text.find(' ', start);
+      if (end == std::string::npos) {
+        end = in.text.size();
+      }
+      tokens.emplace_back(in.text.data() + start, end - start);
+      start = end + 1;
+    }
+
+    typename Types::template vector<string> filtered;
+    for (const auto &t : tokens) {
+      if (t.size() > 3) {
+        string lower(t);
+        std::transform(lower.begin(), lower.end(), lower.begin(),
+                       [](char c) { return static_cast<char>(std::tolower(c)); });
+        filtered.push_back(std::move(lower));
+      }
+    }
+
+    typename Types::template unordered_map<string, uint64_t> counts;
+    for (const auto &t : filtered) {
+      ++counts[t];
+    }
+    std::sort(filtered.begin(), filtered.end());
+    filtered.erase(std::unique(filtered.begin(), filtered.end()), filtered.end());
+    return tokens.size() + filtered.size() + counts.size();
+  }
+
+  template <class Types> uint64_t graphKernel(const input &in)
+  {
+    const size_t n = 100000 * in.scale;
+    std::minstd_rand random(3);
+    typename Types::template vector<typename Types::template vector<uint32_t>> adjacency(n);
+    for (size_t i = 0; i < 8 * n; ++i) {
+      const auto a = random() % n;
+      const auto b = random() % n;
+      adjacency[a].push_back(static_cast<uint32_t>(b));
+      adjacency[b].push_back(static_cast<uint32_t>(a));
+    }
+
+    typename Types::template vector<char> visited(n, 0);
+    typename Types::template vector<uint32_t> frontier;
+    uint64_t result = 0;
+    frontier.push_back(0);
+    visited[0] = 1;
+    while (!frontier.empty()) {
+      typename Types::template vector<uint32_t> next;
+      for (auto v : frontier) {
+        ++result;
+        for (auto w : adjacency[v]) {
+          if (!visited[w]) {
+            visited[w] = 1;
+            next.push_back(w);
+          }
+        }
+      }
+      frontier.swap(next);
+    }
+    return result;
+  }
+
+  struct kernel {
+    const char *name;
+    uint64_t (*run[7])(const input &);
+  };
+
+  const char *allocatorNames[] = {"std::allocator",           "stl mallocator",
+                                  "stl freelist buckets",     "stl heap + mallocator",
+                                  "pmr mallocator",           "pmr freelist buckets",
+                                  "pmr heap + mallocator"};
+
+  template <class Policy, template <class> class Kernel> uint64_t runWith(const input &in)
+  {
+    Policy::start();
+    const auto result = Kernel<types<Policy>>::run(in);
+    Policy::stop();
+    return result;
+  }
+
+  template <template <class> class Kernel> kernel makeKernel(const char *name)
+  {
+    return {name,
+            {&runWith<std_policy, Kernel>, &runWith<stl_policy<alb::mallocator>, Kernel>,
+             &runWith<stl_policy<FreeListBuckets>, Kernel>,
+             &runWith<stl_policy<HeapWithFallback>, Kernel>,
+             &runWith<pmr_policy<alb::mallocator>, Kernel>,
+             &runWith<pmr_policy<FreeListBuckets>, Kernel>,
+             &runWith<pmr_policy<HeapWithFallback>, Kernel>}};
+  }
+
+#define ALB_MACRO_KERNEL(name, function)                                                          \
+  template <class Types> struct name {                                                           \
+    static uint64_t run(const input &in)                                                         \
+    {                                                                                            \
+      return function<Types>(in);                                                                \
+    }                                                                                            \
+  };
+
+  ALB_MACRO_KERNEL(dom, domKernel)
+  ALB_MACRO_KERNEL(map, mapKernel)
+  ALB_MACRO_KERNEL(hash_map, hashMapKernel)
+  ALB_MACRO_KERNEL(tokens, tokenKernel)
+  ALB_MACRO_KERNEL(graph, graphKernel)
+
+#undef ALB_MACRO_KERNEL
+
+  input makeInput(size_t scale)
+  {
+    input result;
+    result.scale = scale;
+    std::minstd_rand random(42);
+    for (int i = 0; i < 64; ++i) {
+      result.words.push_back(randomString<std::string>(random, 4, 24));
+    }
+    for (size_t i = 0; i < 200000 * scale; ++i) {
+      result.keys.push_back((uint64_t(random()) << 32) | random());
+    }
+    for (size_t i = 0; i < 1000000 * scale; ++i) {
+      if (i > 0) {
+        result.text.push_back(' ');
+      }
+      const auto &word = result.words[random() % result.words.size()];
+      result.text += random() % 8 == 0 ? randomString<std::string>(random, 2, 20) : word;
+    }
+    return result;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  const size_t scale = argc > 1 ? std::max(1l, std::atol(argv[1])) : 1;
+  const int repetitions = argc > 2 ? std::max(1, std::atoi(argv[2])) : 3;
+  const auto in = makeInput(scale);
+
+  const kernel kernels[] = {makeKernel<dom>("dom"), makeKernel<map>("map"),
+                            makeKernel<hash_map>("hash map"), makeKernel<tokens>("tokens"),
+                            makeKernel<graph>("graph")};
+
+  std::printf("scale %zu, best of %d runs, counters in millions per run\n", scale, repetitions);
+  std::printf("%-10s %-24s %10s %8s", "kernel", "allocator", "ms", "speedup");
+  alb::benchmark::printCounterHeader();
+  std::printf("\n");
+
+  for (const auto &k : kernels) {
+    double baseline = 0;
+    uint64_t expected = 0;
+    for (int a = 0; a < 7; ++a) {
+      alb::benchmark::measurement best;
+      best.nanoseconds = 0;
+      uint64_t result = 0;
+      for (int r = 0; r < repetitions; ++r) {
+        const auto m = alb::benchmark::measure([&] { result = k.run[a](in); });
+        if (r == 0 || m.nanoseconds < best.nanoseconds) {
+          best = m;
+        }
+      }
+      if (a == 0) {
+        baseline = best.nanoseconds;
+        expected = result;
+      }
+      else if (result != expected) {
+        std::printf("%s with %s computed a wrong result\n", k.name, allocatorNames[a]);
+        return EXIT_FAILURE;
+      }
+      std::printf("%-10s %-24s %10.2f %8.2f", k.name, allocatorNames[a], best.nanoseconds / 1e6,
+                  baseline / best.nanoseconds);
+      alb::benchmark::printCounters(best, 1e6);
+      std::printf("\n");
+      std::fflush(stdout);
+    }
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,252 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+namespace alb {
+  namespace benchmark {
+
+    /**
+     * The hardware counters, that are read during a measurement
+     */
+    enum counter {
+      cycles,
+      instructions,
+      l1d_misses,
+      llc_misses,
+      dtlb_misses,
+      branch_misses,
+      number_of_counters
+    };
+
+    inline const char *counterName(int c)
+    {
+      static const char *names[number_of_counters] = {"cycles",   "instr",     "L1D miss",
+                                                      "LLC miss", "dTLB miss", "br miss"};
+      return names[c];
+    }
+
+    /**
+     * The result of a measured section
+     */
+    struct measurement {
+      double nanoseconds;
+      // the value of each counter or -1, if it is not available
+      int64_t counters[number_of_counters];
+    };
+
+    /**
+     * Reads the hardware counters of the calling thread by perf_event_open().
+     * All counters are opened as one group, so they are always scheduled
+     * together on the PMU and their ratios are consistent. If the group is
+     * multiplexed with other events, the values are scaled by the time the
+     * group was enabled to the time it was running. Counters that are not
+     * available, e.g. in a virtual machine or with perf_event_paranoid > 2,
+     * or that do not fit into the group, are skipped and the others are still
+     * read. On other systems none is available.
+     */
+    class hardware_counters {
+      int _fds[number_of_counters];
+      // the position of each counter within the values of the group
+      int _slots[number_of_counters];
+      int _leader;
+      int _members;
+
+#ifdef __linux__
+      static int open(uint32_t type, uint64_t config, int groupFd)
+      {
+        perf_event_attr attr;
+        ::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        // the members follow the leader, when it is enabled or disabled
+        attr.disabled = groupFd < 0 ? 1 : 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                           PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return static_cast<int>(::syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0));
+      }
+
+      void add(int c, uint32_t type, uint64_t config)
+      {
+        _fds[c] = open(type, config, _leader);
+        if (_fds[c] >= 0) {
+          if (_leader < 0) {
+            _leader = _fds[c];
+          }
+          _slots[c] = _members++;
+        }
+      }
+
+      static uint64_t cacheMiss(uint64_t cache)
+      {
+        return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      }
+#endif
+
+      hardware_counters(const hardware_counters &) = delete;
+      hardware_counters &operator=(const hardware_counters &) = delete;
+
+    public:
+      hardware_counters()
+        : _leader(-1)
+        , _members(0)
+      {
+        for (int c = 0; c < number_of_counters; ++c) {
+          _fds[c] = -1;
+          _slots[c] = -1;
+        }
+#ifdef __linux__
+        add(cycles, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        add(instructions, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        add(l1d_misses, PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_L1D));
+        add(llc_misses, PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_LL));
+        add(dtlb_misses, PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_DTLB));
+        add(branch_misses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+#endif
+      }
+
+      ~hardware_counters()
+      {
+#ifdef __linux__
+        // the members are closed before the leader
+        for (int c = number_of_counters - 1; c >= 0; --c) {
+          if (_fds[c] >= 0 && _fds[c] != _leader) {
+            ::close(_fds[c]);
+          }
+        }
+        if (_leader >= 0) {
+          ::close(_leader);
+        }
+#endif
+      }
+
+      bool available(int c) const
+      {
+        return _fds[c] >= 0;
+      }
+
+      void start()
+      {
+#ifdef __linux__
+        if (_leader >= 0) {
+          ::ioctl(_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+          ::ioctl(_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+#endif
+      }
+
+      void stop(int64_t (&values)[number_of_counters])
+      {
+        for (auto &v : values) {
+          v = -1;
+        }
+#ifdef __linux__
+        if (_leader < 0) {
+          return;
+        }
+        ::ioctl(_leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+        // number of members, time enabled, time running and the values
+        uint64_t group[3 + number_of_counters];
+        const auto expected = static_cast<ssize_t>((3 + _members) * sizeof(uint64_t));
+        if (::read(_leader, group, sizeof(group)) != expected ||
+            group[0] != static_cast<uint64_t>(_members) || group[2] == 0) {
+          // the group was never scheduled, so no value is meaningful
+          return;
+        }
+        const double scale = static_cast<double>(group[1]) / group[2];
+        for (int c = 0; c < number_of_counters; ++c) {
+          if (_fds[c] >= 0) {
+            values[c] = static_cast<int64_t>(group[3 + _slots[c]] * scale + 0.5);
+          }
+        }
+#endif
+      }
+
+      /**
+       * Returns the counters of the current thread
+       */
+      static hardware_counters &instance()
+      {
+        thread_local hardware_counters counters;
+        return counters;
+      }
+    };
+
+    /**
+     * Runs f once and measures its time and the hardware counters
+     */
+    template <class F> measurement measure(F f)
+    {
+      measurement result;
+      auto &counters = hardware_counters::instance();
+      counters.start();
+      const auto start = std::chrono::steady_clock::now();
+      f();
+      const auto end = std::chrono::steady_clock::now();
+      counters.stop(result.counters);
+      result.nanoseconds = std::chrono::duration<double, std::nano>(end - start).count();
+      return result;
+    }
+
+    /**
+     * Prints the header of the columns of ::printCounters()
+     */
+    inline void printCounterHeader()
+    {
+      for (int c = 0; c < number_of_counters; ++c) {
+        std::printf(" %10s", counterName(c));
+      }
+    }
+
+    /**
+     * Prints each counter divided by the number of operations, or "-" if it
+     * is not available
+     */
+    inline void printCounters(const measurement &m, double operations)
+    {
+      for (int c = 0; c < number_of_counters; ++c) {
+        if (m.counters[c] < 0) {
+          std::printf(" %10s", "-");
+        }
+        else {
+          std::printf(" %10.3f", m.counters[c] / operations);
+        }
+      }
+    }
+
+    /**
+     * Prevents that the compiler removes the computation of the value
+     */
+    template <typename T> void doNotOptimize(const T &value)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+      asm volatile("" : : "g"(value) : "memory");
+#else
+      static const T *volatile sink;
+      sink = &value;
+#endif
+    }
+  }
+}
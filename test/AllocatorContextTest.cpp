@@ -0,0 +1,141 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/allocator_context.hpp>
+#include <alb/stack_allocator.hpp>
+
+#include <memory>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+  using Arena = alb::stack_allocator<4096, 8>;
+
+  template <typename T> using arena_vector = std::vector<T, alb::context_allocator<T, Arena>>;
+
+  template <typename T> bool isIn(const Arena &arena, const arena_vector<T> &v)
+  {
+    return arena.owns(alb::block(const_cast<T *>(v.data()), v.capacity() * sizeof(T)));
+  }
+}
+
+class AllocatorContextTest : public ::testing::Test {
+protected:
+  Arena arena;
+  Arena otherArena;
+};
+
+TEST_F(AllocatorContextTest, ThatWithoutContextTheGlobalInstanceIsTaken)
+{
+  arena_vector<int> v(10);
+  EXPECT_EQ(std::addressof(alb::global_allocator<Arena>::instance()),
+            std::addressof(v.get_allocator().allocator()));
+  EXPECT_FALSE(isIn(arena, v));
+}
+
+TEST_F(AllocatorContextTest, ThatContainersBuiltInAContextUseItsAllocator)
+{
+  alb::scoped_allocator_context<Arena> context(arena);
+  arena_vector<int> v;
+  for (int i = 0; i < 100; ++i) {
+    v.push_back(i);
+  }
+  EXPECT_EQ(std::addressof(arena), std::addressof(v.get_allocator().allocator()));
+  EXPECT_TRUE(isIn(arena, v));
+  EXPECT_EQ(4950, std::accumulate(v.begin(), v.end(), 0));
+}
+
+TEST_F(AllocatorContextTest, ThatFreeingTheLastBlockRewindsTheArena)
+{
+  alb::scoped_allocator_context<Arena> context(arena);
+  const char *data = nullptr;
+  {
+    // the requested length is not a multiple of the alignment of the arena
+    arena_vector<char> v;
+    v.reserve(3);
+    data = v.data();
+    EXPECT_TRUE(isIn(arena, v));
+  }
+  auto b = arena.allocate(8);
+  EXPECT_EQ(data, b.ptr);
+  arena.deallocate(b);
+}
+
+TEST_F(AllocatorContextTest, ThatNestedContextsRestoreThePreviousOne)
+{
+  alb::scoped_allocator_context<Arena> outer(arena);
+  {
+    alb::scoped_allocator_context<Arena> inner(otherArena);
+    EXPECT_EQ(std::addressof(otherArena),
+              std::addressof(alb::scoped_allocator_context<Arena>::allocator()));
+  }
+  EXPECT_EQ(std::addressof(arena),
+            std::addressof(alb::scoped_allocator_context<Arena>::allocator()));
+}
+
+TEST_F(AllocatorContextTest, ThatAContainerKeepsItsOwnerAfterTheContextHasEnded)
+{
+  std::unique_ptr<arena_vector<int>> v;
+  {
+    alb::scoped_allocator_context<Arena> context(arena);
+    v.reset(new arena_vector<int>(10, 42));
+  }
+  alb::scoped_allocator_context<Arena> context(otherArena);
+  v->resize(100, 42);
+  EXPECT_TRUE(isIn(arena, *v));
+  EXPECT_FALSE(isIn(otherArena, *v));
+  v.reset();
+}
+
+TEST_F(AllocatorContextTest, ThatACopyIsConstructedInTheCurrentContext)
+{
+  alb::scoped_allocator_context<Arena> context(arena);
+  arena_vector<int> original(10, 42);
+  {
+    alb::scoped_allocator_context<Arena> inner(otherArena);
+    arena_vector<int> copy(original);
+    EXPECT_TRUE(isIn(otherArena, copy));
+    EXPECT_EQ(original, copy);
+  }
+  EXPECT_TRUE(isIn(arena, original));
+}
+
+TEST_F(AllocatorContextTest, ThatNestedContainersUseTheContextAndAreFreedByOneReset)
+{
+  using arena_string =
+      std::basic_string<char, std::char_traits<char>, alb::context_allocator<char, Arena>>;
+  {
+    alb::scoped_allocator_context<Arena> context(arena);
+    arena_vector<arena_string> strings;
+    strings.reserve(4);
+    for (int i = 0; i < 4; ++i) {
+      strings.emplace_back(100, 'a' + i);
+    }
+    for (auto &s : strings) {
+      EXPECT_TRUE(arena.owns(alb::block(&s[0], s.size())));
+    }
+  }
+  arena.deallocateAll();
+  auto b = arena.allocate(4096);
+  EXPECT_EQ(4096u, b.length);
+}
+
+TEST_F(AllocatorContextTest, ThatTheContextIsOnlyCurrentInItsThread)
+{
+  alb::scoped_allocator_context<Arena> context(arena);
+  Arena *inOtherThread = nullptr;
+  std::thread t([&inOtherThread] {
+    inOtherThread = std::addressof(alb::scoped_allocator_context<Arena>::allocator());
+  });
+  t.join();
+  EXPECT_EQ(std::addressof(alb::global_allocator<Arena>::instance()), inOtherThread);
+}
@@ -0,0 +1,177 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/buffer_chain.hpp>
+#include <alb/freelist.hpp>
+#include <alb/mallocator.hpp>
+#include "TestHelpers/Base.h"
+
+#include <string>
+#include <unistd.h>
+
+using namespace alb::test_helpers;
+
+class BufferChainTest : public ::testing::Test {
+protected:
+  using Chain = alb::buffer_chain<TestMallocator, 128>;
+
+  TestMallocator segments;
+
+  static std::string content(const Chain &chain)
+  {
+    std::string result(chain.size(), '\0');
+    chain.copy_to(&result[0], result.size());
+    return result;
+  }
+
+  static std::string pattern(size_t n)
+  {
+    std::string result;
+    for (size_t i = 0; i < n; ++i) {
+      result += static_cast<char>('a' + i % 26);
+    }
+    return result;
+  }
+};
+
+TEST_F(BufferChainTest, ThatAppendingFillsSegmentsWithoutMovingTheContent)
+{
+  Chain sut(segments);
+  const auto data = pattern(3 * Chain::segment_capacity + 10);
+
+  ASSERT_TRUE(sut.append(data.data(), 10));
+  const auto first = sut.iovecs()[0].iov_base;
+  ASSERT_TRUE(sut.append(data.data() + 10, data.size() - 10));
+
+  EXPECT_EQ(data.size(), sut.size());
+  EXPECT_EQ(4u, sut.iovec_count());
+  EXPECT_EQ(first, sut.iovecs()[0].iov_base);
+  EXPECT_EQ(Chain::segment_capacity, sut.iovecs()[0].iov_len);
+  EXPECT_EQ(10u, sut.iovecs()[3].iov_len);
+  EXPECT_EQ(data, content(sut));
+}
+
+TEST_F(BufferChainTest, ThatPrepareAndCommitAllowWritingInPlace)
+{
+  Chain sut(segments);
+  auto b = sut.prepare();
+  ASSERT_NE(nullptr, b.ptr);
+  EXPECT_EQ(Chain::segment_capacity, b.length);
+
+  ::memcpy(b.ptr, "hello", 5);
+  sut.commit(5);
+  auto rest = sut.prepare();
+  EXPECT_EQ(static_cast<char *>(b.ptr) + 5, rest.ptr);
+
+  EXPECT_EQ(std::string("hello"), content(sut));
+}
+
+TEST_F(BufferChainTest, ThatTheIoVectorsCanBeWrittenByWritev)
+{
+  Chain sut(segments);
+  const auto data = pattern(1000);
+  ASSERT_TRUE(sut.append(data.data(), data.size()));
+
+  int fds[2];
+  ASSERT_EQ(0, ::pipe(fds));
+  ASSERT_EQ(static_cast<ssize_t>(data.size()),
+            ::writev(fds[1], sut.iovecs(), static_cast<int>(sut.iovec_count())));
+
+  std::string received(data.size(), '\0');
+  size_t read = 0;
+  while (read < received.size()) {
+    auto n = ::read(fds[0], &received[read], received.size() - read);
+    ASSERT_LT(0, n);
+    read += static_cast<size_t>(n);
+  }
+  ::close(fds[0]);
+  ::close(fds[1]);
+  EXPECT_EQ(data, received);
+}
+
+TEST_F(BufferChainTest, ThatSlicesShareTheSegments)
+{
+  const auto initiallyAllocated = TestMallocator::currentlyAllocatedBytes();
+  const auto data = pattern(2 * Chain::segment_capacity);
+  {
+    Chain sut(segments);
+    ASSERT_TRUE(sut.append(data.data(), data.size()));
+    const auto withContent = TestMallocator::currentlyAllocatedBytes();
+
+    auto part = sut.slice(Chain::segment_capacity - 5, 10);
+    EXPECT_EQ(2u, part.iovec_count());
+    EXPECT_EQ(data.substr(Chain::segment_capacity - 5, 10), content(part));
+    EXPECT_EQ(static_cast<char *>(sut.iovecs()[0].iov_base) + Chain::segment_capacity - 5,
+              part.iovecs()[0].iov_base);
+
+    sut.clear();
+    EXPECT_EQ(data.substr(Chain::segment_capacity - 5, 10), content(part));
+
+    // the shared segment is not overwritten
+    ASSERT_TRUE(part.append("xyz", 3));
+    EXPECT_EQ(3u, part.iovec_count());
+    EXPECT_LT(withContent - 2 * 128, TestMallocator::currentlyAllocatedBytes());
+  }
+  EXPECT_EQ(initiallyAllocated, TestMallocator::currentlyAllocatedBytes());
+}
+
+TEST_F(BufferChainTest, ThatSpliceMovesTheContentWithoutCopying)
+{
+  Chain sut(segments);
+  Chain other(segments);
+  ASSERT_TRUE(sut.append("head", 4));
+  ASSERT_TRUE(other.append("tail", 4));
+  const auto tail = other.iovecs()[0].iov_base;
+
+  ASSERT_TRUE(sut.splice(other));
+
+  EXPECT_TRUE(other.empty());
+  EXPECT_EQ(0u, other.iovec_count());
+  EXPECT_EQ(tail, sut.iovecs()[1].iov_base);
+  EXPECT_EQ(std::string("headtail"), content(sut));
+}
+
+TEST_F(BufferChainTest, ThatConsumeReleasesTheSentSegments)
+{
+  const auto initiallyAllocated = TestMallocator::currentlyAllocatedBytes();
+  Chain sut(segments);
+  const auto data = pattern(3 * Chain::segment_capacity);
+  ASSERT_TRUE(sut.append(data.data(), data.size()));
+  const auto withContent = TestMallocator::currentlyAllocatedBytes();
+
+  sut.consume(Chain::segment_capacity + 7);
+
+  EXPECT_EQ(2u, sut.iovec_count());
+  EXPECT_EQ(data.substr(Chain::segment_capacity + 7), content(sut));
+  EXPECT_EQ(withContent - 128, TestMallocator::currentlyAllocatedBytes());
+
+  sut.consume(sut.size());
+  EXPECT_TRUE(sut.empty());
+  EXPECT_EQ(initiallyAllocated, TestMallocator::currentlyAllocatedBytes());
+}
+
+TEST(BufferChainWithFreelistTest, ThatSegmentsAreRecycledByTheFreelist)
+{
+  alb::freelist<alb::mallocator, 512, 512> pool;
+  alb::buffer_chain<decltype(pool), 512> sut(pool);
+
+  std::string data(2000, 'x');
+  ASSERT_TRUE(sut.append(data.data(), data.size()));
+  const auto first = sut.iovecs()[0].iov_base;
+  sut.clear();
+
+  ASSERT_TRUE(sut.append(data.data(), data.size()));
+  bool reused = false;
+  for (size_t i = 0; i < sut.iovec_count(); ++i) {
+    reused |= sut.iovecs()[i].iov_base == first;
+  }
+  EXPECT_TRUE(reused);
+  EXPECT_EQ(data.size(), sut.size());
+}
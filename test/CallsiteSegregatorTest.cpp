@@ -0,0 +1,121 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/callsite_segregator.hpp>
+#include <alb/allocator_with_stats.hpp>
+#include <alb/heap.hpp>
+#include <alb/mallocator.hpp>
+
+#include <set>
+#include <vector>
+
+namespace {
+  using SiteHeap = alb::heap<alb::mallocator, 64, 32>;
+}
+
+class CallsiteSegregatorTest : public ::testing::Test {
+protected:
+  alb::callsite_segregator<SiteHeap, alb::mallocator, 4> sut;
+};
+
+TEST_F(CallsiteSegregatorTest, ThatBlocksOfTheSameCallSiteAreLaidOutTogether)
+{
+  std::vector<alb::block> nodes;
+  std::vector<alb::block> strings;
+  for (int i = 0; i < 10; ++i) {
+    nodes.push_back(ALLOCATE(sut, 32));
+    strings.push_back(ALLOCATE(sut, 32));
+  }
+  EXPECT_EQ(2u, sut.sites());
+
+  for (size_t i = 1; i < nodes.size(); ++i) {
+    EXPECT_EQ(static_cast<char *>(nodes[i - 1].ptr) + 32, nodes[i].ptr);
+    EXPECT_EQ(static_cast<char *>(strings[i - 1].ptr) + 32, strings[i].ptr);
+  }
+  for (auto &b : nodes) {
+    sut.deallocate(b);
+  }
+  for (auto &b : strings) {
+    sut.deallocate(b);
+  }
+}
+
+TEST_F(CallsiteSegregatorTest, ThatRequestsWithoutCallSiteGoToTheOverflow)
+{
+  auto b = sut.allocate(32);
+  ASSERT_NE(nullptr, b.ptr);
+  EXPECT_EQ(0u, sut.sites());
+  sut.deallocate(b);
+  EXPECT_EQ(nullptr, b.ptr);
+}
+
+TEST_F(CallsiteSegregatorTest, ThatEqualNamesAtDifferentAddressesDenoteTheSameSite)
+{
+  // stand in for the same literal in different translation units
+  const char file[] = "Node.cpp";
+  const char otherFile[] = "Node.cpp";
+  const char function[] = "makeNode";
+  const char otherFunction[] = "makeNode";
+  ASSERT_NE(static_cast<const void *>(file), static_cast<const void *>(otherFile));
+
+  auto first = sut.allocate(32, file, function, 42);
+  auto second = sut.allocate(32, otherFile, otherFunction, 42);
+  EXPECT_EQ(1u, sut.sites());
+  EXPECT_EQ(static_cast<char *>(first.ptr) + 32, second.ptr);
+  sut.deallocate(first);
+  sut.deallocate(second);
+}
+
+TEST_F(CallsiteSegregatorTest, ThatSitesBeyondTheCapShareTheOverflow)
+{
+  std::vector<alb::block> blocks;
+  for (int line = 1; line <= 6; ++line) {
+    blocks.push_back(sut.allocate(32, __FILE__, __FUNCTION__, line));
+  }
+  EXPECT_EQ(4u, sut.sites());
+
+  std::set<size_t> sites;
+  int inOverflow = 0;
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    const auto site = sut.siteOf(blocks[i]);
+    if (site == sut.max_sites) {
+      ++inOverflow;
+    }
+    else {
+      sites.insert(site);
+    }
+    // a further block of the same line goes to the same place
+    auto next = sut.allocate(32, __FILE__, __FUNCTION__, static_cast<int>(i + 1));
+    EXPECT_EQ(site, sut.siteOf(next));
+    sut.deallocate(next);
+  }
+  EXPECT_EQ(2, inOverflow);
+  EXPECT_EQ(4u, sites.size());
+  for (auto &b : blocks) {
+    sut.deallocate(b);
+  }
+}
+
+TEST_F(CallsiteSegregatorTest, ThatAnExhaustedSiteFallsBackToTheOverflow)
+{
+  auto all = sut.allocate(64 * 32, __FILE__, __FUNCTION__, 1);
+  auto more = sut.allocate(32, __FILE__, __FUNCTION__, 1);
+  ASSERT_NE(nullptr, more.ptr);
+  EXPECT_EQ(1u, sut.sites());
+
+  ASSERT_TRUE(sut.reallocate(all, 64 * 32 + 1));
+  EXPECT_EQ(64u * 32 + 1, all.length);
+
+  sut.deallocate(more);
+  sut.deallocate(all);
+  auto again = sut.allocate(64 * 32, __FILE__, __FUNCTION__, 1);
+  EXPECT_NE(nullptr, again.ptr);
+  sut.deallocate(again);
+}
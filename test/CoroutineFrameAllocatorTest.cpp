@@ -0,0 +1,80 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/coroutine_frame_allocator.hpp>
+#include "TestHelpers/Base.h"
+
+#include <thread>
+
+using namespace alb::test_helpers;
+
+namespace {
+  // stands in for a coroutine frame, whose size the compiler determines
+  struct Frame : alb::coroutine_frame_allocator<> {
+    char locals[200];
+  };
+
+  struct LargeFrame : alb::coroutine_frame_allocator<> {
+    char locals[4000];
+  };
+
+  struct CountedFrame : alb::coroutine_frame_allocator<TestMallocator> {
+    char locals[100];
+  };
+
+  struct CountedBase : alb::coroutine_frame_allocator<TestMallocator> {
+    virtual ~CountedBase() = default;
+  };
+
+  struct CountedDerived : CountedBase {
+    char locals[100];
+  };
+}
+
+TEST(CoroutineFrameAllocatorTest, ThatFramesAreRecycledByTheThreadLocalFreelists)
+{
+  auto first = new Frame;
+  delete first;
+  auto second = new Frame;
+  EXPECT_EQ(first, second);
+  delete second;
+
+  auto large = new LargeFrame;
+  EXPECT_NE(nullptr, large);
+  delete large;
+}
+
+TEST(CoroutineFrameAllocatorTest, ThatTheAllocationIsRoutedToTheAllocator)
+{
+  const auto initiallyAllocated = TestMallocator::currentlyAllocatedBytes();
+  auto frame = new CountedFrame;
+  EXPECT_EQ(initiallyAllocated + sizeof(CountedFrame), TestMallocator::currentlyAllocatedBytes());
+  delete frame;
+  EXPECT_EQ(initiallyAllocated, TestMallocator::currentlyAllocatedBytes());
+}
+
+TEST(CoroutineFrameAllocatorTest, ThatTheSizeOfTheMostDerivedObjectIsPassedOnDeletion)
+{
+  const auto initiallyAllocated = TestMallocator::currentlyAllocatedBytes();
+  CountedBase *object = new CountedDerived;
+  EXPECT_EQ(initiallyAllocated + sizeof(CountedDerived),
+            TestMallocator::currentlyAllocatedBytes());
+  delete object;
+  EXPECT_EQ(initiallyAllocated, TestMallocator::currentlyAllocatedBytes());
+}
+
+TEST(CoroutineFrameAllocatorTest, ThatEachThreadHasItsOwnAllocator)
+{
+  auto mainAllocator = &alb::coroutine_frame_allocator<>::allocator();
+  const alb::default_frame_allocator *threadAllocator = nullptr;
+  std::thread t([&] { threadAllocator = &alb::coroutine_frame_allocator<>::allocator(); });
+  t.join();
+  EXPECT_NE(mainAllocator, threadAllocator);
+}
@@ -143,3 +143,31 @@ TEST(FreeListWithTruncatedDeallocationParentAllocatorTest, ThatThePreAllocatedBl
     EXPECT_EQ(static_cast<char *>(mem[i].ptr) + 16, mem[i + 1].ptr) << "Failure at " << i;
   }
 }
+
+template <class T> class FreeListRefillTest : public SharedListTest<T> {
+};
+
+using TypesForFreeListRefillTest =
+    ::testing::Types<alb::shared_freelist<alb::mallocator, 0, 16, 1024, 8, true>,
+                     alb::freelist<alb::mallocator, 0, 16>>;
+
+TYPED_TEST_CASE(FreeListRefillTest, TypesForFreeListRefillTest);
+
+TYPED_TEST(FreeListRefillTest, ThatRefillTakesWholeBatchesUntilThePoolHoldsEnoughBlocks)
+{
+  EXPECT_EQ(0u, this->sut.free_blocks());
+  EXPECT_EQ(16u, this->sut.refill(10));
+  EXPECT_EQ(16u, this->sut.free_blocks());
+  EXPECT_EQ(0u, this->sut.refill(16));
+
+  // the refilled blocks are served without a miss
+  this->mem = this->sut.allocate(16);
+  EXPECT_EQ(15u, this->sut.free_blocks());
+}
+
+TYPED_TEST(FreeListRefillTest, ThatRefillTakesNotMoreThanTheGivenMaximumOfBlocks)
+{
+  EXPECT_EQ(8u, this->sut.refill(100, 12));
+  EXPECT_EQ(8u, this->sut.free_blocks());
+  EXPECT_EQ(0u, this->sut.refill(100, 7));
+}
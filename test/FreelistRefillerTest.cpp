@@ -0,0 +1,209 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/freelist_refiller.hpp>
+#include <alb/bucketizer.hpp>
+#include <alb/freelist.hpp>
+#include <alb/mallocator.hpp>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+  /**
+   * Counts the allocations of the calling thread, that reach the mallocator
+   */
+  class CountingMallocator {
+    alb::mallocator _allocator;
+
+  public:
+    static const bool supports_truncated_deallocation = false;
+    static thread_local size_t allocations;
+
+    alb::block allocate(size_t n)
+    {
+      ++allocations;
+      return _allocator.allocate(n);
+    }
+
+    void deallocate(alb::block &b)
+    {
+      _allocator.deallocate(b);
+    }
+  };
+  thread_local size_t CountingMallocator::allocations = 0;
+
+  /**
+   * Stands in for a shared pool, of which other threads take half of each
+   * refilled batch, while it is refilled
+   */
+  class DrainingPool {
+    size_t _freeBlocks = 0;
+
+  public:
+    static const unsigned number_of_batch_allocations = 8;
+    static const unsigned pool_size = 1024;
+    static const bool is_shared = true;
+
+    size_t max_size() const
+    {
+      return 32;
+    }
+
+    size_t free_blocks() const
+    {
+      return _freeBlocks;
+    }
+
+    size_t refill(size_t numberOfBlocks, size_t maxBlocks)
+    {
+      size_t result = 0;
+      while (_freeBlocks < numberOfBlocks && result + number_of_batch_allocations <= maxBlocks) {
+        result += number_of_batch_allocations;
+        _freeBlocks += number_of_batch_allocations / 2;
+      }
+      return result;
+    }
+  };
+
+  template <class Pool> std::vector<alb::block> allocateBurst(Pool &pool, size_t n)
+  {
+    std::vector<alb::block> result;
+    for (size_t i = 0; i < n; ++i) {
+      result.push_back(pool.allocate(32));
+    }
+    return result;
+  }
+
+  template <class Pool> void deallocateAll(Pool &pool, std::vector<alb::block> &blocks)
+  {
+    for (auto &b : blocks) {
+      pool.deallocate(b);
+    }
+  }
+}
+
+class FreelistRefillerTest : public ::testing::Test {
+protected:
+  using Pool = alb::freelist<CountingMallocator, 0, 32, 256, 8>;
+
+  Pool pool;
+  alb::freelist_refiller sut{1 << 20};
+
+  void SetUp()
+  {
+    CountingMallocator::allocations = 0;
+  }
+};
+
+TEST_F(FreelistRefillerTest, ThatAPoolBelowItsLowWatermarkIsRefilledUpToItsHighWatermark)
+{
+  sut.watch(pool, 16, 64);
+  EXPECT_EQ(64u, sut.tick());
+  EXPECT_EQ(64u, pool.free_blocks());
+  EXPECT_EQ(64u, CountingMallocator::allocations);
+  EXPECT_EQ(64u * 32, sut.idle());
+
+  // above the low watermark nothing is done
+  auto blocks = allocateBurst(pool, 8);
+  EXPECT_EQ(0u, sut.tick());
+  EXPECT_EQ(56u, pool.free_blocks());
+  deallocateAll(pool, blocks);
+}
+
+TEST_F(FreelistRefillerTest, ThatABurstIsServedWithoutTheParentAndThePoolIsPreparedForTheNextOne)
+{
+  sut.watch(pool, 16, 64);
+  sut.tick();
+  const auto refilled = CountingMallocator::allocations;
+
+  auto blocks = allocateBurst(pool, 40);
+  EXPECT_EQ(refilled, CountingMallocator::allocations);
+
+  // 40 blocks were consumed, so the pool is filled up to 64 + 40
+  EXPECT_EQ(80u, sut.tick());
+  EXPECT_EQ(104u, pool.free_blocks());
+  EXPECT_EQ(144u, sut.refilled_blocks());
+  deallocateAll(pool, blocks);
+}
+
+TEST_F(FreelistRefillerTest, ThatTheRefillsKeepTheBudget)
+{
+  Pool other;
+  alb::freelist_refiller limited(80 * 32);
+  limited.watch(pool, 16, 64);
+  limited.watch(other, 16, 64);
+
+  // the second pool gets just the two batches left by the budget
+  EXPECT_EQ(80u, limited.tick());
+  EXPECT_EQ(64u, pool.free_blocks());
+  EXPECT_EQ(16u, other.free_blocks());
+
+  EXPECT_EQ(0u, limited.tick());
+  EXPECT_EQ(80u * 32, limited.idle());
+}
+
+TEST_F(FreelistRefillerTest, ThatADrainedSharedPoolGetsNotMoreThanThePlannedBatches)
+{
+  DrainingPool draining;
+  alb::freelist_refiller limited(64 * 32);
+  limited.watch(draining, 16, 64);
+
+  // without the limit the pool would take 16 batches to reach 64 blocks
+  EXPECT_EQ(64u, limited.tick());
+  EXPECT_EQ(32u, draining.free_blocks());
+}
+
+TEST_F(FreelistRefillerTest, ThatTheBucketsOfABucketizerAreWatched)
+{
+  alb::bucketizer<alb::freelist<alb::mallocator, alb::internal::DynasticDynamicSet,
+                                alb::internal::DynasticDynamicSet>,
+                  1, 64, 16> buckets;
+  sut.watchBuckets(buckets, 8, 16);
+  EXPECT_EQ(4u * 16, sut.tick());
+  for (unsigned i = 0; i < 4; ++i) {
+    EXPECT_EQ(16u, buckets.bucket(i).free_blocks());
+  }
+
+  auto b = buckets.allocate(40);
+  EXPECT_EQ(48u, b.length);
+  EXPECT_EQ(15u, buckets.bucket(2).free_blocks());
+  buckets.deallocate(b);
+}
+
+TEST_F(FreelistRefillerTest, ThatABackgroundThreadRefillsSharedPools)
+{
+  alb::shared_freelist<CountingMallocator, 0, 32, 1024, 8, true> shared;
+  // is declared after the pool, so it is stopped before the pool goes away
+  alb::freelist_refiller background(1 << 20);
+  background.watch(shared, 32, 64);
+  background.start(std::chrono::milliseconds(1));
+
+  auto waitForRefill = [&] {
+    for (int i = 0; i < 5000 && shared.free_blocks() < 32; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  };
+
+  std::vector<alb::block> blocks;
+  for (int burst = 0; burst < 5; ++burst) {
+    waitForRefill();
+    ASSERT_LE(32u, shared.free_blocks());
+    auto b = allocateBurst(shared, 30);
+    blocks.insert(blocks.end(), b.begin(), b.end());
+  }
+  background.stop();
+
+  // only the background thread took blocks from the mallocator
+  EXPECT_EQ(0u, CountingMallocator::allocations);
+  EXPECT_LE(5u * 30, background.refilled_blocks());
+  deallocateAll(shared, blocks);
+}
@@ -0,0 +1,135 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/growth_policy.hpp>
+#include <alb/heap.hpp>
+#include <alb/mallocator.hpp>
+#include <alb/stack_allocator.hpp>
+
+namespace {
+  /**
+   * Counts the reallocations, that reach the underlying mallocator
+   */
+  class CountingMallocator {
+    alb::mallocator _allocator;
+
+  public:
+    static const bool supports_truncated_deallocation = false;
+    static size_t reallocations;
+
+    alb::block allocate(size_t n)
+    {
+      return _allocator.allocate(n);
+    }
+
+    bool reallocate(alb::block &b, size_t n)
+    {
+      ++reallocations;
+      return _allocator.reallocate(b, n);
+    }
+
+    void deallocate(alb::block &b)
+    {
+      _allocator.deallocate(b);
+    }
+  };
+  size_t CountingMallocator::reallocations = 0;
+}
+
+TEST(GrowthPolicyTest, ThatTheCapacityGrowsGeometrically)
+{
+  using Policy = alb::growth_policy<alb::mallocator, 3, 2, 1024, 16>;
+  EXPECT_EQ(160u, Policy::capacityFor(100, 101));
+  EXPECT_EQ(1008u, Policy::capacityFor(100, 1000));
+  EXPECT_EQ(3072u, Policy::capacityFor(2048, 2049));
+  // capped by the maximum growth
+  EXPECT_EQ(1024u + 10000, Policy::capacityFor(10000, 10000));
+}
+
+TEST(GrowthPolicyTest, ThatAnAppendLoopReallocatesLogarithmically)
+{
+  alb::growth_policy<CountingMallocator> sut;
+  CountingMallocator::reallocations = 0;
+
+  auto b = sut.allocate(1);
+  size_t size = 1;
+  static_cast<char *>(b.ptr)[0] = 0;
+  for (size_t i = 1; i < 100000; ++i) {
+    ASSERT_TRUE(sut.reallocate(b, size + 1));
+    static_cast<char *>(b.ptr)[size++] = static_cast<char>(i);
+  }
+  EXPECT_GE(b.length, size);
+  EXPECT_GT(20u, CountingMallocator::reallocations);
+  EXPECT_EQ(static_cast<char>(99999), static_cast<char *>(b.ptr)[99999]);
+  sut.deallocate(b);
+}
+
+TEST(GrowthPolicyTest, ThatTheGrowthIsTriedInPlaceFirst)
+{
+  alb::growth_policy<alb::heap<alb::mallocator, 64, 16>, 2, 1, 1024, 16> sut;
+  auto b = sut.allocate(16);
+  const auto p = b.ptr;
+
+  ASSERT_TRUE(sut.reallocate(b, 17));
+  EXPECT_EQ(p, b.ptr);
+  EXPECT_EQ(32u, b.length);
+
+  ASSERT_TRUE(sut.reallocate(b, 40));
+  EXPECT_EQ(p, b.ptr);
+  EXPECT_EQ(64u, b.length);
+  sut.deallocate(b);
+}
+
+TEST(GrowthPolicyTest, ThatTheExactSizeIsTriedIfTheCapacityIsNotAvailable)
+{
+  alb::growth_policy<alb::heap<alb::mallocator, 64, 16>, 2, 1, 1024, 16> sut;
+  auto b = sut.allocate(400);
+  auto other = sut.allocate(16);
+  ASSERT_NE(nullptr, other.ptr);
+
+  // there are only 608 bytes left, which does not suffice for a capacity of 800
+  ASSERT_TRUE(sut.reallocate(b, 416));
+  EXPECT_EQ(416u, b.length);
+  sut.deallocate(b);
+  sut.deallocate(other);
+}
+
+TEST(GrowthPolicyTest, ThatShrinkingKeepsTheCapacity)
+{
+  alb::growth_policy<CountingMallocator> sut;
+  CountingMallocator::reallocations = 0;
+  auto b = sut.allocate(100);
+  EXPECT_EQ(112u, b.length);
+  const auto p = b.ptr;
+
+  ASSERT_TRUE(sut.reallocate(b, 50));
+  EXPECT_EQ(p, b.ptr);
+  EXPECT_EQ(112u, b.length);
+  ASSERT_TRUE(sut.reallocate(b, 112));
+  EXPECT_EQ(112u, b.length);
+  EXPECT_EQ(0u, CountingMallocator::reallocations);
+
+  ASSERT_TRUE(sut.reallocate(b, 0));
+  EXPECT_EQ(nullptr, b.ptr);
+}
+
+TEST(GrowthPolicyTest, ThatShrinkingBeyondTheCapacityIsPassedToTheAllocator)
+{
+  alb::growth_policy<CountingMallocator> sut;
+  CountingMallocator::reallocations = 0;
+  auto b = sut.allocate(1024 * 1024);
+  EXPECT_EQ(1024u * 1024, b.length);
+
+  // the geometric capacity of 16 bytes is far below the length
+  ASSERT_TRUE(sut.reallocate(b, 16));
+  EXPECT_EQ(16u, b.length);
+  EXPECT_EQ(1u, CountingMallocator::reallocations);
+  sut.deallocate(b);
+}
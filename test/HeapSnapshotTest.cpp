@@ -0,0 +1,127 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/heap_snapshot.hpp>
+#include <alb/heap.hpp>
+#include <alb/mallocator.hpp>
+#include <alb/shared_heap.hpp>
+
+#include <sstream>
+#include <string>
+
+template <class T> class HeapSnapshotTest : public ::testing::Test {
+protected:
+  T heap;
+
+  // used chunks: [0, 4), [6, 7), [10, 30), free: [4, 6), [7, 10), [30, 128)
+  void fragment()
+  {
+    auto a = heap.allocate(4 * 16);
+    auto b = heap.allocate(2 * 16);
+    auto c = heap.allocate(1 * 16);
+    auto d = heap.allocate(3 * 16);
+    auto e = heap.allocate(20 * 16);
+    ASSERT_TRUE(a && b && c && d && e);
+    heap.deallocate(b);
+    heap.deallocate(d);
+  }
+};
+
+using TypesForHeapSnapshotTest =
+    ::testing::Types<alb::heap<alb::mallocator, 128, 16>, alb::shared_heap<alb::mallocator, 128, 16>>;
+
+TYPED_TEST_CASE(HeapSnapshotTest, TypesForHeapSnapshotTest);
+
+TYPED_TEST(HeapSnapshotTest, ThatTheSnapshotOfAnEmptyHeapIsCompletelyFree)
+{
+  alb::heap_snapshot<> sut(this->heap);
+  EXPECT_EQ(128u, sut.number_of_chunks());
+  EXPECT_EQ(16u, sut.chunk_size());
+  EXPECT_EQ(128u, sut.free_chunks());
+  EXPECT_EQ(128u, sut.largest_free_run());
+  EXPECT_DOUBLE_EQ(0.0, sut.fragmentation_index());
+}
+
+TYPED_TEST(HeapSnapshotTest, ThatTheFreeRunsOfAFragmentedHeapAreAnalyzed)
+{
+  this->fragment();
+  alb::heap_snapshot<> sut(this->heap);
+
+  EXPECT_FALSE(sut.is_free(0));
+  EXPECT_TRUE(sut.is_free(4));
+  EXPECT_FALSE(sut.is_free(6));
+  EXPECT_EQ(103u, sut.free_chunks());
+  EXPECT_EQ(98u, sut.largest_free_run());
+  EXPECT_DOUBLE_EQ(1.0 - 98.0 / 103.0, sut.fragmentation_index());
+
+  size_t histogram[alb::heap_snapshot<>::histogram_size];
+  sut.free_run_histogram(histogram);
+  EXPECT_EQ(2u, histogram[1]);  // 2 and 3 chunks
+  EXPECT_EQ(1u, histogram[6]);  // 98 chunks
+  EXPECT_EQ(0u, histogram[0]);
+  EXPECT_EQ(0u, histogram[5]);
+}
+
+TYPED_TEST(HeapSnapshotTest, ThatAWrittenSnapshotIsReadIdentically)
+{
+  this->fragment();
+  alb::heap_snapshot<> original(this->heap);
+
+  std::stringstream file;
+  ASSERT_TRUE(original.write(file));
+  // magic, two sizes and six runs
+  EXPECT_EQ(8u + 2 + 1 + 6, file.str().size());
+
+  alb::heap_snapshot<> sut;
+  ASSERT_TRUE(sut.read(file));
+  EXPECT_EQ(original.number_of_chunks(), sut.number_of_chunks());
+  EXPECT_EQ(original.chunk_size(), sut.chunk_size());
+  for (size_t i = 0; i < sut.number_of_chunks(); ++i) {
+    EXPECT_EQ(original.is_free(i), sut.is_free(i)) << i;
+  }
+}
+
+TEST(HeapSnapshotReadTest, ThatAnInvalidFileIsRejected)
+{
+  alb::heap_snapshot<> sut;
+  std::stringstream noMagic("ALBHEAP0");
+  EXPECT_FALSE(sut.read(noMagic));
+
+  // the runs exceed the number of chunks
+  std::stringstream tooLong(std::string("ALBHEAP1") + '\x08' + '\x10' + '\x04' + '\x05');
+  EXPECT_FALSE(sut.read(tooLong));
+  EXPECT_EQ(0u, sut.number_of_chunks());
+}
+
+TEST(HeapSnapshotReadTest, ThatAnExcessiveNumberOfChunksIsRejected)
+{
+  alb::heap_snapshot<> sut;
+  // 2^64 - 1 chunks, that would wrap the size of the control bits
+  std::stringstream huge(std::string("ALBHEAP1") + std::string(9, '\xff') + '\x01' + '\x10' +
+                         '\x01');
+  EXPECT_FALSE(sut.read(huge));
+  EXPECT_EQ(0u, sut.number_of_chunks());
+  EXPECT_EQ(0u, sut.free_chunks());
+}
+
+TYPED_TEST(HeapSnapshotTest, ThatThePgmImageHasOnePixelPerChunk)
+{
+  this->fragment();
+  alb::heap_snapshot<> sut(this->heap);
+
+  std::stringstream image;
+  ASSERT_TRUE(sut.write_pgm(image, 64));
+  const std::string header = "P5\n64 2\n255\n";
+  const auto content = image.str();
+  ASSERT_EQ(header.size() + 128, content.size());
+  EXPECT_EQ(header, content.substr(0, header.size()));
+  EXPECT_EQ('\0', content[header.size()]);
+  EXPECT_EQ('\xff', content[header.size() + 4]);
+}
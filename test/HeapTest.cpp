@@ -12,11 +12,15 @@
 #include <alb/heap.hpp>
 #include <alb/mallocator.hpp>
 #include <alb/affix_allocator.hpp>
+#include <alb/freelist.hpp>
 #include "TestHelpers/AllocatorBaseTest.h"
 #include "TestHelpers/UsedMemGenerator.h"
 #include "TestHelpers/Thread.h"
 #include "TestHelpers/AffixGuard.h"
 #include "TestHelpers/Base.h"
+#include <algorithm>
+#include <initializer_list>
+#include <iterator>
 
 using namespace alb::test_helpers;
 
@@ -293,6 +297,172 @@ TYPED_TEST(HeapWithSmallAllocationsTest,
   EXPECT_MEM_EQ(mem.ptr, (void *)ReferenceData.data(), origMem.length);
 }
 
+TYPED_TEST(HeapWithSmallAllocationsTest,
+           ThatABlockEndingAtAControlRegisterIsExpandedIntoTheNextOneButNotBeyondTheHeap)
+{
+  auto mem = this->sut.allocate(SmallChunkSize * 64);
+  auto origMem = mem;
+
+  EXPECT_TRUE(this->sut.expand(mem, SmallChunkSize * 8));
+  EXPECT_EQ(origMem.ptr, mem.ptr);
+  EXPECT_EQ(SmallChunkSize * (64 + 8), mem.length);
+
+  // takes all chunks up to the end of the heap
+  auto last = this->sut.allocate(SmallChunkSize * 120);
+  ASSERT_NE(nullptr, last.ptr);
+  EXPECT_EQ(static_cast<char *>(mem.ptr) + mem.length, last.ptr);
+  EXPECT_FALSE(this->sut.expand(last, SmallChunkSize));
+  EXPECT_EQ(SmallChunkSize * 120, last.length);
+
+  this->sut.deallocate(last);
+  this->sut.deallocate(mem);
+}
+
+TYPED_TEST(HeapWithSmallAllocationsTest,
+           ThatATruncatedBlockFreesOnlyTheChunksItsLengthCoversCompletely)
+{
+  auto mem = this->sut.allocate(SmallChunkSize * 4);
+  auto start = static_cast<char *>(mem.ptr);
+
+  // covers the first two chunks completely and the third one partly
+  alb::block truncated(start, SmallChunkSize * 2 + SmallChunkSize / 2);
+  this->sut.deallocate(truncated);
+
+  auto freed = this->sut.allocate(SmallChunkSize * 2);
+  EXPECT_EQ(start, freed.ptr);
+  auto behind = this->sut.allocate(SmallChunkSize);
+  EXPECT_NE(start + SmallChunkSize * 2, behind.ptr);
+
+  // a truncated block shorter than a chunk frees nothing
+  alb::block partial(start + SmallChunkSize * 3, SmallChunkSize / 2);
+  this->sut.deallocate(partial);
+  auto other = this->sut.allocate(SmallChunkSize);
+  EXPECT_NE(start + SmallChunkSize * 3, other.ptr);
+
+  this->sut.deallocate(other);
+  this->sut.deallocate(behind);
+  this->sut.deallocate(freed);
+}
+
+namespace {
+  using ParentHeap = alb::heap<alb::mallocator, 512, 64>;
+
+  /**
+   * Lets a freelist take its blocks from a heap, that the test can access
+   */
+  struct ParentHeapRef {
+    static const bool supports_truncated_deallocation = ParentHeap::supports_truncated_deallocation;
+    static ParentHeap *heap;
+
+    alb::block allocate(size_t n)
+    {
+      return heap->allocate(n);
+    }
+
+    void deallocate(alb::block &b)
+    {
+      heap->deallocate(b);
+    }
+  };
+  ParentHeap *ParentHeapRef::heap = nullptr;
+}
+
+class HeapTruncatedDeallocationTest : public ::testing::Test {
+protected:
+  // a batch of three blocks of 48 bytes spans three chunks of 64 bytes
+  using Pool = alb::freelist<ParentHeapRef, 0, 48, 2, 3>;
+
+  HeapTruncatedDeallocationTest()
+  {
+    ParentHeapRef::heap = &heap;
+  }
+
+  ~HeapTruncatedDeallocationTest()
+  {
+    ParentHeapRef::heap = nullptr;
+  }
+
+  /**
+   * Takes a whole batch from the pool and returns its blocks in the given
+   * order of their addresses. The pool keeps the first two blocks, so only
+   * the last one goes back to the heap.
+   * \return The start of the batch
+   */
+  void *deallocateBatch(Pool &pool, std::initializer_list<int> order)
+  {
+    alb::block blocks[3];
+    for (auto &b : blocks) {
+      b = pool.allocate(48);
+    }
+    std::sort(std::begin(blocks), std::end(blocks),
+              [](const alb::block &x, const alb::block &y) { return x.ptr < y.ptr; });
+    EXPECT_EQ(static_cast<char *>(blocks[0].ptr) + 48, blocks[1].ptr);
+    EXPECT_EQ(static_cast<char *>(blocks[1].ptr) + 48, blocks[2].ptr);
+    const auto start = blocks[0].ptr;
+
+    for (auto i : order) {
+      pool.deallocate(blocks[i]);
+    }
+    return start;
+  }
+
+  /**
+   * Checks that no chunk of the batch, that still holds a pooled block, is
+   * handed out by the heap again.
+   */
+  void expectBatchStillUsed(void *start)
+  {
+    auto next = heap.allocate(64);
+    EXPECT_TRUE(next.ptr < start || static_cast<char *>(start) + 3 * 64 <= next.ptr);
+    heap.deallocate(next);
+  }
+
+  ParentHeap heap;
+};
+
+TEST_F(HeapTruncatedDeallocationTest, ThatAFreelistOverAHeapKeepsTheNeighbourOfAReturnedBlock)
+{
+  Pool sut;
+  // the last block returns to the heap and starts within a chunk
+  auto start = deallocateBatch(sut, {0, 1, 2});
+  expectBatchStillUsed(start);
+}
+
+TEST_F(HeapTruncatedDeallocationTest,
+       ThatAFreelistOverAHeapKeepsTheNeighbourOfAReturnedBlockAtAChunkBoundary)
+{
+  Pool sut;
+  // the first block returns to the heap and starts at the first chunk, while
+  // its neighbour still uses the rest of this chunk
+  auto start = deallocateBatch(sut, {2, 1, 0});
+  expectBatchStillUsed(start);
+}
+
+TYPED_TEST(HeapWithSmallAllocationsTest,
+           ThatShrinkingABlockOverTwoControlRegistersFreesTheChunksInTheSecondOne)
+{
+  auto mem = this->sut.allocate(SmallChunkSize * 100);
+  auto origMem = mem;
+
+  EXPECT_TRUE(this->sut.reallocate(mem, SmallChunkSize * 70));
+  EXPECT_EQ(origMem.ptr, mem.ptr);
+  EXPECT_EQ(SmallChunkSize * 70, mem.length);
+  auto behind = this->sut.allocate(SmallChunkSize * 30);
+  EXPECT_EQ(static_cast<char *>(mem.ptr) + mem.length, behind.ptr);
+  this->sut.deallocate(behind);
+
+  EXPECT_TRUE(this->sut.reallocate(mem, SmallChunkSize * 64));
+  EXPECT_EQ(SmallChunkSize * 64, mem.length);
+  behind = this->sut.allocate(SmallChunkSize * 64);
+  EXPECT_EQ(static_cast<char *>(mem.ptr) + mem.length, behind.ptr);
+
+  this->sut.deallocate(behind);
+  this->sut.deallocate(mem);
+  auto all = this->sut.allocate(SmallChunkSize * NumberOfChunks);
+  EXPECT_EQ(origMem.ptr, all.ptr);
+  this->sut.deallocate(all);
+}
+
 TYPED_TEST(HeapWithSmallAllocationsTest,
            ThatReallocatrByZeroBytesOfAnEmptyBlockReturnsSuccessAndDoesNotChangeTheProvidedBlock)
 {
@@ -0,0 +1,170 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/instrumented.hpp>
+#include <alb/mallocator.hpp>
+#include <alb/shared_heap.hpp>
+#include <alb/stack_allocator.hpp>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+  using Buckets = alb::bucketizer<alb::freelist<alb::mallocator, alb::internal::DynasticDynamicSet,
+                                                alb::internal::DynasticDynamicSet>,
+                                  1, 64, 16>;
+  using Composition =
+      alb::segregator<64, Buckets, alb::fallback_allocator<alb::stack_allocator<512>,
+                                                           alb::mallocator>>;
+  using AllocatorUnderTest = alb::instrumented<Composition>;
+
+  std::vector<const alb::layer_statistics *> layersOf(const alb::layer_statistics &root)
+  {
+    std::vector<const alb::layer_statistics *> result;
+    alb::for_each_layer(root,
+                        [&result](const alb::layer_statistics &l, size_t) { result.push_back(&l); });
+    return result;
+  }
+}
+
+TEST(InstrumentTest, ThatEverySubAllocatorIsWrappedByACountingLayer)
+{
+  using Expected = alb::counting_layer<alb::segregator<
+      64, alb::counting_layer<alb::bucketizer<
+              alb::counting_layer<alb::freelist<alb::counting_layer<alb::mallocator>,
+                                                alb::internal::DynasticDynamicSet,
+                                                alb::internal::DynasticDynamicSet>>,
+              1, 64, 16>>,
+      alb::counting_layer<alb::fallback_allocator<alb::counting_layer<alb::stack_allocator<512>>,
+                                                  alb::counting_layer<alb::mallocator>>>>>;
+  EXPECT_TRUE((std::is_same<Expected, AllocatorUnderTest>::value));
+  EXPECT_TRUE((std::is_same<alb::counting_layer<alb::mallocator>,
+                            alb::instrumented<alb::mallocator>>::value));
+}
+
+TEST(InstrumentTest, ThatTheLayersFormATreeLikeTheComposition)
+{
+  AllocatorUnderTest sut;
+  auto layers = layersOf(sut.statistics());
+
+  // segregator, bucketizer, 4 x (freelist, mallocator), fallback, stack, mallocator
+  ASSERT_EQ(13u, layers.size());
+  EXPECT_EQ("alb::segregator", layers[0]->name());
+  EXPECT_EQ(nullptr, layers[0]->parent());
+  EXPECT_EQ("alb::bucketizer", layers[1]->name());
+  EXPECT_EQ(layers[0], layers[1]->parent());
+  EXPECT_EQ("alb::freelist", layers[2]->name());
+  EXPECT_EQ(layers[1], layers[2]->parent());
+  EXPECT_EQ("alb::mallocator", layers[3]->name());
+  EXPECT_EQ(layers[2], layers[3]->parent());
+  EXPECT_EQ("alb::fallback_allocator", layers[10]->name());
+  EXPECT_EQ(layers[0], layers[10]->parent());
+  EXPECT_EQ("alb::stack_allocator", layers[11]->name());
+  EXPECT_EQ("alb::mallocator", layers[12]->name());
+  EXPECT_EQ(layers[10], layers[12]->parent());
+}
+
+TEST(InstrumentTest, ThatEachBucketCountsItsOwnRequests)
+{
+  AllocatorUnderTest sut;
+  auto b1 = sut.allocate(8);
+  auto b2 = sut.allocate(20);
+  auto b3 = sut.allocate(24);
+  ASSERT_TRUE(b1 && b2 && b3);
+
+  auto layers = layersOf(sut.statistics());
+  EXPECT_EQ(3u, layers[0]->hits);
+  EXPECT_EQ(3u, layers[1]->hits);
+  EXPECT_EQ(1u, layers[2]->hits);
+  EXPECT_EQ(8u, layers[2]->smallest);
+  EXPECT_EQ(2u, layers[4]->hits);
+  EXPECT_EQ(20u, layers[4]->smallest);
+  EXPECT_EQ(24u, layers[4]->largest);
+  EXPECT_EQ(0u, layers[6]->hits);
+  EXPECT_EQ(0u, layers[10]->hits);
+
+  sut.deallocate(b1);
+  sut.deallocate(b2);
+  sut.deallocate(b3);
+  EXPECT_EQ(3u, layers[0]->deallocations);
+  EXPECT_EQ(2u, layers[4]->deallocations);
+}
+
+TEST(InstrumentTest, ThatARequestTheStackCannotServeIsCountedAsMissAndSpill)
+{
+  AllocatorUnderTest sut;
+  auto small = sut.allocate(400);
+  auto large = sut.allocate(400);
+  ASSERT_TRUE(small && large);
+
+  auto layers = layersOf(sut.statistics());
+  const auto &fallback = *layers[10];
+  const auto &stack = *layers[11];
+  const auto &mallocator = *layers[12];
+  EXPECT_EQ(2u, fallback.hits);
+  EXPECT_EQ(1u, fallback.spills);
+  EXPECT_EQ(0u, fallback.misses);
+  EXPECT_EQ(1u, stack.hits);
+  EXPECT_EQ(1u, stack.misses);
+  EXPECT_EQ(1u, mallocator.hits);
+  EXPECT_EQ(1u, layers[0]->spills);
+  EXPECT_EQ(0u, layers[1]->hits);
+
+  sut.deallocate(large);
+  sut.deallocate(small);
+  EXPECT_EQ(1u, stack.deallocations);
+  EXPECT_EQ(1u, mallocator.deallocations);
+}
+
+TEST(InstrumentTest, ThatEachNodeOfACascadingAllocatorBecomesALayer)
+{
+  alb::instrumented<alb::shared_cascading_allocator<alb::shared_heap<alb::mallocator, 64, 16>>>
+      sut;
+  EXPECT_EQ(nullptr, sut.statistics().first_child());
+
+  // each node keeps itself in its heap, so only one of the blocks fits into a node
+  auto a = sut.allocate(400);
+  auto b = sut.allocate(400);
+  ASSERT_TRUE(a && b);
+
+  auto layers = layersOf(sut.statistics());
+  ASSERT_EQ(3u, layers.size());
+  EXPECT_EQ("alb::shared_cascading_allocator", layers[0]->name());
+  EXPECT_EQ("alb::shared_heap", layers[1]->name());
+  EXPECT_EQ("alb::shared_heap", layers[2]->name());
+  EXPECT_EQ(layers[0], layers[2]->parent());
+  EXPECT_EQ(2u, layers[0]->hits);
+  EXPECT_EQ(1u, layers[0]->spills);
+  // each node served its own node and one block, the full first node was tried twice
+  EXPECT_EQ(2u, layers[1]->hits);
+  EXPECT_EQ(2u, layers[1]->misses);
+  EXPECT_EQ(2u, layers[2]->hits);
+  EXPECT_EQ(0u, layers[2]->misses);
+
+  sut.deallocate(a);
+  sut.deallocate(b);
+}
+
+TEST(InstrumentTest, ThatTheLayersArePrintedAsIndentedTree)
+{
+  AllocatorUnderTest sut;
+  auto b = sut.allocate(100);
+  ASSERT_NE(nullptr, b.ptr);
+
+  std::ostringstream out;
+  alb::print_layers(out, sut.statistics());
+  const auto text = out.str();
+  EXPECT_EQ(0u, text.find("alb::segregator: hits 1, misses 0, spills 0, deallocations 0, "
+                          "sizes [100, 100]\n"));
+  EXPECT_NE(std::string::npos, text.find("\n  alb::fallback_allocator: hits 1"));
+  EXPECT_NE(std::string::npos, text.find("\n    alb::stack_allocator: hits 1"));
+  sut.deallocate(b);
+}
@@ -0,0 +1,159 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/io_buffer_pool.hpp>
+#include <alb/shared_heap.hpp>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+  /**
+   * A heap, whose region could not be allocated
+   */
+  template <class Allocator, size_t NumberOfChunks, size_t ChunkSize> class heap_without_region {
+    alb::block _buffer;
+
+  public:
+    const alb::block &buffer() const
+    {
+      return _buffer;
+    }
+
+    alb::block allocate(size_t)
+    {
+      return {};
+    }
+
+    void deallocate(alb::block &)
+    {
+    }
+
+    bool owns(const alb::block &) const
+    {
+      return false;
+    }
+  };
+}
+
+class IoBufferPoolTest : public ::testing::Test {
+protected:
+  alb::io_buffer_pool<4096, 64> sut;
+};
+
+TEST_F(IoBufferPoolTest, ThatAllBuffersArePageAligned)
+{
+  auto first = sut.allocate(1);
+  auto second = sut.allocate(4096);
+  auto third = sut.allocate(3 * 4096);
+
+  for (auto b : {first, second, third}) {
+    ASSERT_NE(nullptr, b.memory.ptr);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(b.memory.ptr) % 4096);
+    EXPECT_EQ(0u, b.memory.length % 4096);
+  }
+  EXPECT_EQ(4096u, first.memory.length);
+  EXPECT_EQ(3u * 4096, third.memory.length);
+
+  sut.deallocate(first);
+  sut.deallocate(second);
+  sut.deallocate(third);
+  EXPECT_FALSE(first);
+}
+
+TEST_F(IoBufferPoolTest, ThatTheIndexMatchesTheRegisteredIoVector)
+{
+  auto first = sut.allocate(4096);
+  auto second = sut.allocate(2 * 4096);
+
+  EXPECT_NE(first.index, second.index);
+  EXPECT_EQ(first.memory.ptr, sut.iovecs()[first.index].iov_base);
+  EXPECT_EQ(second.memory.ptr, sut.iovecs()[second.index].iov_base);
+  EXPECT_EQ(4096u, sut.iovecs()[second.index].iov_len);
+  EXPECT_EQ(second.index, sut.index_of(second.memory));
+
+  auto region = sut.region();
+  EXPECT_EQ(64u * 4096, region.iov_len);
+  EXPECT_EQ(sut.iovecs()[0].iov_base, region.iov_base);
+
+  sut.deallocate(first);
+  sut.deallocate(second);
+}
+
+TEST_F(IoBufferPoolTest, ThatAnExhaustedPoolReturnsAnEmptyBuffer)
+{
+  auto all = sut.allocate(64 * 4096);
+  ASSERT_NE(nullptr, all.memory.ptr);
+  EXPECT_TRUE(sut.owns(all.memory));
+
+  auto none = sut.allocate(1);
+  EXPECT_FALSE(none);
+
+  sut.deallocate(all);
+  auto again = sut.allocate(1);
+  EXPECT_TRUE(static_cast<bool>(again));
+  sut.deallocate(again);
+}
+
+TEST_F(IoBufferPoolTest, ThatBuffersCanBeUsedForDirectIo)
+{
+  char name[] = "/tmp/alb_io_buffer_poolXXXXXX";
+  const int tmp = ::mkstemp(name);
+  ASSERT_LE(0, tmp);
+  ::close(tmp);
+
+  int fd = -1;
+#ifdef O_DIRECT
+  fd = ::open(name, O_RDWR | O_DIRECT);
+#endif
+  if (fd < 0) {
+    // e.g. tmpfs does not support O_DIRECT
+    fd = ::open(name, O_RDWR);
+  }
+  ASSERT_LE(0, fd);
+
+  auto out = sut.allocate(2 * 4096);
+  auto in = sut.allocate(2 * 4096);
+  ::memset(out.memory.ptr, 'a', out.memory.length);
+  ::memset(in.memory.ptr, 0, in.memory.length);
+
+  EXPECT_EQ(static_cast<ssize_t>(out.memory.length),
+            ::pwrite(fd, out.memory.ptr, out.memory.length, 0));
+  EXPECT_EQ(static_cast<ssize_t>(in.memory.length),
+            ::pread(fd, in.memory.ptr, in.memory.length, 0));
+  EXPECT_EQ(0, ::memcmp(out.memory.ptr, in.memory.ptr, in.memory.length));
+
+  ::close(fd);
+  ::unlink(name);
+  sut.deallocate(out);
+  sut.deallocate(in);
+}
+
+TEST(IoBufferPoolWithoutRegionTest, ThatTheConstructionFailsIfTheRegionIsMissing)
+{
+  using Pool = alb::io_buffer_pool<4096, 64, 4096, heap_without_region>;
+  EXPECT_THROW(Pool(), std::bad_alloc);
+}
+
+TEST(IoBufferPoolWithSharedHeapTest, ThatTheSharedHeapCanManageTheBuffers)
+{
+  alb::io_buffer_pool<8192, 64, 4096, alb::shared_heap> sut;
+
+  auto b = sut.allocate(100);
+  ASSERT_NE(nullptr, b.memory.ptr);
+  EXPECT_EQ(8192u, b.memory.length);
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(b.memory.ptr) % 4096);
+  EXPECT_EQ(b.memory.ptr, sut.iovecs()[b.index].iov_base);
+  sut.deallocate(b);
+}
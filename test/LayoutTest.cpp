@@ -0,0 +1,178 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/layout.hpp>
+#include <alb/mallocator.hpp>
+#include <alb/stack_allocator.hpp>
+
+#include <utility>
+
+namespace {
+  using Particles = alb::layout<char, double, int>;
+
+  bool isAligned(const void *p, size_t alignment)
+  {
+    return reinterpret_cast<size_t>(p) % alignment == 0;
+  }
+
+  void fill(const Particles &sut)
+  {
+    for (size_t i = 0; i < sut.get<0>().size(); i++) {
+      sut.get<0>()[i] = static_cast<char>('a' + i);
+    }
+    for (size_t i = 0; i < sut.get<1>().size(); i++) {
+      sut.get<1>()[i] = i * 0.5;
+    }
+    for (size_t i = 0; i < sut.get<2>().size(); i++) {
+      sut.get<2>()[i] = static_cast<int>(i * 100);
+    }
+  }
+
+  void expectContent(const Particles &sut, size_t n0, size_t n1, size_t n2)
+  {
+    for (size_t i = 0; i < n0; i++) {
+      EXPECT_EQ(static_cast<char>('a' + i), sut.get<0>()[i]) << "at " << i;
+    }
+    for (size_t i = 0; i < n1; i++) {
+      EXPECT_EQ(i * 0.5, sut.get<1>()[i]) << "at " << i;
+    }
+    for (size_t i = 0; i < n2; i++) {
+      EXPECT_EQ(static_cast<int>(i * 100), sut.get<2>()[i]) << "at " << i;
+    }
+  }
+}
+
+TEST(LayoutTest, ThatAllArraysAreAlignedAndDisjointWithinASingleBlock)
+{
+  alb::mallocator allocator;
+  auto sut = alb::allocate_layout<char, double, int>(allocator, {{3, 5, 7}}, {{0, 64, 0}});
+
+  ASSERT_TRUE(static_cast<bool>(sut.memory()));
+  EXPECT_EQ(3, sut.get<0>().size());
+  EXPECT_EQ(5, sut.get<1>().size());
+  EXPECT_EQ(7, sut.get<2>().size());
+
+  EXPECT_TRUE(isAligned(sut.get<0>().data(), 64));
+  EXPECT_TRUE(isAligned(sut.get<1>().data(), 64));
+  EXPECT_TRUE(isAligned(sut.get<2>().data(), alignof(int)));
+
+  EXPECT_LE(static_cast<void *>(sut.get<0>().end()), static_cast<void *>(sut.get<1>().begin()));
+  EXPECT_LE(static_cast<void *>(sut.get<1>().end()), static_cast<void *>(sut.get<2>().begin()));
+  EXPECT_LE(static_cast<char *>(static_cast<void *>(sut.get<2>().end())),
+            static_cast<char *>(sut.memory().ptr) + sut.memory().length);
+
+  sut.deallocate(allocator);
+  EXPECT_FALSE(sut.memory());
+  EXPECT_TRUE(sut.get<1>().empty());
+}
+
+TEST(LayoutTest, ThatALayoutIsMovedButNotCopied)
+{
+  static_assert(!std::is_copy_constructible<Particles>::value, "A layout must not be copyable!");
+  static_assert(!std::is_copy_assignable<Particles>::value, "A layout must not be copyable!");
+
+  alb::mallocator allocator;
+  auto source = alb::allocate_layout<char, double, int>(allocator, {{3, 5, 7}});
+  const auto memory = source.memory();
+
+  Particles sut(std::move(source));
+  EXPECT_EQ(memory, sut.memory());
+  EXPECT_EQ(5, sut.get<1>().size());
+  EXPECT_FALSE(source.memory());
+  EXPECT_TRUE(source.get<1>().empty());
+
+  source = std::move(sut);
+  EXPECT_EQ(memory, source.memory());
+  EXPECT_FALSE(sut.memory());
+  source.deallocate(allocator);
+}
+
+TEST(LayoutTest, ThatGrowingWithinAnExpandableBlockShiftsTheArraysInPlace)
+{
+  alb::stack_allocator<1024> allocator;
+  Particles sut(Particles::counts_type{{5, 3, 4}}, {{0, 16, 0}});
+  ASSERT_TRUE(sut.allocate(allocator));
+  fill(sut);
+  auto originalPtr = sut.memory().ptr;
+
+  EXPECT_TRUE(sut.expand(allocator, {{20, 10, 30}}));
+
+  EXPECT_EQ(originalPtr, sut.memory().ptr);
+  EXPECT_EQ(20, sut.get<0>().size());
+  EXPECT_EQ(10, sut.get<1>().size());
+  EXPECT_EQ(30, sut.get<2>().size());
+  EXPECT_TRUE(isAligned(sut.get<1>().data(), 16));
+  expectContent(sut, 5, 3, 4);
+
+  sut.deallocate(allocator);
+}
+
+TEST(LayoutTest, ThatExpandFailsWithoutChangesIfTheBlockCannotGrowInPlace)
+{
+  alb::stack_allocator<1024> allocator;
+  Particles sut(Particles::counts_type{{5, 3, 4}});
+  ASSERT_TRUE(sut.allocate(allocator));
+  fill(sut);
+  auto blocker = allocator.allocate(8);
+
+  EXPECT_FALSE(sut.expand(allocator, {{20, 10, 30}}));
+  EXPECT_EQ(5, sut.get<0>().size());
+  expectContent(sut, 5, 3, 4);
+
+  allocator.deallocate(blocker);
+  sut.deallocate(allocator);
+}
+
+TEST(LayoutTest, ThatGrowingWithoutExpandMovesTheContentIntoANewBlock)
+{
+  alb::mallocator allocator;
+  Particles sut(Particles::counts_type{{5, 3, 4}});
+  ASSERT_TRUE(sut.allocate(allocator));
+  fill(sut);
+
+  EXPECT_TRUE(sut.reallocate(allocator, {{500, 300, 400}}));
+
+  EXPECT_EQ(500, sut.get<0>().size());
+  EXPECT_EQ(300, sut.get<1>().size());
+  EXPECT_EQ(400, sut.get<2>().size());
+  expectContent(sut, 5, 3, 4);
+
+  sut.deallocate(allocator);
+}
+
+TEST(LayoutTest, ThatShrinkingKeepsTheBlockAndTheRemainingContent)
+{
+  alb::mallocator allocator;
+  Particles sut(Particles::counts_type{{20, 10, 30}});
+  ASSERT_TRUE(sut.allocate(allocator));
+  fill(sut);
+  auto originalPtr = sut.memory().ptr;
+
+  EXPECT_TRUE(sut.reallocate(allocator, {{2, 10, 5}}));
+
+  EXPECT_EQ(originalPtr, sut.memory().ptr);
+  expectContent(sut, 2, 10, 5);
+
+  sut.deallocate(allocator);
+}
+
+TEST(LayoutTest, ThatARuntimeDescribedLayoutIsAllocatedWithASingleAllocation)
+{
+  alb::mallocator allocator;
+  std::array<alb::layout_item, 2> items{{{4, 32, 10, nullptr}, {8, 8, 3, nullptr}}};
+
+  auto b = alb::allocate_layout(allocator, items);
+
+  ASSERT_TRUE(static_cast<bool>(b));
+  EXPECT_TRUE(isAligned(items[0].ptr, 32));
+  EXPECT_EQ(static_cast<char *>(items[0].ptr) + 40, items[1].ptr);
+
+  allocator.deallocate(b);
+}
@@ -0,0 +1,180 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/lifetime_segregator.hpp>
+#include <alb/allocator_with_stats.hpp>
+#include <alb/heap.hpp>
+#include <alb/mallocator.hpp>
+#include <alb/stack_allocator.hpp>
+
+#include <vector>
+
+class LifetimeSegregatorTest : public ::testing::Test {
+protected:
+  using Region = alb::stack_allocator<1024, 16>;
+  using General = alb::heap<alb::mallocator, 256, 64>;
+
+  // short-lived means freed within 8 allocations, every allocation is sampled
+  alb::lifetime_segregator<Region, General, 8, 1, 16> sut;
+
+  void trainShortLived(size_t n)
+  {
+    for (int i = 0; i < 10; ++i) {
+      auto b = sut.allocate(n);
+      sut.deallocate(b);
+    }
+  }
+};
+
+TEST_F(LifetimeSegregatorTest, ThatUnknownAllocationsGoToTheGeneralAllocator)
+{
+  EXPECT_FALSE(sut.predicts_short_lived(64));
+  auto b = sut.allocate(64);
+  ASSERT_NE(nullptr, b.ptr);
+  EXPECT_EQ(0u, sut.region_blocks());
+  sut.deallocate(b);
+}
+
+TEST_F(LifetimeSegregatorTest, ThatShortLivedAllocationsAreServedAndResetByTheRegion)
+{
+  trainShortLived(64);
+  EXPECT_TRUE(sut.predicts_short_lived(64));
+  const auto resets = sut.region_resets();
+
+  auto a = sut.allocate(64);
+  auto b = sut.allocate(64);
+  EXPECT_EQ(2u, sut.region_blocks());
+  EXPECT_EQ(static_cast<char *>(a.ptr) + 64, b.ptr);
+
+  sut.deallocate(a);
+  sut.deallocate(b);
+  EXPECT_EQ(0u, sut.region_blocks());
+  EXPECT_EQ(resets + 1, sut.region_resets());
+}
+
+TEST_F(LifetimeSegregatorTest, ThatLongLivedAllocationsAreLearned)
+{
+  std::vector<alb::block> blocks;
+  for (int i = 0; i < 20; ++i) {
+    blocks.push_back(sut.allocate(300));
+  }
+  // the time advances with every allocation
+  trainShortLived(64);
+  trainShortLived(64);
+  for (auto &b : blocks) {
+    sut.deallocate(b);
+  }
+  EXPECT_FALSE(sut.predicts_short_lived(300));
+  EXPECT_TRUE(sut.predicts_short_lived(64));
+}
+
+TEST_F(LifetimeSegregatorTest, ThatCallSitesAreLearnedSeparately)
+{
+  for (int i = 0; i < 10; ++i) {
+    auto b = sut.allocate(32, "Parser.cpp", "parse", 1);
+    sut.deallocate(b);
+  }
+  std::vector<alb::block> kept;
+  for (int i = 0; i < 20; ++i) {
+    kept.push_back(sut.allocate(32, "Parser.cpp", "parse", 2));
+  }
+  trainShortLived(64);
+  for (auto &b : kept) {
+    sut.deallocate(b);
+  }
+  EXPECT_TRUE(sut.predicts_short_lived(32, "Parser.cpp", "parse", 1));
+  EXPECT_FALSE(sut.predicts_short_lived(32, "Parser.cpp", "parse", 2));
+  EXPECT_FALSE(sut.predicts_short_lived(32, "Lexer.cpp", "scan", 1));
+  EXPECT_EQ(0u, sut.region_blocks());
+
+  auto b = sut.allocate(32, "Lexer.cpp", "scan", 1);
+  EXPECT_EQ(0u, sut.region_blocks());
+  sut.deallocate(b);
+}
+
+TEST_F(LifetimeSegregatorTest, ThatCallSitesDoNotShareTheClassOfTheirSize)
+{
+  trainShortLived(32);
+  EXPECT_TRUE(sut.predicts_short_lived(32));
+  EXPECT_FALSE(sut.predicts_short_lived(32, "Parser.cpp", "parse", 1));
+
+  // the ALLOCATE macro passes the call site
+  auto b = ALLOCATE(sut, 32);
+  EXPECT_EQ(0u, sut.region_blocks());
+  sut.deallocate(b);
+}
+
+TEST_F(LifetimeSegregatorTest, ThatCallSitesBeyondTheNumberOfClassesAreGroupedBySize)
+{
+  // 16 call sites fill the table
+  for (int line = 1; line <= 16; ++line) {
+    auto b = sut.allocate(32, "Parser.cpp", "parse", line);
+    sut.deallocate(b);
+  }
+  trainShortLived(32);
+  EXPECT_FALSE(sut.predicts_short_lived(32, "Parser.cpp", "parse", 1));
+  EXPECT_TRUE(sut.predicts_short_lived(32, "Parser.cpp", "parse", 17));
+
+  auto b = sut.allocate(32, "Parser.cpp", "parse", 17);
+  EXPECT_EQ(1u, sut.region_blocks());
+  sut.deallocate(b);
+}
+
+TEST_F(LifetimeSegregatorTest, ThatEqualNamesAtDifferentAddressesShareTheirClass)
+{
+  // stand in for the same literal in different translation units
+  const char file[] = "Parser.cpp";
+  const char otherFile[] = "Parser.cpp";
+  ASSERT_NE(static_cast<const void *>(file), static_cast<const void *>(otherFile));
+
+  for (int i = 0; i < 10; ++i) {
+    auto b = sut.allocate(32, file, "parse", 1);
+    sut.deallocate(b);
+  }
+  EXPECT_TRUE(sut.predicts_short_lived(32, otherFile, "parse", 1));
+
+  auto b = sut.allocate(32, otherFile, "parse", 1);
+  EXPECT_EQ(1u, sut.region_blocks());
+  sut.deallocate(b);
+}
+
+TEST_F(LifetimeSegregatorTest, ThatAMispredictedBlockDoesNotBlockFurtherAllocations)
+{
+  trainShortLived(64);
+  auto longLived = sut.allocate(64);
+  EXPECT_EQ(1u, sut.region_blocks());
+
+  // the region cannot be reset while the long-lived block exists
+  std::vector<alb::block> blocks;
+  for (int i = 0; i < 30; ++i) {
+    blocks.push_back(sut.allocate(64));
+    ASSERT_NE(nullptr, blocks.back().ptr);
+  }
+  EXPECT_EQ(16u, sut.region_blocks());
+  for (auto &b : blocks) {
+    sut.deallocate(b);
+  }
+  sut.deallocate(longLived);
+  EXPECT_EQ(0u, sut.region_blocks());
+}
+
+TEST_F(LifetimeSegregatorTest, ThatAGrowingRegionBlockIsMovedToTheGeneralAllocator)
+{
+  trainShortLived(64);
+  auto b = sut.allocate(64);
+  ::memset(b.ptr, 'x', 64);
+  EXPECT_EQ(1u, sut.region_blocks());
+
+  ASSERT_TRUE(sut.reallocate(b, 128));
+  EXPECT_EQ(0u, sut.region_blocks());
+  EXPECT_EQ('x', static_cast<char *>(b.ptr)[63]);
+  EXPECT_TRUE(sut.owns(b));
+  sut.deallocate(b);
+}
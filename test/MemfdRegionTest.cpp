@@ -0,0 +1,128 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/memfd_region.hpp>
+
+#include <cstring>
+#include <string>
+#include <thread>
+
+class MemfdRegionTest : public ::testing::Test {
+protected:
+  alb::memfd_region<1024 * 1024> sut;
+};
+
+TEST_F(MemfdRegionTest, ThatItAllocatesLikeAStack)
+{
+  auto a = sut.allocate(10);
+  auto b = sut.allocate(100);
+  ASSERT_NE(nullptr, a.ptr);
+  ASSERT_NE(nullptr, b.ptr);
+  EXPECT_EQ(16u, a.length);
+  EXPECT_EQ(static_cast<char *>(a.ptr) + 16, b.ptr);
+  EXPECT_TRUE(sut.owns(b));
+
+  EXPECT_TRUE(sut.expand(b, 10));
+  EXPECT_EQ(128u, b.length);
+  sut.deallocate(b);
+  auto c = sut.allocate(1);
+  EXPECT_EQ(static_cast<char *>(a.ptr) + 16, c.ptr);
+
+  EXPECT_FALSE(sut.allocate(2 * 1024 * 1024));
+}
+
+TEST_F(MemfdRegionTest, ThatTheSnapshotStaysFrozenWhileTheRegionIsModified)
+{
+  auto b = sut.allocate(8192);
+  ::memset(b.ptr, 'a', b.length);
+
+  auto snapshot = sut.take_snapshot();
+  ASSERT_TRUE(static_cast<bool>(snapshot));
+  EXPECT_TRUE(sut.has_snapshot());
+  EXPECT_EQ(8192u, snapshot.size());
+
+  ::memset(b.ptr, 'b', 100);
+  auto later = sut.allocate(16);
+  ::memcpy(later.ptr, "after", 6);
+
+  auto image = snapshot.at(b);
+  ASSERT_NE(nullptr, image.ptr);
+  EXPECT_NE(b.ptr, image.ptr);
+  EXPECT_EQ(std::string(8192, 'a'), std::string(static_cast<char *>(image.ptr), image.length));
+  EXPECT_EQ('b', static_cast<char *>(b.ptr)[0]);
+  EXPECT_FALSE(snapshot.at(later));
+}
+
+TEST_F(MemfdRegionTest, ThatModificationsSurviveTheReleaseOfTheSnapshot)
+{
+  auto b = sut.allocate(3 * 4096);
+  ::memset(b.ptr, 'a', b.length);
+  {
+    auto snapshot = sut.take_snapshot();
+    ASSERT_TRUE(static_cast<bool>(snapshot));
+    static_cast<char *>(b.ptr)[4096] = 'x';
+  }
+  EXPECT_FALSE(sut.has_snapshot());
+  EXPECT_EQ('x', static_cast<char *>(b.ptr)[4096]);
+  EXPECT_EQ('a', static_cast<char *>(b.ptr)[0]);
+
+  auto next = sut.take_snapshot();
+  ASSERT_TRUE(static_cast<bool>(next));
+  char c = 0;
+  EXPECT_TRUE(next.read(4096, &c, 1));
+  EXPECT_EQ('x', c);
+  EXPECT_FALSE(next.read(3 * 4096, &c, 1));
+}
+
+TEST_F(MemfdRegionTest, ThatOnlyOneSnapshotExistsAtATime)
+{
+  auto b = sut.allocate(64);
+  ::memset(b.ptr, 'a', b.length);
+
+  auto first = sut.take_snapshot();
+  auto second = sut.take_snapshot();
+  EXPECT_TRUE(static_cast<bool>(first));
+  EXPECT_FALSE(second);
+
+  EXPECT_TRUE(first.reset());
+  EXPECT_FALSE(static_cast<bool>(first));
+  EXPECT_FALSE(sut.is_lost());
+  EXPECT_TRUE(first.reset());
+  auto third = sut.take_snapshot();
+  EXPECT_TRUE(static_cast<bool>(third));
+}
+
+TEST_F(MemfdRegionTest, ThatTheSnapshotCanBeIteratedConcurrently)
+{
+  auto b = sut.allocate(10000);
+  ::memset(b.ptr, 'a', b.length);
+
+  auto snapshot = sut.take_snapshot();
+  ASSERT_TRUE(static_cast<bool>(snapshot));
+
+  size_t chunks = 0;
+  size_t bytes = 0;
+  bool frozen = true;
+  std::thread persister([&] {
+    snapshot.for_each_chunk(4096, [&](const alb::block &chunk) {
+      ++chunks;
+      bytes += chunk.length;
+      frozen &= std::string(static_cast<char *>(chunk.ptr), chunk.length) ==
+                std::string(chunk.length, 'a');
+      return true;
+    });
+  });
+  ::memset(b.ptr, 'b', b.length);
+  persister.join();
+
+  EXPECT_EQ(3u, chunks);
+  EXPECT_EQ(10000u, bytes);
+  EXPECT_TRUE(frozen);
+}
@@ -0,0 +1,111 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/padded_allocator.hpp>
+#include <alb/aligned_mallocator.hpp>
+#include <alb/heap.hpp>
+#include <alb/mallocator.hpp>
+#include <alb/stack_allocator.hpp>
+#include "TestHelpers/AllocatorBaseTest.h"
+#include "TestHelpers/Base.h"
+
+#include <cstring>
+
+using namespace alb::test_helpers;
+
+namespace {
+  bool isAligned(const void *p, size_t alignment)
+  {
+    return reinterpret_cast<size_t>(p) % alignment == 0;
+  }
+}
+
+template <class T> class PaddedAllocatorTest : public AllocatorBaseTest<T> {
+};
+
+using TypesForPaddedAllocatorTest =
+    ::testing::Types<alb::padded_allocator<alb::mallocator, 64, 64>,
+                     alb::padded_allocator<alb::aligned_mallocator<64>, 64, 64>,
+                     alb::padded_allocator<alb::mallocator, 32, 31>,
+                     alb::padded_allocator<alb::heap<alb::mallocator, 256, 16>, 64, 64>>;
+
+TYPED_TEST_CASE(PaddedAllocatorTest, TypesForPaddedAllocatorTest);
+
+TYPED_TEST(PaddedAllocatorTest, ThatAllocatingZeroBytesReturnsAnEmptyBlock)
+{
+  auto mem = this->sut.allocate(0);
+  EXPECT_FALSE(mem);
+}
+
+TYPED_TEST(PaddedAllocatorTest, ThatEachBlockIsAlignedAndFollowedByReadablePadding)
+{
+  for (size_t n = 1; n < 200; n += 7) {
+    auto mem = this->sut.allocate(n);
+    ASSERT_NE(nullptr, mem.ptr);
+    EXPECT_TRUE(isAligned(mem.ptr, TypeParam::alignment));
+    EXPECT_LE(n, mem.length);
+
+    // the whole usable length and the padding must be accessible
+    ::memset(mem.ptr, 0x5a, mem.length + TypeParam::padding);
+
+    this->deallocateAndCheckBlockIsThenEmpty(mem);
+  }
+}
+
+TYPED_TEST(PaddedAllocatorTest, ThatAReallocationKeepsTheContentAndTheAlignment)
+{
+  auto mem = this->sut.allocate(40);
+  for (size_t i = 0; i < 40; i++) {
+    static_cast<unsigned char *>(mem.ptr)[i] = static_cast<unsigned char>(i);
+  }
+
+  EXPECT_TRUE(this->sut.reallocate(mem, 300));
+  EXPECT_TRUE(isAligned(mem.ptr, TypeParam::alignment));
+  EXPECT_LE(300u, mem.length);
+  for (size_t i = 0; i < 40; i++) {
+    EXPECT_EQ(i, static_cast<unsigned char *>(mem.ptr)[i]) << "at " << i;
+  }
+
+  this->deallocateAndCheckBlockIsThenEmpty(mem);
+}
+
+TEST(PaddedAllocatorWithAlignedParentTest, ThatNoRealignmentOverheadIsAllocated)
+{
+  alb::padded_allocator<alb::aligned_mallocator<64>, 64, 64> sut;
+  auto mem = sut.allocate(100);
+  EXPECT_EQ(100, mem.length);
+  sut.deallocate(mem);
+}
+
+TEST(PaddedAllocatorWithAlignedParentTest, ThatThePaddingIsTakenFromTheRoundingSlack)
+{
+  alb::padded_allocator<alb::stack_allocator<4096, 64>, 64, 32> sut;
+  auto a = sut.allocate(10);
+  auto b = sut.allocate(10);
+  EXPECT_EQ(static_cast<char *>(a.ptr) + 64, b.ptr);
+  EXPECT_EQ(32u, a.length);
+  sut.deallocate(b);
+  sut.deallocate(a);
+}
+
+TEST(PaddedAllocatorWithHeapTest, ThatTheRoundingOfTheHeapIsReportedAsUsableLength)
+{
+  alb::padded_allocator<alb::heap<alb::mallocator, 256, 16>, 64, 64> sut;
+  auto mem = sut.allocate(1);
+  EXPECT_EQ(0, (mem.length + 64 + reinterpret_cast<size_t>(mem.ptr)) % 16);
+  EXPECT_TRUE(sut.owns(mem));
+
+  auto oldLength = mem.length;
+  EXPECT_TRUE(sut.expand(mem, 16));
+  EXPECT_EQ(oldLength + 16, mem.length);
+  EXPECT_TRUE(isAligned(mem.ptr, 64));
+
+  sut.deallocate(mem);
+}
@@ -0,0 +1,153 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/purgeable_allocator.hpp>
+#include <alb/mallocator.hpp>
+
+#include <vector>
+
+namespace {
+  void collectEvicted(void *context, const alb::block &b)
+  {
+    static_cast<std::vector<void *> *>(context)->push_back(b.ptr);
+  }
+}
+
+class PurgeableAllocatorTest : public ::testing::Test {
+protected:
+  alb::purgeable_allocator<alb::mallocator, 256, 8> sut;
+  std::vector<void *> evicted;
+
+  alb::block allocate(size_t n, unsigned cost = 1)
+  {
+    return sut.allocate(n, &collectEvicted, &evicted, cost);
+  }
+};
+
+TEST_F(PurgeableAllocatorTest, ThatBlocksWithinTheBudgetAreNotEvicted)
+{
+  auto a = allocate(64);
+  auto b = allocate(64);
+  ASSERT_NE(nullptr, a.ptr);
+  ASSERT_NE(nullptr, b.ptr);
+  EXPECT_EQ(128u, sut.used());
+  EXPECT_EQ(2u, sut.blocks());
+  EXPECT_TRUE(evicted.empty());
+
+  sut.deallocate(a);
+  EXPECT_EQ(nullptr, a.ptr);
+  EXPECT_EQ(64u, sut.used());
+  EXPECT_TRUE(evicted.empty());
+}
+
+TEST_F(PurgeableAllocatorTest, ThatTheBudgetPressureEvictsBlocksInClockOrder)
+{
+  auto a = allocate(64);
+  auto b = allocate(64);
+  auto c = allocate(64);
+  auto d = allocate(64);
+
+  // the first round of the hand takes the credit of all blocks
+  ASSERT_NE(nullptr, allocate(64).ptr);
+  ASSERT_EQ(1u, evicted.size());
+  EXPECT_EQ(a.ptr, evicted[0]);
+
+  EXPECT_TRUE(sut.touch(c));
+  ASSERT_NE(nullptr, allocate(64).ptr);
+  ASSERT_NE(nullptr, allocate(64).ptr);
+  ASSERT_EQ(3u, evicted.size());
+  EXPECT_EQ(b.ptr, evicted[1]);
+  EXPECT_EQ(d.ptr, evicted[2]);
+  EXPECT_TRUE(sut.touch(c));
+  EXPECT_EQ(256u, sut.used());
+  EXPECT_EQ(3u, sut.evictions());
+}
+
+TEST_F(PurgeableAllocatorTest, ThatPinnedBlocksAreNotEvicted)
+{
+  auto a = allocate(128);
+  auto b = allocate(128);
+  sut.pin(a);
+  sut.pin(b);
+
+  auto c = allocate(64);
+  EXPECT_EQ(nullptr, c.ptr);
+  EXPECT_TRUE(evicted.empty());
+
+  sut.unpin(b);
+  c = allocate(64);
+  ASSERT_NE(nullptr, c.ptr);
+  ASSERT_EQ(1u, evicted.size());
+  EXPECT_EQ(b.ptr, evicted[0]);
+  sut.unpin(a);
+}
+
+TEST_F(PurgeableAllocatorTest, ThatExpensiveBlocksSurviveLonger)
+{
+  auto expensive = allocate(64, 4);
+  auto cheap = allocate(64);
+
+  EXPECT_EQ(64u, sut.trim(64));
+  ASSERT_EQ(1u, evicted.size());
+  EXPECT_EQ(cheap.ptr, evicted[0]);
+  EXPECT_TRUE(sut.touch(expensive));
+}
+
+TEST_F(PurgeableAllocatorTest, ThatTrimEvictsAllUnpinnedBlocks)
+{
+  allocate(64);
+  auto pinned = allocate(64);
+  allocate(64);
+  sut.pin(pinned);
+  auto permanent = sut.allocate(32);
+  ASSERT_NE(nullptr, permanent.ptr);
+
+  EXPECT_EQ(128u, sut.trim());
+  EXPECT_EQ(2u, evicted.size());
+  EXPECT_EQ(96u, sut.used());
+  sut.unpin(pinned);
+  sut.deallocate(permanent);
+}
+
+TEST_F(PurgeableAllocatorTest, ThatALowerBudgetEvictsBlocks)
+{
+  for (int i = 0; i < 4; ++i) {
+    allocate(64);
+  }
+  sut.set_budget(128);
+  EXPECT_EQ(128u, sut.budget());
+  EXPECT_EQ(128u, sut.used());
+  EXPECT_EQ(2u, evicted.size());
+  EXPECT_EQ(nullptr, allocate(200).ptr);
+}
+
+TEST_F(PurgeableAllocatorTest, ThatTheNumberOfBlocksIsLimited)
+{
+  for (int i = 0; i < 9; ++i) {
+    ASSERT_NE(nullptr, allocate(8).ptr);
+  }
+  EXPECT_EQ(8u, sut.blocks());
+  EXPECT_EQ(1u, evicted.size());
+}
+
+TEST_F(PurgeableAllocatorTest, ThatAReallocatedBlockKeepsItsCallback)
+{
+  auto a = allocate(64);
+  auto b = allocate(64);
+  sut.touch(a);
+  ASSERT_TRUE(sut.reallocate(a, 224));
+  EXPECT_EQ(224u, a.length);
+  ASSERT_EQ(1u, evicted.size());
+  EXPECT_EQ(b.ptr, evicted[0]);
+
+  EXPECT_EQ(224u, sut.trim());
+  ASSERT_EQ(2u, evicted.size());
+  EXPECT_EQ(a.ptr, evicted[1]);
+}
@@ -0,0 +1,235 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/segmented_deque.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+  struct Order {
+    static int alive;
+
+    int id;
+    std::string owner;
+
+    Order(int i, std::string o)
+      : id(i)
+      , owner(std::move(o))
+    {
+      ++alive;
+    }
+
+    Order(const Order &x)
+      : id(x.id)
+      , owner(x.owner)
+    {
+      ++alive;
+    }
+
+    ~Order()
+    {
+      --alive;
+    }
+  };
+
+  int Order::alive = 0;
+}
+
+class SegmentedDequeTest : public ::testing::Test {
+protected:
+  using Pool = alb::segment_pool_for<int, 8>;
+  using Deque = alb::segmented_deque<int, 8, Pool>;
+
+  Pool pool;
+};
+
+TEST_F(SegmentedDequeTest, ThatPushAtBothEndsKeepsTheOrder)
+{
+  Deque sut(pool);
+  for (int i = 0; i < 20; ++i) {
+    sut.push_back(i);
+  }
+  for (int i = 1; i <= 20; ++i) {
+    sut.push_front(-i);
+  }
+  ASSERT_EQ(40u, sut.size());
+  for (int i = 0; i < 40; ++i) {
+    EXPECT_EQ(i - 20, sut[i]);
+  }
+  EXPECT_EQ(-20, sut.front());
+  EXPECT_EQ(19, sut.back());
+  EXPECT_TRUE(std::is_sorted(sut.begin(), sut.end()));
+  EXPECT_EQ(-20, std::accumulate(sut.begin(), sut.end(), 0));
+}
+
+TEST_F(SegmentedDequeTest, ThatTheAddressesOfTheElementsNeverMove)
+{
+  Deque sut(pool);
+  sut.push_back(0);
+  const int *first = &sut[0];
+  std::vector<const int *> addresses;
+  for (int i = 1; i < 1000; ++i) {
+    sut.push_back(i);
+    sut.push_front(-i);
+    addresses.push_back(&sut.back());
+  }
+  EXPECT_EQ(first, &sut[999]);
+  EXPECT_EQ(0, *first);
+  for (int i = 1; i < 1000; ++i) {
+    EXPECT_EQ(addresses[i - 1], &sut[999 + i]);
+  }
+}
+
+TEST_F(SegmentedDequeTest, ThatSegmentsAreTakenFromThePoolAndGivenBackWhenEmpty)
+{
+  Deque sut(pool);
+  for (int i = 0; i < 17; ++i) {
+    sut.push_back(i);
+  }
+  EXPECT_EQ(3u, sut.segments());
+  sut.pop_back();
+  EXPECT_EQ(2u, sut.segments());
+  for (int i = 0; i < 8; ++i) {
+    sut.pop_front();
+  }
+  EXPECT_EQ(1u, sut.segments());
+  EXPECT_EQ(8, sut.front());
+
+  // the given back segment is reused by the pool
+  auto b = pool.allocate(8 * sizeof(int));
+  ASSERT_NE(nullptr, b.ptr);
+  pool.deallocate(b);
+}
+
+TEST_F(SegmentedDequeTest, ThatDrainingFromTheMiddleOfASegmentGivesBackTheLastOne)
+{
+  Deque sut(pool);
+  for (int i = 0; i < 12; ++i) {
+    sut.push_back(i);
+  }
+  // the front is now in the middle of the second segment
+  for (int i = 0; i < 10; ++i) {
+    sut.pop_front();
+  }
+  EXPECT_EQ(1u, sut.segments());
+  sut.pop_back();
+  sut.pop_front();
+  EXPECT_TRUE(sut.empty());
+  EXPECT_EQ(0u, sut.segments());
+
+  sut.push_front(1);
+  sut.push_back(2);
+  EXPECT_EQ(1, sut.front());
+  EXPECT_EQ(2, sut.back());
+}
+
+TEST_F(SegmentedDequeTest, ThatAQueueWorkloadCirculatesThroughTheIndex)
+{
+  Deque sut(pool);
+  int next = 0;
+  int expected = 0;
+  for (int round = 0; round < 1000; ++round) {
+    for (int i = 0; i < 5; ++i) {
+      sut.push_back(next++);
+    }
+    for (int i = 0; i < 4; ++i) {
+      EXPECT_EQ(expected++, sut.front());
+      sut.pop_front();
+    }
+  }
+  EXPECT_EQ(1000u, sut.size());
+  EXPECT_EQ(expected, sut.front());
+  EXPECT_EQ(next - 1, sut.back());
+  EXPECT_LE(sut.segments(), 1000u / 8 + 2);
+}
+
+TEST_F(SegmentedDequeTest, ThatClearGivesBackAllSegments)
+{
+  Deque sut(pool);
+  for (int i = 0; i < 100; ++i) {
+    sut.push_front(i);
+  }
+  sut.clear();
+  EXPECT_TRUE(sut.empty());
+  EXPECT_EQ(0u, sut.segments());
+  sut.push_back(42);
+  EXPECT_EQ(42, sut.front());
+}
+
+TEST_F(SegmentedDequeTest, ThatRandomAccessIsChecked)
+{
+  Deque sut(pool);
+  sut.push_back(1);
+  EXPECT_EQ(1, sut.at(0));
+  EXPECT_THROW(sut.at(1), std::out_of_range);
+}
+
+TEST_F(SegmentedDequeTest, ThatEachSegmentIsVisitedAsContiguousRange)
+{
+  Deque sut(pool);
+  for (int i = 0; i < 20; ++i) {
+    sut.push_back(i);
+  }
+  sut.pop_front();
+  sut.pop_front();
+
+  std::vector<size_t> counts;
+  int expected = 2;
+  sut.for_each_segment([&](const int *first, size_t count) {
+    counts.push_back(count);
+    for (size_t i = 0; i < count; ++i) {
+      EXPECT_EQ(expected++, first[i]);
+    }
+  });
+  EXPECT_EQ((std::vector<size_t>{6, 8, 4}), counts);
+}
+
+TEST_F(SegmentedDequeTest, ThatCopiesAndMovesPreserveTheElements)
+{
+  Deque sut(pool);
+  for (int i = 0; i < 30; ++i) {
+    sut.push_back(i);
+  }
+  Deque copy(sut);
+  EXPECT_TRUE(std::equal(sut.begin(), sut.end(), copy.begin()));
+  EXPECT_NE(&sut[0], &copy[0]);
+
+  const int *address = &sut[10];
+  Deque moved(std::move(sut));
+  EXPECT_EQ(address, &moved[10]);
+  EXPECT_TRUE(sut.empty());
+
+  sut = copy;
+  EXPECT_EQ(30u, sut.size());
+  EXPECT_EQ(29, sut.back());
+}
+
+TEST_F(SegmentedDequeTest, ThatNonTrivialElementsAreConstructedAndDestroyed)
+{
+  alb::segment_pool_for<Order, 4> orders;
+  {
+    alb::segmented_deque<Order, 4, alb::segment_pool_for<Order, 4>> sut(orders);
+    for (int i = 0; i < 10; ++i) {
+      sut.emplace_back(i, "owner of a long string " + std::to_string(i));
+    }
+    sut.emplace_front(-1, "first");
+    EXPECT_EQ(11, Order::alive);
+    sut.pop_back();
+    EXPECT_EQ(10, Order::alive);
+    EXPECT_EQ("first", sut.front().owner);
+    EXPECT_EQ(8, (sut.end() - 1)->id);
+  }
+  EXPECT_EQ(0, Order::alive);
+}
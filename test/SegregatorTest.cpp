@@ -9,6 +9,7 @@
 //////////////////////////////////////////////////////////////////
 #include <gtest/gtest.h>
 #include <alb/segregator.hpp>
+#include <alb/aligned_mallocator.hpp>
 #include <alb/stack_allocator.hpp>
 #include <alb/shared_heap.hpp>
 #include <alb/mallocator.hpp>
@@ -18,6 +19,25 @@
 
 namespace {
   const size_t LargeBlockSize = 64;
+
+  /**
+   * Mallocators without expand, that own the blocks up to, resp. beyond 32 bytes
+   */
+  class SmallOwningMallocator : public alb::mallocator {
+  public:
+    bool owns(const alb::block &b) const
+    {
+      return b && b.length <= 32;
+    }
+  };
+
+  class LargeOwningMallocator : public alb::mallocator {
+  public:
+    bool owns(const alb::block &b) const
+    {
+      return b && 32 < b.length && b.length <= 64;
+    }
+  };
 }
 
 class SegregatorTest
@@ -118,3 +138,38 @@ TEST_F(SegregatorTest, ThatReallocatingALargeBlockToASmallerSizeGoesToTheSmallAl
   EXPECT_EQ(4, mem.length);
   EXPECT_EQ(StartSmallAllocatorPtr, mem.ptr);
 }
+
+TEST(SegregatorWithoutExpandTest, ThatAllocatorsWithoutExpandCanBeSegregated)
+{
+  using Sut = alb::segregator<32, alb::mallocator, alb::aligned_mallocator<>>;
+  static_assert(!alb::traits::has_expand<Sut>::value, "Neither allocator implements expand");
+  static_assert(!alb::traits::has_owns<Sut>::value, "Neither allocator implements owns");
+
+  Sut sut;
+  auto mem = sut.allocate(8);
+  ASSERT_NE(nullptr, mem.ptr);
+  alb::test_helpers::fillBlockWithReferenceData<int>(mem);
+
+  EXPECT_TRUE(sut.reallocate(mem, 64));
+  EXPECT_EQ(64, mem.length);
+  alb::test_helpers::EXPECT_MEM_EQ(mem.ptr, (void *)alb::test_helpers::ReferenceData.data(), 8);
+
+  sut.deallocate(mem);
+  EXPECT_EQ(nullptr, mem.ptr);
+}
+
+TEST(SegregatorWithoutExpandTest, ThatOwnsIsAvailableIfBothAllocatorsImplementIt)
+{
+  using Sut = alb::segregator<32, SmallOwningMallocator, LargeOwningMallocator>;
+  static_assert(!alb::traits::has_expand<Sut>::value, "Neither allocator implements expand");
+  static_assert(alb::traits::has_owns<Sut>::value, "Both allocators implement owns");
+
+  Sut sut;
+  auto small = sut.allocate(16);
+  auto large = sut.allocate(48);
+  EXPECT_TRUE(sut.owns(small));
+  EXPECT_TRUE(sut.owns(large));
+  EXPECT_FALSE(sut.owns({large.ptr, 128}));
+  sut.deallocate(small);
+  sut.deallocate(large);
+}
@@ -0,0 +1,108 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/shared_block.hpp>
+#include "TestHelpers/Base.h"
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace alb::test_helpers;
+
+class SharedBlockTest : public ::testing::Test {
+protected:
+  using Allocator = alb::shared_block_allocator<TestMallocator>;
+  Allocator sut;
+};
+
+TEST_F(SharedBlockTest, ThatAllocatedBlocksAreAlignedAndUniquelyOwned)
+{
+  auto b = sut.allocate(100);
+  ASSERT_NE(nullptr, b.ptr());
+  EXPECT_EQ(100u, b.length());
+  EXPECT_EQ(1u, b.use_count());
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(b.ptr()) % alignof(std::max_align_t));
+  EXPECT_TRUE(sut.owns(b));
+}
+
+TEST_F(SharedBlockTest, ThatAZeroSizedRequestReturnsAnEmptyBlock)
+{
+  auto b = sut.allocate(0);
+  EXPECT_FALSE(b);
+  EXPECT_EQ(0u, b.use_count());
+}
+
+TEST_F(SharedBlockTest, ThatTheLastOwnerReturnsTheMemory)
+{
+  const auto initiallyAllocated = TestMallocator::currentlyAllocatedBytes();
+  {
+    auto b = sut.allocate(64);
+    auto copy = b;
+    EXPECT_EQ(2u, b.use_count());
+    EXPECT_EQ(b.ptr(), copy.ptr());
+
+    b.reset();
+    EXPECT_FALSE(b);
+    EXPECT_EQ(1u, copy.use_count());
+    EXPECT_LT(initiallyAllocated, TestMallocator::currentlyAllocatedBytes());
+  }
+  EXPECT_EQ(initiallyAllocated, TestMallocator::currentlyAllocatedBytes());
+}
+
+TEST_F(SharedBlockTest, ThatSlicesShareTheOwnershipWithoutCopying)
+{
+  const auto initiallyAllocated = TestMallocator::currentlyAllocatedBytes();
+  alb::shared_block<TestMallocator> header;
+  alb::shared_block<TestMallocator> body;
+  {
+    auto message = sut.allocate(32);
+    ::memcpy(message.ptr(), "HEADERbody of the message", 26);
+    header = message.slice(0, 6);
+    body = message.slice(6, 1000);
+    EXPECT_EQ(3u, message.use_count());
+  }
+  EXPECT_EQ(2u, body.use_count());
+  EXPECT_EQ(0, ::memcmp("HEADER", header.ptr(), header.length()));
+  EXPECT_EQ(26u, body.length());
+  EXPECT_EQ(static_cast<char *>(header.ptr()) + 6, body.ptr());
+
+  auto word = body.slice(8, 3);
+  EXPECT_EQ(0, ::memcmp("the", word.ptr(), word.length()));
+  EXPECT_FALSE(body.slice(27, 1));
+
+  header.reset();
+  body.reset();
+  EXPECT_LT(initiallyAllocated, TestMallocator::currentlyAllocatedBytes());
+  word.reset();
+  EXPECT_EQ(initiallyAllocated, TestMallocator::currentlyAllocatedBytes());
+}
+
+TEST_F(SharedBlockTest, ThatBlocksCanBeReleasedConcurrently)
+{
+  const auto initiallyAllocated = TestMallocator::currentlyAllocatedBytes();
+  {
+    auto payload = sut.allocate(256);
+    std::vector<std::thread> consumers;
+    for (int i = 0; i < 4; ++i) {
+      consumers.emplace_back([payload] {
+        for (int j = 0; j < 10000; ++j) {
+          auto part = payload.slice(j % 256, 1);
+          auto copy = part;
+        }
+      });
+    }
+    for (auto &t : consumers) {
+      t.join();
+    }
+    EXPECT_EQ(1u, payload.use_count());
+  }
+  EXPECT_EQ(initiallyAllocated, TestMallocator::currentlyAllocatedBytes());
+}
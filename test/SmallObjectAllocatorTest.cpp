@@ -0,0 +1,125 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/small_object_allocator.hpp>
+#include <alb/bucketizer.hpp>
+#include <alb/mallocator.hpp>
+#include "TestHelpers/AllocatorBaseTest.h"
+#include "TestHelpers/Base.h"
+
+#include <vector>
+
+using namespace alb::test_helpers;
+
+class SmallObjectAllocatorTest
+    : public AllocatorBaseTest<alb::small_object_allocator<TestMallocator, 1, 4, 16>> {
+};
+
+TEST_F(SmallObjectAllocatorTest, ThatAllocatingZeroBytesReturnsAnEmptyBlock)
+{
+  auto mem = sut.allocate(0);
+  EXPECT_FALSE(mem);
+  EXPECT_EQ(nullptr, mem.ptr);
+}
+
+TEST_F(SmallObjectAllocatorTest, ThatAllocationsBeyondTheUpperBoundAreRejected)
+{
+  auto mem = sut.allocate(5);
+  EXPECT_FALSE(mem);
+}
+
+TEST_F(SmallObjectAllocatorTest, ThatAnAllocationReturnsABlockOfTheUpperBound)
+{
+  auto mem = sut.allocate(1);
+  EXPECT_NE(nullptr, mem.ptr);
+  EXPECT_EQ(4, mem.length);
+  EXPECT_TRUE(sut.owns(mem));
+
+  deallocateAndCheckBlockIsThenEmpty(mem);
+}
+
+TEST_F(SmallObjectAllocatorTest, ThatAllBlocksOfAChunkAreContiguousWithoutAnyOverhead)
+{
+  alb::block blocks[16];
+  for (auto &b : blocks) {
+    b = sut.allocate(4);
+  }
+  for (size_t i = 0; i < 15; i++) {
+    EXPECT_EQ(static_cast<char *>(blocks[i].ptr) + 4, blocks[i + 1].ptr);
+  }
+  auto fromNextChunk = sut.allocate(4);
+  EXPECT_NE(static_cast<char *>(blocks[15].ptr) + 4, fromNextChunk.ptr);
+
+  deallocateAndCheckBlockIsThenEmpty(fromNextChunk);
+  for (auto &b : blocks) {
+    deallocateAndCheckBlockIsThenEmpty(b);
+  }
+}
+
+TEST_F(SmallObjectAllocatorTest, ThatTheLastFreedBlockIsReusedFirst)
+{
+  auto mem1 = sut.allocate(3);
+  auto mem2 = sut.allocate(3);
+  auto oldPtr1 = mem1.ptr;
+
+  deallocateAndCheckBlockIsThenEmpty(mem1);
+  mem1 = sut.allocate(2);
+  EXPECT_EQ(oldPtr1, mem1.ptr);
+
+  deallocateAndCheckBlockIsThenEmpty(mem1);
+  deallocateAndCheckBlockIsThenEmpty(mem2);
+}
+
+TEST_F(SmallObjectAllocatorTest, ThatNewChunksAreCreatedAndUnusedOnesAreReturnedToTheParent)
+{
+  const auto initiallyAllocated = TestMallocator::currentlyAllocatedBytes();
+  std::vector<alb::block> blocks(100);
+  for (auto &b : blocks) {
+    b = sut.allocate(4);
+    ASSERT_NE(nullptr, b.ptr);
+    *static_cast<char *>(b.ptr) = 42;
+  }
+  for (auto &b : blocks) {
+    EXPECT_TRUE(sut.owns(b));
+    deallocateAndCheckBlockIsThenEmpty(b);
+  }
+  // the chunk array and one empty chunk are kept
+  EXPECT_GE(initiallyAllocated + 8 * 16 * 4, TestMallocator::currentlyAllocatedBytes());
+
+  sut.deallocateAll();
+  EXPECT_FALSE(sut.owns(alb::block(blocks[0].ptr, 4)));
+}
+
+TEST_F(SmallObjectAllocatorTest, ThatForeignBlocksAreNotRecognizedAsOwned)
+{
+  char foreign[4];
+  EXPECT_FALSE(sut.owns(alb::block()));
+  EXPECT_FALSE(sut.owns(alb::block(foreign, 4)));
+
+  auto mem = sut.allocate(4);
+  EXPECT_FALSE(sut.owns(alb::block(foreign, 4)));
+  deallocateAndCheckBlockIsThenEmpty(mem);
+}
+
+TEST(SmallObjectAllocatorWithBucketizerTest, ThatEachSizeCostsExactlyItsSize)
+{
+  using SmallObjects = alb::small_object_allocator<alb::mallocator, alb::internal::DynasticDynamicSet,
+                                                   alb::internal::DynasticDynamicSet>;
+  alb::bucketizer<SmallObjects, 1, 8, 1> sut;
+
+  for (size_t n = 1; n <= 8; n++) {
+    auto mem1 = sut.allocate(n);
+    auto mem2 = sut.allocate(n);
+    EXPECT_EQ(n, mem1.length);
+    EXPECT_EQ(static_cast<char *>(mem1.ptr) + n, mem2.ptr);
+    sut.deallocate(mem2);
+    sut.deallocate(mem1);
+  }
+}
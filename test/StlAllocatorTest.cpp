@@ -0,0 +1,56 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/affix_allocator.hpp>
+#include <alb/global_allocator.hpp>
+#include <alb/mallocator.hpp>
+#include <alb/stl_allocator.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+
+namespace {
+  using Global = alb::global_allocator<alb::affix_allocator<alb::mallocator, alb::length_prefix>>;
+
+  bool isAligned(const void *p)
+  {
+    return reinterpret_cast<uintptr_t>(p) % alignof(std::max_align_t) == 0;
+  }
+}
+
+TEST(StlAllocatorTest, ThatTheLengthPrefixKeepsTheAlignmentOfOperatorNew)
+{
+  EXPECT_EQ(0u, sizeof(alb::length_prefix) % alignof(std::max_align_t));
+}
+
+TEST(StlAllocatorTest, ThatAllocatedArraysAreAlignedAsByOperatorNew)
+{
+  alb::stl_allocator<long double, Global> sut;
+  for (size_t n = 1; n < 8; ++n) {
+    auto p = sut.allocate(n);
+    EXPECT_TRUE(isAligned(p)) << n;
+    sut.deallocate(p, n);
+  }
+}
+
+TEST(StlAllocatorTest, ThatNodesOfAContainerAreAlignedAsByOperatorNew)
+{
+  using String = std::basic_string<char, std::char_traits<char>, alb::stl_allocator<char, Global>>;
+  std::list<String, alb::stl_allocator<String, Global>> sut;
+  for (int i = 0; i < 16; ++i) {
+    sut.emplace_back(static_cast<size_t>(32 + i), 'x');
+  }
+  for (auto &s : sut) {
+    EXPECT_TRUE(isAligned(&s));
+    EXPECT_TRUE(isAligned(s.data()));
+  }
+}
@@ -0,0 +1,105 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/string_interner.hpp>
+#include <alb/mallocator.hpp>
+#include "TestHelpers/Base.h"
+
+#include <string>
+#include <vector>
+
+using namespace alb::test_helpers;
+
+class StringInternerTest : public ::testing::Test {
+protected:
+  alb::string_interner<TestMallocator, 256> sut;
+};
+
+TEST_F(StringInternerTest, ThatIdenticalStringsShareTheSameCopy)
+{
+  std::string first("metrics.cpu.load");
+  std::string second("metrics.cpu.load");
+
+  auto a = sut.intern(first);
+  auto b = sut.intern(second);
+
+  EXPECT_EQ(a.data(), b.data());
+  EXPECT_NE(first.data(), a.data());
+  EXPECT_EQ(first, a.to_string());
+  EXPECT_EQ('\0', a.data()[a.size()]);
+  EXPECT_EQ(1, sut.size());
+}
+
+TEST_F(StringInternerTest, ThatDifferentStringsGetDifferentCopies)
+{
+  auto a = sut.intern("host");
+  auto b = sut.intern("hostname");
+  auto c = sut.intern("");
+
+  EXPECT_NE(a.data(), b.data());
+  EXPECT_NE(nullptr, c.data());
+  EXPECT_EQ(0, c.size());
+  EXPECT_EQ(3, sut.size());
+}
+
+TEST_F(StringInternerTest, ThatFindDoesNotInternAString)
+{
+  EXPECT_EQ(nullptr, sut.find("unknown").data());
+  EXPECT_EQ(0, sut.size());
+
+  auto a = sut.intern("known");
+  EXPECT_EQ(a.data(), sut.find("known").data());
+}
+
+TEST_F(StringInternerTest, ThatViewsStayStableWhileTheTableGrows)
+{
+  std::vector<boost::string_ref> views;
+  for (int i = 0; i < 1000; i++) {
+    views.push_back(sut.intern(std::to_string(i)));
+  }
+  EXPECT_EQ(1000, sut.size());
+
+  for (int i = 0; i < 1000; i++) {
+    auto again = sut.intern(std::to_string(i));
+    EXPECT_EQ(views[i].data(), again.data());
+    EXPECT_EQ(std::to_string(i), again.to_string());
+  }
+  EXPECT_EQ(1000, sut.size());
+}
+
+TEST_F(StringInternerTest, ThatStringsLargerThanASegmentAreStored)
+{
+  std::string large(1000, 'x');
+  auto a = sut.intern(large);
+  auto b = sut.intern("small");
+
+  EXPECT_EQ(large, a.to_string());
+  EXPECT_EQ(a.data(), sut.intern(large).data());
+  EXPECT_EQ("small", b.to_string());
+}
+
+TEST_F(StringInternerTest, ThatDeallocateAllReleasesAllStringsAtOnce)
+{
+  const auto initiallyAllocated = TestMallocator::currentlyAllocatedBytes();
+  for (int i = 0; i < 1000; i++) {
+    sut.intern(std::to_string(i));
+  }
+  const auto allocatedWithStrings = TestMallocator::currentlyAllocatedBytes();
+
+  sut.deallocateAll();
+
+  EXPECT_EQ(0, sut.size());
+  EXPECT_EQ(nullptr, sut.find("42").data());
+  EXPECT_GT(allocatedWithStrings, TestMallocator::currentlyAllocatedBytes());
+  EXPECT_LT(initiallyAllocated, TestMallocator::currentlyAllocatedBytes());
+
+  EXPECT_EQ("42", sut.intern("42").to_string());
+  EXPECT_EQ(1, sut.size());
+}
@@ -0,0 +1,207 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/tlab_region.hpp>
+#include <alb/mallocator.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+class TlabRegionTest : public ::testing::Test {
+protected:
+  using Region = alb::tlab_region<alb::mallocator, 64 * 1024, 1024, 8>;
+  Region sut;
+
+  char *start(const alb::block &b) const
+  {
+    return static_cast<char *>(b.ptr);
+  }
+};
+
+TEST_F(TlabRegionTest, ThatSmallAllocationsAreBumpedWithinOneBuffer)
+{
+  auto a = sut.allocate(10);
+  auto b = sut.allocate(100);
+  auto c = sut.allocate(8);
+  ASSERT_TRUE(sut.owns(a) && sut.owns(b) && sut.owns(c));
+  EXPECT_EQ(16u, a.length);
+  EXPECT_EQ(start(a) + 16, start(b));
+  EXPECT_EQ(start(b) + 104, start(c));
+  EXPECT_EQ(1u, sut.buffers());
+  EXPECT_EQ(1024u, sut.used());
+}
+
+TEST_F(TlabRegionTest, ThatAFullBufferIsRetiredAndANewOneIsTaken)
+{
+  auto a = sut.allocate(1000);
+  auto b = sut.allocate(100);
+  ASSERT_TRUE(a && b);
+  EXPECT_EQ(2u, sut.buffers());
+  EXPECT_EQ(start(a) + 1024, start(b));
+  EXPECT_EQ(2048u, sut.used());
+}
+
+TEST_F(TlabRegionTest, ThatLargeRequestsAndRequestsWithTooMuchWasteAreServedByTheRegion)
+{
+  auto a = sut.allocate(8);
+  auto large = sut.allocate(2000);
+  ASSERT_NE(nullptr, large.ptr);
+  EXPECT_EQ(1024u + 2000, sut.used());
+
+  // 1016 bytes are left in the buffer, so it is kept
+  auto medium = sut.allocate(1024);
+  ASSERT_NE(nullptr, medium.ptr);
+  EXPECT_EQ(1u, sut.buffers());
+  auto b = sut.allocate(8);
+  EXPECT_EQ(start(a) + 8, start(b));
+}
+
+TEST_F(TlabRegionTest, ThatOnlyTheMostRecentBlockOfTheBufferIsGivenBack)
+{
+  auto a = sut.allocate(64);
+  auto b = sut.allocate(64);
+  auto expected = b;
+
+  sut.deallocate(a);
+  EXPECT_EQ(nullptr, a.ptr);
+  auto c = sut.allocate(64);
+  EXPECT_EQ(start(expected) + 64, start(c));
+
+  sut.deallocate(c);
+  sut.deallocate(b);
+  auto d = sut.allocate(64);
+  EXPECT_EQ(start(expected), start(d));
+}
+
+TEST_F(TlabRegionTest, ThatTheMostRecentBlockIsExpandedAndShrunkInPlace)
+{
+  auto a = sut.allocate(64);
+  auto b = sut.allocate(64);
+  auto original = start(b);
+
+  EXPECT_TRUE(sut.expand(b, 100));
+  EXPECT_EQ(168u, b.length);
+  EXPECT_FALSE(sut.expand(a, 8));
+
+  EXPECT_TRUE(sut.reallocate(b, 16));
+  EXPECT_EQ(original, start(b));
+  auto c = sut.allocate(8);
+  EXPECT_EQ(original + 16, start(c));
+
+  std::memset(a.ptr, 'x', a.length);
+  EXPECT_TRUE(sut.reallocate(a, 128));
+  EXPECT_NE(original - 64, start(a));
+  EXPECT_EQ('x', start(a)[63]);
+}
+
+TEST_F(TlabRegionTest, ThatTheMostRecentBlockIsGrownInPlaceByReallocate)
+{
+  auto b = sut.allocate(64);
+  auto original = start(b);
+  std::memset(b.ptr, 'x', b.length);
+
+  EXPECT_TRUE(sut.reallocate(b, 200));
+  EXPECT_EQ(original, start(b));
+  EXPECT_EQ(200u, b.length);
+  EXPECT_EQ(original + 200, start(sut.allocate(8)));
+  EXPECT_EQ(1u, sut.buffers());
+}
+
+TEST_F(TlabRegionTest, ThatAThreadKeepsTheBuffersOfItsFourMostRecentRegions)
+{
+  // the identities of the regions are consecutive, so the first and the last
+  // one collide, if they are mapped by their identity
+  std::vector<std::unique_ptr<Region>> regions;
+  for (int i = 0; i < 5; ++i) {
+    regions.emplace_back(new Region);
+  }
+  auto &first = *regions.front();
+  auto &last = *regions.back();
+  for (int i = 0; i < 10; ++i) {
+    first.allocate(8);
+    last.allocate(8);
+  }
+  EXPECT_EQ(1u, first.buffers());
+  EXPECT_EQ(1u, last.buffers());
+
+  regions[1]->allocate(8);
+  regions[2]->allocate(8);
+  first.allocate(8);
+  // a fifth region replaces the least recently used one
+  regions[3]->allocate(8);
+  last.allocate(8);
+  EXPECT_EQ(1u, first.buffers());
+  EXPECT_EQ(2u, last.buffers());
+}
+
+TEST_F(TlabRegionTest, ThatDeallocateAllStartsANewEpochFromTheBeginning)
+{
+  auto first = sut.allocate(8);
+  for (int i = 0; i < 100; ++i) {
+    sut.allocate(500);
+  }
+  sut.deallocateAll();
+  EXPECT_EQ(0u, sut.used());
+
+  auto b = sut.allocate(8);
+  EXPECT_EQ(first.ptr, b.ptr);
+}
+
+TEST_F(TlabRegionTest, ThatAnExhaustedRegionReturnsAnEmptyBlock)
+{
+  std::vector<alb::block> blocks;
+  for (;;) {
+    auto b = sut.allocate(1000);
+    if (!b) {
+      break;
+    }
+    blocks.push_back(b);
+  }
+  EXPECT_EQ(64u, blocks.size());
+  EXPECT_EQ(nullptr, sut.allocate(70 * 1024).ptr);
+}
+
+TEST_F(TlabRegionTest, ThatThreadsTakeOwnBuffersAndGetDisjointBlocks)
+{
+  const int numberOfThreads = 4;
+  const int blocksPerThread = 500;
+  std::vector<std::vector<alb::block>> blocks(numberOfThreads);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < numberOfThreads; ++t) {
+    threads.emplace_back([this, t, &blocks] {
+      for (int i = 0; i < blocksPerThread; ++i) {
+        auto b = sut.allocate(24);
+        ASSERT_NE(nullptr, b.ptr);
+        std::memset(b.ptr, t, b.length);
+        blocks[t].push_back(b);
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  std::vector<char *> all;
+  for (int t = 0; t < numberOfThreads; ++t) {
+    for (auto &b : blocks[t]) {
+      EXPECT_EQ(std::string(b.length, char(t)), std::string(start(b), b.length));
+      all.push_back(start(b));
+    }
+  }
+  std::sort(all.begin(), all.end());
+  EXPECT_EQ(all.end(), std::adjacent_find(all.begin(), all.end()));
+  // 42 blocks of 24 bytes fit into a buffer
+  EXPECT_EQ(numberOfThreads * ((blocksPerThread + 41) / 42), sut.buffers());
+}
@@ -0,0 +1,320 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+#include <alb/typed_allocation.hpp>
+#include <alb/affix_allocator.hpp>
+#include <alb/fallback_allocator.hpp>
+#include <alb/growth_policy.hpp>
+#include <alb/heap.hpp>
+#include <alb/segregator.hpp>
+#include "TestHelpers/Base.h"
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace alb::test_helpers;
+
+namespace {
+  struct Point {
+    Point(int x, int y)
+      : x(x)
+      , y(y)
+    {
+      ++instances;
+    }
+    ~Point()
+    {
+      --instances;
+    }
+    int x;
+    int y;
+    static int instances;
+  };
+  int Point::instances = 0;
+
+  struct alignas(64) CacheLine {
+    char data[64];
+  };
+
+  struct Throwing {
+    Throwing()
+    {
+      throw std::runtime_error("failed");
+    }
+  };
+
+  /**
+   * Counts its moves and points to itself, so a byte wise copy would break it
+   */
+  struct Tracked {
+    explicit Tracked(int value)
+      : value(value)
+      , self(this)
+    {
+    }
+    Tracked(Tracked &&x) noexcept
+      : value(x.value)
+      , self(this)
+    {
+      ++moves;
+    }
+    bool valid() const
+    {
+      return self == this;
+    }
+    int value;
+    Tracked *self;
+    static int moves;
+  };
+  int Tracked::moves = 0;
+
+  /**
+   * Counts the number of blocks, that are currently allocated
+   */
+  class CountingAllocator {
+    TestMallocator _allocator;
+
+  public:
+    static const bool supports_truncated_deallocation = false;
+    size_t blocks = 0;
+
+    alb::block allocate(size_t n)
+    {
+      auto b = _allocator.allocate(n);
+      blocks += b ? 1 : 0;
+      return b;
+    }
+
+    void deallocate(alb::block &b)
+    {
+      if (b) {
+        --blocks;
+        _allocator.deallocate(b);
+      }
+    }
+  };
+}
+
+TEST(PoolForTest, ThatThePoolIsDimensionedForTheType)
+{
+  alb::pool_for<Point> pool;
+  EXPECT_EQ(sizeof(Point), pool.max_size());
+
+  auto b = pool.allocate(sizeof(Point));
+  EXPECT_EQ(sizeof(Point), b.length);
+  pool.deallocate(b);
+
+  alb::pool_for<CacheLine> alignedPool;
+  auto a = alignedPool.allocate(sizeof(CacheLine));
+  ASSERT_NE(nullptr, a.ptr);
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(a.ptr) % 64);
+  alignedPool.deallocate(a);
+}
+
+TEST(MakeUniqueTest, ThatTheObjectIsConstructedAndDestroyedWithinThePool)
+{
+  alb::pool_for<Point> pool;
+  {
+    auto p = alb::make_unique<Point>(pool, 3, 4);
+    ASSERT_NE(nullptr, p.get());
+    EXPECT_EQ(3, p->x);
+    EXPECT_EQ(4, p->y);
+    EXPECT_EQ(1, Point::instances);
+  }
+  EXPECT_EQ(0, Point::instances);
+
+  // the block was returned to the pool
+  auto b = pool.allocate(sizeof(Point));
+  auto p = alb::make_unique<Point>(pool, 1, 2);
+  EXPECT_NE(b.ptr, p.get());
+  pool.deallocate(b);
+}
+
+TEST(MakeUniqueTest, ThatAnExhaustedAllocatorReturnsAnEmptyPointer)
+{
+  alb::heap<alb::mallocator, 64, 16> heap;
+  auto all = heap.allocate(64 * 16);
+  auto p = alb::make_unique<Point>(heap, 1, 2);
+  EXPECT_EQ(nullptr, p.get());
+  heap.deallocate(all);
+}
+
+TEST(MakeUniqueTest, ThatTheMemoryIsFreedIfTheConstructorThrows)
+{
+  CountingAllocator allocator;
+  EXPECT_THROW(alb::make_unique<Throwing>(allocator), std::runtime_error);
+  EXPECT_EQ(0u, allocator.blocks);
+}
+
+TEST(AllocateSharedTest, ThatControlBlockAndObjectShareASingleBlock)
+{
+  CountingAllocator allocator;
+  {
+    auto p = alb::allocate_shared<Point>(allocator, 5, 6);
+    auto copy = p;
+    EXPECT_EQ(1u, allocator.blocks);
+    EXPECT_EQ(5, copy->x);
+    EXPECT_EQ(2, p.use_count());
+  }
+  EXPECT_EQ(0u, allocator.blocks);
+  EXPECT_EQ(0, Point::instances);
+}
+
+TEST(AllocateSharedTest, ThatAHeapCanProvideTheSharedObjects)
+{
+  alb::heap<alb::mallocator, 64, 32> heap;
+  {
+    auto p = alb::allocate_shared<std::string>(heap, "shared");
+    EXPECT_EQ("shared", *p);
+    EXPECT_TRUE(heap.owns(alb::block(p.get(), sizeof(std::string))));
+  }
+  auto all = heap.allocate(64 * 32);
+  EXPECT_NE(nullptr, all.ptr);
+  heap.deallocate(all);
+}
+
+TEST(RefAllocatorTest, ThatCompositionsOverAHeapRoundTheLengthUp)
+{
+  using Heap = alb::heap<alb::mallocator, 64, 16>;
+  static_assert(alb::traits::has_goodSize<alb::fallback_allocator<Heap, alb::mallocator>>::value,
+                "A fallback_allocator over a heap must round the length up!");
+  static_assert(alb::traits::has_goodSize<alb::segregator<64, Heap, alb::mallocator>>::value,
+                "A segregator over a heap must round the length up!");
+  static_assert(alb::traits::has_goodSize<alb::growth_policy<Heap>>::value,
+                "A growth_policy over a heap must round the length up!");
+  static_assert(alb::traits::has_goodSize<alb::affix_allocator<Heap, int>>::value,
+                "An affix_allocator over a heap must round the length up!");
+}
+
+TEST(RefAllocatorTest, ThatAHeapWithinAFallbackAllocatorGetsBackAllItsChunks)
+{
+  using Heap = alb::heap<alb::mallocator, 64, 16>;
+  using Allocator = alb::fallback_allocator<Heap, alb::mallocator>;
+  Allocator allocator;
+  for (int i = 0; i < 10; ++i) {
+    std::vector<char, alb::ref_allocator<char, Allocator>> v{
+        alb::ref_allocator<char, Allocator>(allocator)};
+    // covers two chunks of the heap
+    v.reserve(17);
+  }
+  auto &heap = static_cast<Heap &>(allocator);
+  auto all = heap.allocate(64 * 16);
+  EXPECT_NE(nullptr, all.ptr);
+  heap.deallocate(all);
+}
+
+class ReallocateArrayTest : public ::testing::Test {
+protected:
+  alb::heap<alb::mallocator, 64, 16> heap;
+
+  alb::block create(size_t count)
+  {
+    auto b = heap.allocate(count * sizeof(Tracked));
+    for (size_t i = 0; i < count; ++i) {
+      ::new (static_cast<Tracked *>(b.ptr) + i) Tracked(static_cast<int>(i));
+    }
+    return b;
+  }
+
+  void SetUp() override
+  {
+    Tracked::moves = 0;
+  }
+};
+
+TEST_F(ReallocateArrayTest, ThatAGrowthIsDoneInPlaceWithoutRelocation)
+{
+  auto b = create(2);
+  const auto ptr = b.ptr;
+
+  ASSERT_TRUE(alb::reallocate_array<Tracked>(heap, b, 2, 8));
+  EXPECT_EQ(ptr, b.ptr);
+  EXPECT_LE(8 * sizeof(Tracked), b.length);
+  EXPECT_EQ(0, Tracked::moves);
+  heap.deallocate(b);
+}
+
+TEST_F(ReallocateArrayTest, ThatTheObjectsAreRelocatedIfTheBlockMustMove)
+{
+  auto b = create(2);
+  auto blocking = heap.allocate(16);
+  const auto ptr = b.ptr;
+
+  ASSERT_TRUE(alb::reallocate_array<Tracked>(heap, b, 2, 8));
+  EXPECT_NE(ptr, b.ptr);
+  EXPECT_EQ(2, Tracked::moves);
+  auto objects = static_cast<Tracked *>(b.ptr);
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_TRUE(objects[i].valid());
+    EXPECT_EQ(i, objects[i].value);
+  }
+  heap.deallocate(b);
+  heap.deallocate(blocking);
+}
+
+TEST_F(ReallocateArrayTest, ThatAShrinkIsDoneInPlaceWithoutRelocation)
+{
+  static_assert(alb::traits::shrinks_in_place<decltype(heap)>::value,
+                "A heap shrinks its blocks in place!");
+  static_assert(!alb::traits::shrinks_in_place<alb::mallocator>::value,
+                "::realloc() may move a block, when it shrinks!");
+
+  auto b = create(8);
+  const auto ptr = b.ptr;
+
+  ASSERT_TRUE(alb::reallocate_array<Tracked>(heap, b, 2, 2));
+  EXPECT_EQ(ptr, b.ptr);
+  EXPECT_EQ(2 * sizeof(Tracked), b.length);
+  EXPECT_EQ(0, Tracked::moves);
+
+  // the rest of the block is given back to the heap
+  auto next = heap.allocate(16);
+  EXPECT_EQ(static_cast<char *>(ptr) + b.length, next.ptr);
+  heap.deallocate(next);
+  heap.deallocate(b);
+}
+
+TEST_F(ReallocateArrayTest, ThatTheGivenRelocationIsUsed)
+{
+  auto b = create(3);
+  auto blocking = heap.allocate(16);
+  size_t relocated = 0;
+
+  ASSERT_TRUE(alb::reallocate_array<Tracked>(heap, b, 3, 6,
+                                             [&relocated](Tracked *from, Tracked *to, size_t n) {
+                                               relocated = n;
+                                               alb::relocate_objects()(from, to, n);
+                                             }));
+  EXPECT_EQ(3u, relocated);
+  EXPECT_EQ(2, static_cast<Tracked *>(b.ptr)[2].value);
+  heap.deallocate(b);
+  heap.deallocate(blocking);
+}
+
+TEST(ReallocateArrayMallocatorTest, ThatStringsSurviveAReallocationWithoutExpand)
+{
+  alb::mallocator allocator;
+  auto b = allocator.allocate(2 * sizeof(std::string));
+  auto strings = static_cast<std::string *>(b.ptr);
+  ::new (strings) std::string("short");
+  ::new (strings + 1) std::string(100, 'x');
+
+  ASSERT_TRUE(alb::reallocate_array<std::string>(allocator, b, 2, 1000));
+  strings = static_cast<std::string *>(b.ptr);
+  EXPECT_EQ(1000 * sizeof(std::string), b.length);
+  EXPECT_EQ("short", strings[0]);
+  EXPECT_EQ(std::string(100, 'x'), strings[1]);
+
+  strings[0].~basic_string();
+  strings[1].~basic_string();
+  allocator.deallocate(b);
+}
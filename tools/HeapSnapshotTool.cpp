@@ -0,0 +1,64 @@
+///////////////////////////////////////////////////////////////////
+//
+// Copyright 2014 Felix Petriconi
+//
+// License: http://boost.org/LICENSE_1_0.txt, Boost License 1.0
+//
+// Authors: http://petriconi.net, Felix Petriconi
+//
+///////////////////////////////////////////////////////////////////
+
+// Prints the fragmentation statistics of a file, that was written by
+// alb::heap_snapshot::write(), and renders it optionally as PGM image.
+//
+//   HeapSnapshotTool snapshot.alb [occupancy.pgm [chunks per row]]
+
+#include <alb/heap_snapshot.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+int main(int argc, char *argv[])
+{
+  if (argc < 2 || argc > 4) {
+    std::fprintf(stderr, "usage: %s snapshot [image.pgm [chunks per row]]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  std::ifstream in(argv[1], std::ios::binary);
+  alb::heap_snapshot<> snapshot;
+  if (!snapshot.read(in)) {
+    std::fprintf(stderr, "%s is not a valid heap snapshot\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  const auto chunks = snapshot.number_of_chunks();
+  const auto chunkSize = snapshot.chunk_size();
+  const auto freeChunks = snapshot.free_chunks();
+  std::printf("chunks:             %zu of %zu bytes\n", chunks, chunkSize);
+  std::printf("free:               %zu chunks, %zu bytes, %.1f%%\n", freeChunks,
+              freeChunks * chunkSize, chunks > 0 ? 100.0 * freeChunks / chunks : 0.0);
+  std::printf("largest free run:   %zu chunks, %zu bytes\n", snapshot.largest_free_run(),
+              snapshot.largest_free_run() * chunkSize);
+  std::printf("fragmentation:      %.3f\n", snapshot.fragmentation_index());
+
+  size_t histogram[alb::heap_snapshot<>::histogram_size];
+  snapshot.free_run_histogram(histogram);
+  std::printf("free runs by length in chunks:\n");
+  for (size_t i = 0; i < alb::heap_snapshot<>::histogram_size; ++i) {
+    if (histogram[i] > 0) {
+      std::printf("  [%zu, %zu): %zu\n", size_t(1) << i, size_t(2) << i, histogram[i]);
+    }
+  }
+
+  if (argc >= 3) {
+    const size_t width = argc == 4 ? std::strtoul(argv[3], nullptr, 10) : 64;
+    std::ofstream out(argv[2], std::ios::binary);
+    if (!snapshot.write_pgm(out, width)) {
+      std::fprintf(stderr, "cannot write %s\n", argv[2]);
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}